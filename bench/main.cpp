@@ -0,0 +1,438 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <brendantui/braille.h>
+#include <brendantui/charts.h>
+#include <brendantui/drawing.h>
+#include <brendantui/heatmap.h>
+#include <brendantui/image.h>
+#include <brendantui/quantize.h>
+#include <brendantui/statictable.h>
+#include <brendantui/utf8.h>
+
+using namespace btui;
+
+namespace {
+    struct BenchResult {
+        std::string name;
+        uint32_t width;
+        uint32_t height;
+        uint64_t cells;
+        uint64_t iterations;
+        double nsPerIteration;
+        double nsPerCell;
+    };
+
+    struct BenchOptions {
+        const char* jsonPath;
+        const char* filter;
+        double minSeconds;
+
+        BenchOptions()
+            : jsonPath(0), filter(0), minSeconds(0.1) { }
+    };
+
+    // Keeps the optimizer from discarding work whose
+    // result is otherwise unused.
+
+    volatile uint32_t benchSink;
+
+    void Consume(BufferGrid Buffer) {
+        uint32_t sum = 0;
+        for (uint32_t i = 0; i < Buffer.width * Buffer.height; i += 61)
+            sum += (uint32_t)Buffer.buffer[i].character ^ Buffer.buffer[i].forecolor;
+        benchSink = benchSink + sum;
+    }
+
+    std::vector<BenchResult> results;
+
+    // A fixed 6x7 dashboard table, 79x22 cells.
+
+    constexpr auto dashboardTable = MakeStaticTableSpec<6, 7>({ 12, 12, 12, 12, 12, 12 }, { 2, 2, 2, 2, 2, 2, 2 });
+
+    void Run(const BenchOptions& Options, std::string Name, SizeU32 Size, uint64_t CellsPerIteration, const std::function<void()>& Body) {
+        Name += "/" + std::to_string(Size.width) + "x" + std::to_string(Size.height);
+        if (Options.filter && Name.find(Options.filter) == std::string::npos) return;
+
+        using clock = std::chrono::steady_clock;
+
+        Body();
+
+        uint64_t iterations = 0;
+        uint64_t batch = 1;
+        double elapsed = 0.0;
+        while (elapsed < Options.minSeconds) {
+            auto start = clock::now();
+            for (uint64_t i = 0; i < batch; ++i) Body();
+            elapsed += std::chrono::duration<double>(clock::now() - start).count();
+            iterations += batch;
+            if (batch < (1ull << 20)) batch <<= 1;
+        }
+
+        BenchResult result;
+        result.name = Name;
+        result.width = Size.width;
+        result.height = Size.height;
+        result.cells = CellsPerIteration;
+        result.iterations = iterations;
+        result.nsPerIteration = elapsed * 1e9 / (double)iterations;
+        result.nsPerCell = CellsPerIteration ? result.nsPerIteration / (double)CellsPerIteration : 0.0;
+        results.push_back(result);
+
+        std::printf("%-52s %12.1f ns/iter %9.3f ns/cell\n", result.name.c_str(), result.nsPerIteration, result.nsPerCell);
+    }
+
+    std::wstring MakeText(uint32_t Width, uint32_t Height) {
+        static const wchar_t* words[] = {
+            L"lorem", L"ipsum", L"dolor", L"sit", L"amet", L"consectetur", L"adipiscing", L"elit",
+            L"sed", L"do", L"eiusmod", L"tempor", L"incididunt", L"ut", L"labore", L"et", L"dolore"
+        };
+
+        // Roughly enough words to fill the frame, with a
+        // paragraph break every few lines.
+
+        std::wstring text;
+        uint64_t target = (uint64_t)Width * Height;
+        for (uint32_t i = 0; text.size() < target; ++i) {
+            text += words[i % (sizeof(words) / sizeof(words[0]))];
+            text += (i % 37 == 36) ? L'\n' : L' ';
+        }
+        return text;
+    }
+
+    void RunForSize(const BenchOptions& Options, SizeU32 Size) {
+        uint64_t cellCount = (uint64_t)Size.width * Size.height;
+        std::vector<BufferGridCell> cells(cellCount);
+        BufferGrid buffer(Size, cells.data());
+        RectU32 frame(PointU32(0, 0), Size);
+
+        BufferGridCell fillCell(L'.', 0xFFC0C0C0, 0xFF202020);
+        uint32_t fillColor = 0x80336699;
+
+        {
+            SizeU32 canvasSize(Size.width / 2, Size.height / 2);
+            std::vector<BufferGridCell> canvasCells((uint64_t)canvasSize.width * canvasSize.height, BufferGridCell(L'#', 0xFFFFFFFF, 0xFF0000FF));
+            BufferGrid canvas(canvasSize, canvasCells.data());
+            Run(Options, "DrawCanvasInFrame/center/cellFill", Size, cellCount, [&]() {
+                DrawCanvasInFrame(buffer, frame, canvas, AlignMiddle, AlignMiddle, fillCell);
+                Consume(buffer);
+            });
+            Run(Options, "DrawCanvasInFrame/center/colorFill", Size, cellCount, [&]() {
+                DrawCanvasInFrame(buffer, frame, canvas, AlignMiddle, AlignMiddle, fillColor);
+                Consume(buffer);
+            });
+            Run(Options, "DrawCanvasInFrame/clear", Size, cellCount, [&]() {
+                DrawCanvasInFrame(buffer, frame, BufferGrid(), AlignStart, AlignStart, fillCell);
+                Consume(buffer);
+            });
+        }
+
+        {
+            static const struct { WrapStyle style; const char* name; } wrapStyles[] = {
+                { WrapStyleNoWrap, "noWrap" },
+                { WrapStyleWrapByChar, "wrapByChar" },
+                { WrapStyleWrapByWord, "wrapByWord" },
+                { WrapStyleWrapByWordAndStretch, "wrapByWordAndStretch" }
+            };
+            static const struct { Align align; const char* name; } aligns[] = {
+                { AlignStart, "start" },
+                { AlignMiddle, "middle" },
+                { AlignEnd, "end" }
+            };
+
+            std::wstring text = MakeText(Size.width, Size.height);
+            for (const auto& wrap : wrapStyles)
+            for (const auto& align : aligns) {
+                std::string name = std::string("DrawTextInFrame/") + wrap.name + "/" + align.name;
+                Run(Options, name, Size, cellCount, [&]() {
+                    DrawTextInFrame(buffer, frame, text, 0xFF000000, 0xFFFFFFFF, align.align, AlignStart, wrap.style, fillCell);
+                    Consume(buffer);
+                });
+            }
+        }
+
+        {
+            // One UTF-8 label per row, as a dashboard fed
+            // UTF-8 data would draw them.
+
+            std::string label;
+            for (uint32_t i = 0; label.size() < Size.width; ++i) label += (i % 5 == 4) ? "\xC3\xA9t\xC3\xA9 " : "status ";
+            Run(Options, "Labels/utf8ToWstring", Size, cellCount, [&]() {
+                for (uint32_t y = 0; y < Size.height; ++y) {
+                    std::wstring wide;
+                    AppendUtf8(wide, label);
+                    DrawTextInFrame(buffer, RectU32(0, y, Size.width, 1), wide, 0xFF000000, 0xFFFFFFFF, AlignStart, AlignStart, WrapStyleNoWrap, fillCell);
+                }
+                Consume(buffer);
+            });
+            Run(Options, "Labels/utf8DrawTextInFrame", Size, cellCount, [&]() {
+                for (uint32_t y = 0; y < Size.height; ++y)
+                    DrawTextInFrame(buffer, RectU32(0, y, Size.width, 1), std::string_view(label), 0xFF000000, 0xFFFFFFFF, AlignStart, AlignStart, WrapStyleNoWrap, fillCell);
+                Consume(buffer);
+            });
+            Run(Options, "Labels/drawUtf8Line", Size, cellCount, [&]() {
+                for (uint32_t y = 0; y < Size.height; ++y)
+                    DrawUtf8Line(buffer, PointU32(0, y), label, 0xFF000000, 0xFFFFFFFF, Size.width);
+                Consume(buffer);
+            });
+        }
+
+        {
+            uint32_t columnCount = Size.width / 12;
+            uint32_t rowCount = Size.height / 3;
+            std::vector<uint32_t> columnWidths(columnCount, 11);
+            std::vector<uint32_t> rowHeights(rowCount, 2);
+            std::unique_ptr<bool[]> horizontalBorders(new bool[(rowCount + 1) * columnCount]);
+            std::unique_ptr<bool[]> verticalBorders(new bool[rowCount * (columnCount + 1)]);
+            std::fill_n(horizontalBorders.get(), (rowCount + 1) * columnCount, true);
+            std::fill_n(verticalBorders.get(), rowCount * (columnCount + 1), true);
+
+            Run(Options, "DrawTableInFrame/fullGrid", Size, cellCount, [&]() {
+                DrawTableInFrame(buffer, frame, columnCount, rowCount, columnWidths.data(), rowHeights.data(), horizontalBorders.get(), verticalBorders.get(), 0xFF000000, 0xFFFFFFFF, fillCell);
+                Consume(buffer);
+            });
+        }
+
+        {
+            std::vector<uint32_t> columnWidths(dashboardTable.columnWidths.begin(), dashboardTable.columnWidths.end());
+            std::vector<uint32_t> rowHeights(dashboardTable.rowHeights.begin(), dashboardTable.rowHeights.end());
+            auto horizontalBorders = dashboardTable.horizontalBorders;
+            auto verticalBorders = dashboardTable.verticalBorders;
+            SizeU32 tableSize = StaticTableLayout<dashboardTable>::Size();
+            uint64_t tableCells = (uint64_t)std::min(tableSize.width, Size.width) * std::min(tableSize.height, Size.height);
+
+            Run(Options, "DrawTableInFrame/dashboard", Size, tableCells, [&]() {
+                DrawTableInFrame(buffer, frame, 6, 7, columnWidths.data(), rowHeights.data(), horizontalBorders.data(), verticalBorders.data(), 0xFF000000, 0xFFFFFFFF, fillCell);
+                Consume(buffer);
+            });
+            Run(Options, "StaticTableLayout/dashboard", Size, tableCells, [&]() {
+                StaticTableLayout<dashboardTable>::Draw(buffer, frame, 0xFF000000, 0xFFFFFFFF, fillCell);
+                Consume(buffer);
+            });
+        }
+
+        {
+            // A million-sample history, 1000 new samples a
+            // frame.
+
+            std::vector<float> history(1 << 20);
+            for (size_t i = 0; i < history.size(); ++i)
+                history[i] = (float)((i * 2654435761u) >> 20 & 1023);
+            RectU32 chartRect(0, 0, Size.width, std::min(Size.height, 8u));
+            uint64_t chartCells = (uint64_t)chartRect.width * chartRect.height;
+
+            Run(Options, "DrawChart/line/1M", Size, chartCells, [&]() {
+                DrawChart(buffer, chartRect, history.data(), history.size(), ChartStyleLine, 0, 0, 0xFF000000, 0xFF00FF00);
+                Consume(buffer);
+            });
+
+            ChartSeries series(history.size());
+            series.Push(history.data(), history.size());
+            size_t next = 0;
+            Run(Options, "ChartSeries/line/1M+1000", Size, chartCells, [&]() {
+                series.Push(history.data() + next, 1000);
+                next = (next + 1000) % (history.size() - 1000);
+                series.Draw(buffer, chartRect, ChartStyleLine, 0, 0, 0xFF000000, 0xFF00FF00);
+                Consume(buffer);
+            });
+        }
+
+        {
+            std::vector<float> xs(1 << 20);
+            std::vector<float> ys(1 << 20);
+            for (size_t i = 0; i < xs.size(); ++i) {
+                xs[i] = (float)(i * 2654435761u >> 12 & 1023);
+                ys[i] = (float)(i * 40503u >> 6 & 1023);
+            }
+            BrailleCanvas canvas(Size);
+            Run(Options, "BrailleCanvas/points1M", Size, cellCount, [&]() {
+                canvas.Clear();
+                canvas.Points(xs.data(), ys.data(), xs.size(), 0, 1024, 0, 1024, 0xFF00FF00);
+                canvas.Draw(buffer, frame, 0xFF000000);
+                Consume(buffer);
+            });
+        }
+
+        {
+            // A 4096 x 4096 matrix, drawn whole and then
+            // zoomed in on a quarter of it.
+
+            const uint32_t side = 4096;
+            std::vector<float> matrix((size_t)side * side);
+            for (size_t i = 0; i < matrix.size(); ++i)
+                matrix[i] = (float)(i * 2654435761u >> 22 & 1023);
+            ColorLut lut = MakeColorLut({ 0xFF000080, 0xFF00C0C0, 0xFFFFFF00, 0xFFFF0000 });
+            HeatmapPyramid pyramid;
+            pyramid.Build(matrix.data(), side, side, side, HeatmapReduceMax);
+
+            Run(Options, "DrawHeatmap/max/16M", Size, cellCount, [&]() {
+                DrawHeatmap(buffer, frame, matrix.data(), side, side, side, HeatmapReduceMax, 0, 1023, lut);
+                Consume(buffer);
+            });
+            Run(Options, "HeatmapPyramid/max/16M", Size, cellCount, [&]() {
+                pyramid.Draw(buffer, frame, 0, 0, side, side, 0, 1023, lut, 0xFF000000);
+                Consume(buffer);
+            });
+            Run(Options, "HeatmapPyramid/max/zoomed", Size, cellCount, [&]() {
+                pyramid.Draw(buffer, frame, side / 4, side / 4, side / 2, side / 2, 0, 1023, lut, 0xFF000000);
+                Consume(buffer);
+            });
+        }
+
+        {
+            // A 640 x 480 video frame where a small patch
+            // changes every frame.
+
+            const uint32_t imageWidth = 640;
+            const uint32_t imageHeight = 480;
+            std::vector<uint8_t> image((size_t)imageWidth * imageHeight * 4);
+            for (size_t i = 0; i < image.size(); ++i)
+                image[i] = (uint8_t)(i * 2654435761u >> 24);
+            ImageView view(image.data(), imageWidth, imageHeight);
+
+            Run(Options, "DrawImage/640x480", Size, cellCount, [&]() {
+                DrawImage(buffer, frame, view, AlignMiddle, AlignMiddle, 0xFF000000);
+                Consume(buffer);
+            });
+
+            ImageRenderer renderer;
+            uint32_t tick = 0;
+            Run(Options, "ImageRenderer/640x480/patch", Size, cellCount, [&]() {
+                ++tick;
+                for (uint32_t y = 200; y < 232; ++y)
+                    memset(image.data() + ((size_t)y * imageWidth + 300) * 4, (int)tick, 32 * 4);
+                renderer.Draw(buffer, frame, view, AlignMiddle, AlignMiddle, 0xFF000000);
+                Consume(buffer);
+            });
+        }
+
+        {
+            ColorQuantizer quantizer(ColorTarget256);
+            std::vector<uint8_t> forecolors(cellCount);
+            std::vector<uint8_t> backcolors(cellCount);
+
+            Run(Options, "ColorQuantizer/map", Size, cellCount, [&]() {
+                quantizer.Map(cells.data(), cellCount, forecolors.data(), backcolors.data());
+                benchSink = benchSink + forecolors[cellCount / 2] + backcolors[cellCount / 3];
+            });
+            Run(Options, "ColorQuantizer/mapDithered", Size, cellCount, [&]() {
+                quantizer.MapDithered(buffer, forecolors.data(), backcolors.data());
+                benchSink = benchSink + forecolors[cellCount / 2] + backcolors[cellCount / 3];
+            });
+        }
+
+        {
+            std::vector<uint32_t> colors(cellCount);
+            for (uint64_t i = 0; i < cellCount; ++i)
+                colors[i] = (uint32_t)(i * 2654435761u) | 0xFF000000;
+
+            Run(Options, "OverlayColor", Size, cellCount, [&]() {
+                uint32_t top = fillColor;
+                for (uint64_t i = 0; i < cellCount; ++i)
+                    colors[i] = OverlayColor(colors[i], top) | 0xFF000000;
+                benchSink = benchSink + colors[cellCount / 2];
+            });
+        }
+
+        {
+            Run(Options, "FillRect/full", Size, cellCount, [&]() {
+                FillRect(buffer, frame, fillCell);
+                Consume(buffer);
+            });
+            Run(Options, "FillRect/inset", Size, cellCount, [&]() {
+                FillRect(buffer, RectU32(1, 1, Size.width - 2, Size.height - 2), fillCell);
+                Consume(buffer);
+            });
+            Run(Options, "FillRect/memsetBaseline", Size, cellCount, [&]() {
+                std::memset((void*)cells.data(), 0, sizeof(BufferGridCell) * cellCount);
+                Consume(buffer);
+            });
+            Run(Options, "ScrollRegion/upOneLine", Size, cellCount, [&]() {
+                ScrollRegion(buffer, frame, 0, -1, fillCell);
+                Consume(buffer);
+            });
+            Run(Options, "ScrollRegion/insetUpOneLine", Size, cellCount, [&]() {
+                ScrollRegion(buffer, RectU32(1, 1, Size.width - 2, Size.height - 2), 0, -1, fillCell);
+                Consume(buffer);
+            });
+            Run(Options, "DrawBox/double/cellFill", Size, cellCount, [&]() {
+                DrawBox(buffer, frame, BoxStyleDouble, 0xFF000000, 0xFFFFFFFF, fillCell);
+                Consume(buffer);
+            });
+        }
+
+        {
+            backgroundFill_t cellFillVariant = fillCell;
+            backgroundFill_t colorFillVariant = fillColor;
+            Run(Options, "OverwriteWithBackgroundFill/cell", Size, cellCount, [&]() {
+                for (uint64_t i = 0; i < cellCount; ++i)
+                    OverwriteWithBackgroundFill(cells[i], cellFillVariant);
+                Consume(buffer);
+            });
+            Run(Options, "OverwriteWithBackgroundFill/color", Size, cellCount, [&]() {
+                for (uint64_t i = 0; i < cellCount; ++i)
+                    OverwriteWithBackgroundFill(cells[i], colorFillVariant);
+                Consume(buffer);
+            });
+        }
+    }
+
+    bool WriteJson(const char* Path) {
+        FILE* file = std::fopen(Path, "w");
+        if (!file) return false;
+
+        std::fprintf(file, "{\n  \"benchmarks\": [\n");
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchResult& result = results[i];
+            std::fprintf(file,
+                "    { \"name\": \"%s\", \"width\": %u, \"height\": %u, \"cells\": %llu, \"iterations\": %llu, \"ns_per_iter\": %.3f, \"ns_per_cell\": %.5f }%s\n",
+                result.name.c_str(), result.width, result.height,
+                (unsigned long long)result.cells, (unsigned long long)result.iterations,
+                result.nsPerIteration, result.nsPerCell,
+                i + 1 < results.size() ? "," : "");
+        }
+        std::fprintf(file, "  ]\n}\n");
+        std::fclose(file);
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--json") && i + 1 < argc)
+            options.jsonPath = argv[++i];
+        else if (!std::strcmp(argv[i], "--filter") && i + 1 < argc)
+            options.filter = argv[++i];
+        else if (!std::strcmp(argv[i], "--min-time") && i + 1 < argc)
+            options.minSeconds = std::atof(argv[++i]) / 1000.0;
+        else {
+            std::fprintf(stderr, "usage: %s [--json PATH] [--filter SUBSTRING] [--min-time MS]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // 80x24 terminal, a maximized 1080p window and a
+    // full 4K window at the default 10x15 cell size.
+
+    static const SizeU32 sizes[] = {
+        SizeU32(80, 24),
+        SizeU32(192, 72),
+        SizeU32(384, 144)
+    };
+    for (SizeU32 size : sizes)
+        RunForSize(options, size);
+
+    if (options.jsonPath && !WriteJson(options.jsonPath)) {
+        std::fprintf(stderr, "could not write %s\n", options.jsonPath);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,80 @@
+#ifndef BRENDANTUI_BRAILLE_H_
+#define BRENDANTUI_BRAILLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "windowbase.h"
+
+namespace btui {
+    namespace details {
+        // Braille numbers its dots down the left column
+        // (1, 2, 3, then 7) and then the right one, so the
+        // bit for a dot isn't simply its position.
+
+        inline constexpr uint8_t brailleBits[2][4] = {
+            { 0x01, 0x02, 0x04, 0x40 },
+            { 0x08, 0x10, 0x20, 0x80 }
+        };
+    }
+
+    // A pixel canvas with 2x4 pixels per cell, drawn with
+    // the Unicode braille patterns (U+2800 to U+28FF).
+    // Each cell is one byte of dots plus the color of
+    // the last thing drawn into it; plotting only
+    // touches those two arrays, and Draw() turns them
+    // into cells in one pass. Pixel (0, 0) is the
+    // top-left dot.
+
+    class BrailleCanvas {
+        std::vector<uint8_t> dots;
+        std::vector<uint32_t> colors;
+        SizeU32 size;
+        uint32_t defaultColor;
+
+        inline void Plot(uint32_t X, uint32_t Y, uint32_t Color) {
+            size_t cell = (size_t)(Y >> 2) * size.width + (X >> 1);
+            dots[cell] |= details::brailleBits[X & 1][Y & 3];
+            colors[cell] = Color;
+        }
+    public:
+        BrailleCanvas(SizeU32 Size = SizeU32(), uint32_t DefaultColor = 0xFFFFFFFF);
+
+        // Resize() clears the canvas.
+
+        void Resize(SizeU32 NewSize);
+        void Clear();
+
+        SizeU32 Size() const;
+        uint32_t PixelWidth() const;
+        uint32_t PixelHeight() const;
+
+        // Pixels outside the canvas are ignored.
+
+        void SetPixel(uint32_t X, uint32_t Y, uint32_t Color);
+        void ClearPixel(uint32_t X, uint32_t Y);
+        bool GetPixel(uint32_t X, uint32_t Y) const;
+
+        void Line(int32_t X0, int32_t Y0, int32_t X1, int32_t Y1, uint32_t Color);
+        void FillRect(RectU32 PixelRect, uint32_t Color);
+
+        // Plots Count points given in pixels.
+
+        void Points(const uint32_t* Xs, const uint32_t* Ys, size_t Count, uint32_t Color);
+
+        // Plots Count points given in data units, mapping
+        // [XMin, XMax] across the canvas and [YMin, YMax]
+        // up it. Points outside the ranges (or NaN) are
+        // dropped.
+
+        void Points(const float* Xs, const float* Ys, size_t Count, float XMin, float XMax, float YMin, float YMax, uint32_t Color);
+
+        // Writes the canvas into Rect (top-left aligned,
+        // clipped); cells without dots become spaces.
+
+        void Draw(BufferGrid Buffer, RectU32 Rect, uint32_t Backcolor) const;
+    };
+}
+
+#endif // BRENDANTUI_BRAILLE_H_
@@ -0,0 +1,93 @@
+#ifndef BRENDANTUI_CHARTS_H_
+#define BRENDANTUI_CHARTS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+#include "windowbase.h"
+
+namespace btui {
+    enum ChartStyle {
+        ChartStyleBars, //sparkline/area: a bar up to each column's maximum, in eighths of a cell
+        ChartStyleLine  //each column's min-to-max span, joined to the previous column, in half cells
+    };
+
+    namespace details {
+        // The samples that land in one chart column.
+
+        struct ChartBucket {
+            float min;
+            float max;
+            float last;
+            uint64_t count;
+
+            constexpr inline ChartBucket()
+                : min(0), max(0), last(0), count(0) { }
+
+            void Add(const float* Samples, size_t Count);
+        };
+
+        void DrawChartBuckets(BufferGrid Buffer, RectU32 Rect, const ChartBucket* Buckets, uint32_t BucketCount, ChartStyle Style, float Low, float High, uint32_t Backcolor, uint32_t Forecolor);
+    }
+
+    // Plots Samples (oldest first) into Rect. With more
+    // samples than columns, each column shows the min
+    // and max of its share, so no spike is lost; with
+    // fewer, the samples are drawn one per column at the
+    // right. If Low >= High the range is fitted to the
+    // samples. Samples must not be NaN.
+    //
+    // This scans every sample; for a long, growing
+    // history use ChartSeries instead.
+
+    void DrawChart(BufferGrid Buffer, RectU32 Rect, const float* Samples, size_t Count, ChartStyle Style, float Low, float High, uint32_t Backcolor, uint32_t Forecolor);
+
+    // A ring buffer of the last Capacity samples that
+    // remembers its per-column min/max between draws.
+    // A column always covers the same samples (its
+    // width is Capacity / columns, rounded up), so a
+    // draw only folds in the samples pushed since the
+    // last one and then does O(columns) work, however
+    // long the history; the oldest column is rebuilt
+    // from the ring as its samples leave it, which
+    // costs up to one column's worth. Changing the
+    // width rebuilds the columns once. Not thread-safe.
+
+    class ChartSeries {
+        std::unique_ptr<float[]> ring;
+        size_t capacity;
+        uint64_t total; //samples ever pushed
+
+        std::deque<details::ChartBucket> buckets;
+        uint64_t bucketSamples;
+        uint64_t firstBucket; //absolute index of buckets.front()
+        uint64_t frontStart; //first sample folded into buckets.front()
+        uint64_t aggregated; //samples folded into buckets
+
+        void AddRange(details::ChartBucket& Bucket, uint64_t Begin, uint64_t End) const;
+        void CatchUp(uint32_t Columns);
+    public:
+        ChartSeries(size_t Capacity);
+
+        ChartSeries(const ChartSeries&) = delete;
+        ChartSeries& operator=(const ChartSeries&) = delete;
+
+        void Push(float Sample);
+        void Push(const float* Samples, size_t Count);
+        void Clear();
+
+        size_t Capacity() const;
+        size_t Size() const;
+        uint64_t TotalPushed() const;
+
+        // Index 0 is the oldest retained sample.
+
+        float At(size_t Index) const;
+
+        void Draw(BufferGrid Buffer, RectU32 Rect, ChartStyle Style, float Low, float High, uint32_t Backcolor, uint32_t Forecolor);
+    };
+}
+
+#endif // BRENDANTUI_CHARTS_H_
@@ -0,0 +1,172 @@
+#ifndef BRENDANTUI_DOCVIEW_H_
+#define BRENDANTUI_DOCVIEW_H_
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mappedfile.h"
+#include "windowbase.h"
+
+namespace btui {
+    enum LineSource : uint8_t {
+        LineSourceFile,
+        LineSourceEdit
+    };
+
+    namespace details {
+        // A run of consecutive document lines, either
+        // straight from the file or from the edit store.
+
+        struct LineSegment {
+            LineSource source;
+            bool highlighted;
+            uint32_t highlightBackcolor;
+            uint64_t start;
+            uint64_t count;
+
+            constexpr inline LineSegment()
+                : source(LineSourceFile), highlighted(false), highlightBackcolor(0), start(0), count(0) { }
+            constexpr inline LineSegment(LineSource Source, uint64_t Start, uint64_t Count)
+                : source(Source), highlighted(false), highlightBackcolor(0), start(Start), count(Count) { }
+        };
+
+        // Rope of line segments (an implicit treap keyed
+        // by line count), so inserting, deleting or
+        // annotating a range of lines costs O(log n)
+        // no matter where it lands.
+
+        class LineRope {
+            struct Node {
+                LineSegment segment;
+                uint64_t lines;
+                uint32_t priority;
+                std::unique_ptr<Node> left;
+                std::unique_ptr<Node> right;
+
+                Node(const LineSegment& Segment, uint32_t Priority);
+                void Update();
+            };
+
+            std::unique_ptr<Node> root;
+            uint32_t seed;
+
+            uint32_t NextPriority();
+            static std::unique_ptr<Node> Merge(std::unique_ptr<Node> A, std::unique_ptr<Node> B);
+            void Split(std::unique_ptr<Node> T, uint64_t Lines, std::unique_ptr<Node>& A, std::unique_ptr<Node>& B);
+            template <typename _TFunc>
+            static void ForEach(Node* T, _TFunc& Func);
+        public:
+            LineRope();
+
+            uint64_t LineCount() const;
+
+            // Finds the segment holding Line; Offset is
+            // the position of Line within it.
+
+            const LineSegment* Find(uint64_t Line, uint64_t& Offset) const;
+
+            void Insert(uint64_t Line, const LineSegment& Segment);
+            void Erase(uint64_t Line, uint64_t Count);
+            void Append(const LineSegment& Segment);
+            void SetHighlight(uint64_t Line, uint64_t Count, bool Highlighted, uint32_t Backcolor);
+            void Clear();
+        };
+    }
+
+    // A read-mostly view of a (possibly huge) UTF-8
+    // text file. The file is memory-mapped and a
+    // background thread indexes line starts; lines are
+    // usable as soon as they are indexed, and only the
+    // lines asked for are ever decoded. Edits and
+    // highlights are kept in a rope on top of the file
+    // and never touch it. Apart from the indexer, a
+    // Document must be used from one thread.
+
+    class Document {
+        static constexpr uint32_t checkpointInterval = 64;
+
+        MappedFile file;
+        std::thread indexer;
+        std::atomic<bool> stopIndexing;
+        std::atomic<bool> indexingComplete;
+        std::atomic<uint64_t> indexedBytes;
+        std::atomic<uint64_t> fileLines;
+        mutable std::mutex checkpointMtx;
+        std::vector<uint64_t> checkpoints; //start of every checkpointInterval-th line
+
+        details::LineRope rope;
+        uint64_t ropeFileEnd; //first file line not yet covered by the rope
+        std::vector<std::wstring> editLines;
+
+        void IndexFunction();
+        bool FileLineRange(uint64_t Line, uint64_t& Start, uint64_t& End) const;
+        bool CoverLines(uint64_t Lines);
+    public:
+        Document();
+        ~Document();
+
+        Document(const Document&) = delete;
+        Document& operator=(const Document&) = delete;
+
+        bool Open(const std::filesystem::path& Path);
+        void Close();
+        bool IsOpen() const;
+
+        // Indexing progress. LineCount() grows until
+        // IndexingComplete() is true.
+
+        bool IndexingComplete() const;
+        uint64_t IndexedBytes() const;
+        uint64_t FileSize() const;
+        uint64_t LineCount() const;
+
+        // Decodes up to MaxColumns characters of Line,
+        // starting at column FirstColumn, into Out, and
+        // returns how many were written. Tabs and other
+        // control characters become spaces; invalid UTF-8
+        // and characters wchar_t cannot hold become
+        // U+FFFD.
+
+        uint32_t DecodeLine(uint64_t Line, uint64_t FirstColumn, wchar_t* Out, uint32_t MaxColumns) const;
+        std::wstring GetLine(uint64_t Line, uint64_t FirstColumn = 0, uint32_t MaxColumns = 0xFFFFFFFF) const;
+        bool LineHighlight(uint64_t Line, uint32_t& Backcolor) const;
+
+        // Edits address document lines (after previous
+        // edits). Lines past what has been indexed can't
+        // be edited yet, and these return false.
+
+        bool InsertLines(uint64_t Line, const std::vector<std::wstring>& Lines);
+        bool DeleteLines(uint64_t Line, uint64_t Count);
+        bool ReplaceLine(uint64_t Line, const std::wstring& Text);
+        bool HighlightLines(uint64_t Line, uint64_t Count, uint32_t Backcolor);
+        bool ClearHighlight(uint64_t Line, uint64_t Count);
+    };
+
+    // Draws the visible part of a Document.
+
+    class DocumentView {
+        Document* document;
+        uint64_t topLine;
+        uint64_t leftColumn;
+        uint32_t textBackcolor;
+        uint32_t textForecolor;
+        std::vector<wchar_t> lineBuffer;
+    public:
+        DocumentView(Document& Doc, uint32_t TextBackcolor = 0xFF000000, uint32_t TextForecolor = 0xFFFFFFFF);
+
+        uint64_t TopLine() const;
+        uint64_t LeftColumn() const;
+        void ScrollTo(uint64_t Line, uint64_t Column = 0);
+        void ScrollBy(int64_t Lines, int64_t Columns = 0);
+
+        void Draw(BufferGrid Buffer, RectU32 Rect);
+    };
+}
+
+#endif // BRENDANTUI_DOCVIEW_H_
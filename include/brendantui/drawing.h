@@ -2,7 +2,10 @@
 #define BRENDANTUI_DRAWING_H_
 
 #include <cstdint>
+#include <string>
+#include <string_view>
 #include <variant>
+#include <vector>
 
 #include "windowbase.h"
 
@@ -142,7 +145,88 @@ namespace btui {
 
     void DrawCanvasInFrame(BufferGrid WindowBuffer, RectU32 FrameRect, BufferGrid Canvas, Align HorizontalAlign, Align VerticalAlign, backgroundFill_t BackgroundFill);
 
+    // Cells only carry a character and two colors, so
+    // text attributes are expressed through the colors.
+
+    enum TextStyleFlags : uint32_t {
+        TextStyleFlagsNone = 0,
+        TextStyleFlagsInverse = 1, //swap forecolor and backcolor
+        TextStyleFlagsDefaultForecolor = 2, //ignore the span's forecolor
+        TextStyleFlagsDefaultBackcolor = 4, //ignore the span's backcolor
+        TextStyleFlagsTransparent = 8 //blend the backcolor over the cell underneath
+    };
+
+    // Styles the characters [start, start + length) of
+    // a string; characters outside every span use the
+    // default colors.
+
+    struct TextSpan {
+        uint32_t start;
+        uint32_t length;
+        uint32_t forecolor;
+        uint32_t backcolor;
+        uint32_t flags;
+
+        constexpr inline TextSpan()
+            : start(0), length(0), forecolor(0xFFFFFFFF), backcolor(0xFF000000), flags(TextStyleFlagsNone) { }
+        constexpr inline TextSpan(uint32_t Start, uint32_t Length, uint32_t Forecolor, uint32_t Backcolor, uint32_t Flags = TextStyleFlagsNone)
+            : start(Start), length(Length), forecolor(Forecolor), backcolor(Backcolor), flags(Flags) { }
+    };
+
+    // Text plus a sorted, non-overlapping array of spans.
+    // Append() merges a run into the previous span when
+    // the style is unchanged.
+
+    struct AttributedText {
+        std::wstring text;
+        std::vector<TextSpan> spans;
+
+        inline void Append(std::wstring_view Text) {
+            text.append(Text);
+        }
+        inline void Append(std::wstring_view Text, uint32_t Forecolor, uint32_t Backcolor, uint32_t Flags = TextStyleFlagsNone) {
+            uint32_t start = (uint32_t)text.size();
+            text.append(Text);
+            if (Text.empty()) return;
+            if (!spans.empty()) {
+                TextSpan& last = spans.back();
+                if (last.start + last.length == start && last.forecolor == Forecolor && last.backcolor == Backcolor && last.flags == Flags) {
+                    last.length += (uint32_t)Text.size();
+                    return;
+                }
+            }
+            spans.emplace_back(start, (uint32_t)Text.size(), Forecolor, Backcolor, Flags);
+        }
+        inline void Clear() {
+            text.clear();
+            spans.clear();
+        }
+    };
+
+    // Text layout runs once per call and spans are
+    // applied while the cells are written, walking the
+    // span array alongside the text, so styling costs
+    // O(spans) on top of the plain layout. Spans must be
+    // sorted by start and must not overlap.
+
     void DrawTextInFrame(BufferGrid WindowBuffer, RectU32 FrameRect, const std::wstring& Text, uint32_t TextBackcolor, uint32_t TextForecolor, Align TextHorizontalAlign, Align TextVerticalAlign, WrapStyle TextWrapStyle, backgroundFill_t BackgroundFill);
+    void DrawTextInFrame(BufferGrid WindowBuffer, RectU32 FrameRect, const AttributedText& Text, uint32_t TextBackcolor, uint32_t TextForecolor, Align TextHorizontalAlign, Align TextVerticalAlign, WrapStyle TextWrapStyle, backgroundFill_t BackgroundFill);
+    void DrawTextInFrame(BufferGrid WindowBuffer, RectU32 FrameRect, std::wstring_view Text, const TextSpan* Spans, size_t SpanCount, uint32_t TextBackcolor, uint32_t TextForecolor, Align TextHorizontalAlign, Align TextVerticalAlign, WrapStyle TextWrapStyle, backgroundFill_t BackgroundFill);
+
+    // The size DrawTextInFrame() lays Text out to in a
+    // frame Width cells wide: its longest line by its
+    // number of lines.
+
+    SizeU32 MeasureTextInFrame(std::wstring_view Text, uint32_t Width, WrapStyle TextWrapStyle);
+
+    // UTF-8 text. It is decoded into a per-thread buffer
+    // that keeps its capacity, so no wide string is
+    // allocated per call; for single unwrapped lines,
+    // DrawUtf8Line() (utf8.h) skips the decoding step
+    // altogether.
+
+    void DrawTextInFrame(BufferGrid WindowBuffer, RectU32 FrameRect, std::string_view Text, uint32_t TextBackcolor, uint32_t TextForecolor, Align TextHorizontalAlign, Align TextVerticalAlign, WrapStyle TextWrapStyle, backgroundFill_t BackgroundFill);
+    void DrawTextInFrame(BufferGrid WindowBuffer, RectU32 FrameRect, std::u8string_view Text, uint32_t TextBackcolor, uint32_t TextForecolor, Align TextHorizontalAlign, Align TextVerticalAlign, WrapStyle TextWrapStyle, backgroundFill_t BackgroundFill);
 
     static inline constexpr wchar_t CharFromConnections(bool Left, bool Right, bool Top, bool Bottom) {
         if (Left)
@@ -194,6 +278,46 @@ namespace btui {
     }
 
     void DrawTableInFrame(BufferGrid WindowBuffer, RectU32 FrameRect, uint32_t ColumnCount, uint32_t RowCount, uint32_t* ColumnWidths, uint32_t* RowHeights, bool* HorizontalBorders, bool* VerticalBorders, uint32_t BorderBackcolor, uint32_t BorderForecolor, backgroundFill_t BackgroundFill);
+
+    // Plain rectangle primitives. Each clips Rect to the
+    // buffer once and then writes whole row runs (one
+    // run when Rect spans full rows), using 48-byte
+    // (four cell) vector stores where available.
+
+    void FillRect(BufferGrid WindowBuffer, RectU32 Rect, BufferGridCell Cell);
+    void ClearRect(BufferGrid WindowBuffer, RectU32 Rect, uint32_t Backcolor = 0xFF000000);
+    void ClearBuffer(BufferGrid WindowBuffer, uint32_t Backcolor = 0xFF000000);
+
+    // Moves the cells of Rect by (Dx, Dy), positive
+    // being right and down, with row-sized memmoves.
+    // Cells moved outside Rect are lost; the strips left
+    // behind are returned (at most two, not overlapping)
+    // and are filled with ExposedFill if it is set, or
+    // keep their old content otherwise, so only they
+    // need repainting.
+
+    struct ScrollExposure {
+        RectU32 rects[2];
+        uint32_t count;
+
+        constexpr inline ScrollExposure()
+            : rects(), count(0) { }
+    };
+
+    ScrollExposure ScrollRegion(BufferGrid WindowBuffer, RectU32 Rect, int32_t Dx, int32_t Dy, backgroundFill_t ExposedFill = std::monostate());
+
+    enum BoxStyle {
+        BoxStyleSingle,
+        BoxStyleDouble,
+        BoxStyleHeavy,
+        BoxStyleRounded
+    };
+
+    // Draws the outline of Rect. A one-cell-high or
+    // one-cell-wide Rect becomes a line. The interior is
+    // only touched if InteriorFill is set.
+
+    void DrawBox(BufferGrid WindowBuffer, RectU32 Rect, BoxStyle Style, uint32_t BorderBackcolor, uint32_t BorderForecolor, backgroundFill_t InteriorFill = std::monostate());
 }
 
 #endif // BRENDANTUI_DRAWING_H_
@@ -0,0 +1,146 @@
+#ifndef BRENDANTUI_FRAMERECORDING_H_
+#define BRENDANTUI_FRAMERECORDING_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+
+#include "mappedfile.h"
+#include "windowbase.h"
+
+namespace btui {
+    // Recording file layout (all integers little-endian,
+    // "varint" is unsigned LEB128):
+    //
+    //   header:  "BTUIREC1"
+    //   records: u8 type, varint payload length, payload
+    //   footer:  u64 offset of the index record, "BTUIIDX1"
+    //
+    // A frame payload starts with a varint time in
+    // microseconds (since recording start for keyframes,
+    // since the previous frame for deltas). Keyframes
+    // then hold the varint width and height and restart
+    // the color table. Next come the colors new to the
+    // table (varint count, u32 each), then runs until
+    // the payload ends: varint cells to skip, varint
+    // (count << 1 | repeat), and either one cell repeated
+    // count times or count cells. A cell is
+    // varint(character << 2 | newForecolor << 1 | newBackcolor)
+    // followed by the new color indices. Keyframes are
+    // diffed against default cells, deltas against the
+    // previous frame.
+    //
+    // The index record is only written on Close(); a
+    // file cut short by a crash is still playable, it
+    // just gets scanned on open.
+
+    enum RecordType : uint8_t {
+        RecordTypeKeyframe = 1,
+        RecordTypeDelta = 2,
+        RecordTypeIndex = 3
+    };
+
+    struct RecordingKeyframe {
+        uint64_t frameIndex;
+        uint64_t offset;
+        uint64_t timeUs;
+
+        constexpr inline RecordingKeyframe()
+            : frameIndex(0), offset(0), timeUs(0) { }
+        constexpr inline RecordingKeyframe(uint64_t FrameIndex, uint64_t Offset, uint64_t TimeUs)
+            : frameIndex(FrameIndex), offset(Offset), timeUs(TimeUs) { }
+    };
+
+    // Appends frames to a recording. Not thread-safe;
+    // WindowBase drives it from the window thread.
+
+    class FrameRecorder {
+        std::ofstream file;
+        std::vector<uint8_t> pending;
+        std::vector<uint8_t> payload;
+        std::vector<uint8_t> cells;
+        uint64_t fileOffset;
+
+        std::vector<BufferGridCell> previous;
+        SizeU32 previousSize;
+        std::unordered_map<uint32_t, uint32_t> colorIndices;
+        std::vector<uint32_t> newColors;
+        std::vector<RecordingKeyframe> keyframes;
+
+        uint64_t frameCount;
+        uint64_t startNs;
+        uint64_t lastFrameUs;
+        uint32_t keyframeInterval;
+        uint32_t framesSinceKeyframe;
+
+        uint32_t InternColor(uint32_t Color);
+        void EncodeCells(const BufferGridCell* Cells, const BufferGridCell* Basis, uint64_t Count, std::vector<uint8_t>& Out);
+        void WriteRecord(RecordType Type, const std::vector<uint8_t>& Payload);
+        void Flush();
+    public:
+        FrameRecorder();
+        ~FrameRecorder();
+
+        FrameRecorder(const FrameRecorder&) = delete;
+        FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+        // A keyframe is forced every KeyframeInterval
+        // frames and whenever the frame size changes.
+
+        bool Open(const std::filesystem::path& Path, uint32_t KeyframeInterval = 600);
+        void Close();
+        bool IsOpen() const;
+
+        void AddFrame(BufferGrid Frame);
+        void AddFrame(BufferGrid Frame, uint64_t TimeNs);
+
+        uint64_t FrameCount() const;
+        uint64_t BytesWritten() const;
+    };
+
+    // Plays a recording back through a read-only
+    // memory mapping. Seeking decodes forward from the
+    // nearest keyframe at or before the target.
+
+    class FramePlayer {
+        MappedFile file;
+        std::vector<RecordingKeyframe> keyframes;
+        uint64_t frameCount;
+
+        std::vector<BufferGridCell> frame;
+        SizeU32 frameSize;
+        std::vector<uint32_t> palette;
+        uint64_t nextOffset;
+        uint64_t currentFrame;
+        uint64_t currentTimeUs;
+
+        bool ReadIndex();
+        void ScanRecords();
+        bool DecodeRecord(uint64_t Offset, uint64_t& NextOffset);
+    public:
+        FramePlayer();
+
+        bool Open(const std::filesystem::path& Path);
+        void Close();
+        bool IsOpen() const;
+
+        uint64_t FrameCount() const;
+        const std::vector<RecordingKeyframe>& Keyframes() const;
+
+        // Frame indices start at 0. After a successful
+        // seek or step, CurrentFrame() points at the
+        // decoded cells (valid until the next call).
+
+        bool SeekToFrame(uint64_t FrameIndex);
+        bool SeekToTime(uint64_t TimeUs);
+        bool NextFrame();
+
+        BufferGrid CurrentFrame();
+        uint64_t CurrentFrameIndex() const;
+        uint64_t CurrentTimeUs() const;
+    };
+}
+
+#endif // BRENDANTUI_FRAMERECORDING_H_
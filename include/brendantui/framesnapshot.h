@@ -0,0 +1,81 @@
+#ifndef BRENDANTUI_FRAMESNAPSHOT_H_
+#define BRENDANTUI_FRAMESNAPSHOT_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "windowbase.h"
+
+namespace btui {
+    namespace details {
+        class FrameSnapshotPool;
+    }
+
+    // One presented frame. Snapshots are handed out as
+    // shared_ptr<const FrameSnapshot> and never change
+    // after being published, so any number of threads
+    // may read one without locking. When the last
+    // reference goes away the storage returns to the
+    // pool it came from.
+
+    class FrameSnapshot {
+        SizeU32 size;
+        uint64_t sequence;
+        uint64_t timeNs;
+        std::unique_ptr<BufferGridCell[]> cells;
+        size_t capacity;
+
+        friend class details::FrameSnapshotPool;
+    public:
+        FrameSnapshot();
+
+        SizeU32 Size() const;
+        uint64_t Sequence() const;
+        uint64_t TimeNs() const;
+
+        const BufferGridCell* Cells() const;
+        BufferGridCell* Cells();
+        const BufferGridCell& At(uint32_t X, uint32_t Y) const;
+
+        // For passing to functions that take a BufferGrid.
+        // The cells must not be written through it once
+        // the snapshot has been published.
+
+        BufferGrid Grid() const;
+    };
+
+    namespace details {
+        // Recycles snapshot storage. Acquire() is called
+        // by the producer; the release side runs on
+        // whichever thread drops the last reference, and
+        // may outlive the pool object itself.
+
+        class FrameSnapshotPool {
+            struct Shared {
+                std::mutex mtx;
+                std::vector<std::unique_ptr<FrameSnapshot>> free;
+                uint32_t maxFree;
+                std::atomic<uint64_t> allocations;
+
+                inline Shared(uint32_t MaxFree)
+                    : maxFree(MaxFree), allocations(0) { }
+            };
+
+            std::shared_ptr<Shared> shared;
+        public:
+            FrameSnapshotPool(uint32_t MaxFree = 4);
+
+            std::shared_ptr<FrameSnapshot> Acquire(SizeU32 Size, uint64_t Sequence, uint64_t TimeNs);
+
+            // Number of times cell storage had to be
+            // allocated rather than reused.
+
+            uint64_t Allocations() const;
+        };
+    }
+}
+
+#endif // BRENDANTUI_FRAMESNAPSHOT_H_
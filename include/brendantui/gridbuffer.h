@@ -0,0 +1,52 @@
+#ifndef BRENDANTUI_GRIDBUFFER_H_
+#define BRENDANTUI_GRIDBUFFER_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "windowbase.h"
+
+namespace btui {
+    // An owned, resizable BufferGrid. Capacity grows
+    // geometrically and never shrinks on its own, so a
+    // live resize that shrinks and regrows the grid
+    // allocates at most a handful of times. Resize()
+    // keeps the overlapping top-left region of the old
+    // content in place; newly exposed cells get Fill.
+
+    class GridBuffer {
+        std::unique_ptr<BufferGridCell[]> cells;
+        size_t capacity;
+        SizeU32 size;
+    public:
+        GridBuffer();
+        GridBuffer(SizeU32 Size, BufferGridCell Fill = BufferGridCell());
+
+        GridBuffer(const GridBuffer&) = delete;
+        GridBuffer& operator=(const GridBuffer&) = delete;
+
+        GridBuffer(GridBuffer&& Other) noexcept;
+        GridBuffer& operator=(GridBuffer&& Other) noexcept;
+
+        // Returns true if new storage had to be
+        // allocated. With PreserveContent false, every
+        // cell is reset to Fill.
+
+        bool Resize(SizeU32 NewSize, bool PreserveContent = true, BufferGridCell Fill = BufferGridCell());
+
+        // Reallocates to exactly the current size.
+
+        void ShrinkToFit();
+        void Release();
+
+        SizeU32 Size() const;
+        size_t Capacity() const;
+        BufferGridCell* Data();
+        const BufferGridCell* Data() const;
+        BufferGrid Grid();
+
+        explicit operator bool() const;
+    };
+}
+
+#endif // BRENDANTUI_GRIDBUFFER_H_
@@ -0,0 +1,112 @@
+#ifndef BRENDANTUI_HEATMAP_H_
+#define BRENDANTUI_HEATMAP_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include "windowbase.h"
+
+namespace btui {
+    enum HeatmapReduce {
+        HeatmapReduceMean,
+        HeatmapReduceMax,
+        HeatmapReduceMin
+    };
+
+    // 256 ARGB colors spread evenly from Low to High.
+
+    struct ColorLut {
+        std::array<uint32_t, 256> colors;
+
+        constexpr inline ColorLut()
+            : colors() { }
+
+        inline uint32_t Map(float Value, float Low, float Scale) const {
+            float index = (Value - Low) * Scale;
+            // Written so NaN lands on 0.
+            return colors[index > 0.0f ? (index < 255.0f ? (uint32_t)(index + 0.5f) : 255) : 0];
+        }
+    };
+
+    // Interpolates linearly (per channel) between evenly
+    // spaced Stops.
+
+    ColorLut MakeColorLut(std::initializer_list<uint32_t> Stops);
+
+    namespace details {
+        struct HeatmapLevel {
+            const float* data;
+            uint32_t width;
+            uint32_t height;
+            size_t stride;
+            uint32_t shift; //log2 of the source cells per level cell, per axis
+
+            constexpr inline HeatmapLevel()
+                : data(0), width(0), height(0), stride(0), shift(0) { }
+            constexpr inline HeatmapLevel(const float* Data, uint32_t Width, uint32_t Height, size_t Stride, uint32_t Shift)
+                : data(Data), width(Width), height(Height), stride(Stride), shift(Shift) { }
+        };
+
+        void DrawHeatmapLevels(BufferGrid Buffer, RectU32 Rect, const HeatmapLevel* Levels, size_t LevelCount, HeatmapReduce Reduce, float ViewX, float ViewY, float ViewWidth, float ViewHeight, float Low, float High, const ColorLut& Lut, uint32_t Backcolor);
+    }
+
+    // Draws the whole Width x Height matrix (row-major,
+    // Stride floats between rows) into Rect. Every cell
+    // shows two matrix blocks, one above the other, as
+    // a half block, and each block is reduced to one
+    // value before it goes through Lut. Values from Low
+    // to High span the LUT.
+    //
+    // This reads the whole matrix; use HeatmapPyramid to
+    // pan and zoom around a large one.
+
+    void DrawHeatmap(BufferGrid Buffer, RectU32 Rect, const float* Data, uint32_t Width, uint32_t Height, size_t Stride, HeatmapReduce Reduce, float Low, float High, const ColorLut& Lut);
+
+    // A mip pyramid over a matrix: level k holds the
+    // matrix reduced 2^k times on each axis (level 0 is
+    // the matrix itself, which is not copied and must
+    // outlive the pyramid). Draw() reads from the
+    // coarsest level that still has a cell per block,
+    // so each block costs a handful of reads whatever
+    // the zoom.
+
+    class HeatmapPyramid {
+        const float* source;
+        uint32_t width;
+        uint32_t height;
+        size_t stride;
+        HeatmapReduce reduce;
+        std::vector<std::vector<float>> storage;
+        std::vector<details::HeatmapLevel> levels;
+
+        void ReduceInto(size_t Level, uint32_t X0, uint32_t Y0, uint32_t X1, uint32_t Y1);
+    public:
+        HeatmapPyramid();
+
+        HeatmapPyramid(const HeatmapPyramid&) = delete;
+        HeatmapPyramid& operator=(const HeatmapPyramid&) = delete;
+
+        void Build(const float* Data, uint32_t Width, uint32_t Height, size_t Stride, HeatmapReduce Reduce);
+
+        // Call after changing the source inside Region
+        // (in matrix cells); only the covering part of
+        // each level is recomputed.
+
+        void Update(RectU32 Region);
+
+        size_t LevelCount() const;
+        SizeU32 Size() const;
+
+        // Draws the part of the matrix starting at
+        // (ViewX, ViewY), ViewWidth x ViewHeight matrix
+        // cells, into Rect. Parts of the view outside the
+        // matrix get Backcolor.
+
+        void Draw(BufferGrid Buffer, RectU32 Rect, float ViewX, float ViewY, float ViewWidth, float ViewHeight, float Low, float High, const ColorLut& Lut, uint32_t Backcolor) const;
+    };
+}
+
+#endif // BRENDANTUI_HEATMAP_H_
@@ -0,0 +1,66 @@
+#ifndef BRENDANTUI_HITTEST_H_
+#define BRENDANTUI_HITTEST_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "windowbase.h"
+
+namespace btui {
+    // A region ID per cell, kept beside the BufferGrid
+    // and filled in by the paint pass alongside the
+    // drawing (later regions cover earlier ones, just
+    // like the cells they are drawn with). Looking up
+    // the region under the mouse is then one array
+    // read, however many regions there are. Region 0
+    // means "nothing".
+    //
+    // It also tracks which region is hovered, so enter
+    // and exit are found by comparing two IDs.
+
+    class HitTestMap {
+        std::unique_ptr<uint32_t[]> ids;
+        size_t capacity;
+        SizeU32 size;
+
+        PointU32 mousePoint;
+        bool mouseInside;
+        uint32_t hovered;
+    public:
+        HitTestMap();
+        HitTestMap(SizeU32 Size);
+
+        HitTestMap(const HitTestMap&) = delete;
+        HitTestMap& operator=(const HitTestMap&) = delete;
+
+        // Resize() clears every region; call it (or
+        // Clear()) at the start of a full repaint.
+
+        void Resize(SizeU32 NewSize);
+        void Clear();
+        SizeU32 Size() const;
+
+        void SetRegion(RectU32 Rect, uint32_t Region);
+        void ClearRegion(RectU32 Rect);
+
+        // Zero outside the map.
+
+        uint32_t At(uint32_t X, uint32_t Y) const;
+        uint32_t At(PointU32 Point) const;
+
+        // Hover tracking. Each of these returns true if
+        // the hovered region changed, with the regions
+        // left and entered (either may be 0). Call
+        // MouseMove() from OnMouseMove(), MouseExit()
+        // from OnMouseExit(), and Recheck() after a paint
+        // that may have moved regions under a still
+        // mouse.
+
+        bool MouseMove(PointU32 Point, uint32_t& Exited, uint32_t& Entered);
+        bool MouseExit(uint32_t& Exited);
+        bool Recheck(uint32_t& Exited, uint32_t& Entered);
+        uint32_t Hovered() const;
+    };
+}
+
+#endif // BRENDANTUI_HITTEST_H_
@@ -0,0 +1,110 @@
+#ifndef BRENDANTUI_IMAGE_H_
+#define BRENDANTUI_IMAGE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "drawing.h"
+#include "windowbase.h"
+
+namespace btui {
+    // RGBA pixels, 4 bytes each in R, G, B, A order,
+    // Stride bytes between rows.
+
+    struct ImageView {
+        const uint8_t* pixels;
+        uint32_t width;
+        uint32_t height;
+        size_t stride;
+
+        constexpr inline ImageView()
+            : pixels(0), width(0), height(0), stride(0) { }
+        constexpr inline ImageView(const uint8_t* Pixels, uint32_t Width, uint32_t Height)
+            : pixels(Pixels), width(Width), height(Height), stride((size_t)Width * 4) { }
+        constexpr inline ImageView(const uint8_t* Pixels, uint32_t Width, uint32_t Height, size_t Stride)
+            : pixels(Pixels), width(Width), height(Height), stride(Stride) { }
+    };
+
+    namespace details {
+        // The source pixels one output pixel covers along
+        // an axis, with their coverage (summing to 1) at
+        // weights[weightIndex...].
+
+        struct ImageTap {
+            uint32_t first;
+            uint32_t count;
+            uint32_t weightIndex;
+
+            constexpr inline ImageTap()
+                : first(0), count(0), weightIndex(0) { }
+            constexpr inline ImageTap(uint32_t First, uint32_t Count, uint32_t WeightIndex)
+                : first(First), count(Count), weightIndex(WeightIndex) { }
+        };
+
+        struct ImageAxis {
+            std::vector<ImageTap> taps;
+            std::vector<float> weights;
+
+            void Map(uint32_t SourceLength, uint32_t OutputLength);
+        };
+
+        // Where an image lands in a frame: Pixels is the
+        // scaled image size (one pixel per column, two per
+        // row), and Mapping places the cells holding it.
+
+        struct ImagePlacement {
+            SizeU32 pixels;
+            CanvasIntoFrameMappingInfo mapping;
+
+            constexpr inline ImagePlacement()
+                : pixels(), mapping() { }
+        };
+
+        ImagePlacement PlaceImage(SizeU32 ImageSize, SizeU32 FrameSize, Align HorizontalAlign, Align VerticalAlign);
+    }
+
+    // Draws Image into Rect, scaled (area-averaged) to
+    // the largest size that fits with its aspect ratio
+    // kept, assuming cells twice as tall as they are
+    // wide. Each cell is an upper half block with the
+    // top pixel as forecolor and the bottom one as
+    // backcolor. The image is placed in Rect by the
+    // aligns, and the rest of Rect gets Backcolor.
+
+    void DrawImage(BufferGrid Buffer, RectU32 Rect, ImageView Image, Align HorizontalAlign, Align VerticalAlign, uint32_t Backcolor);
+
+    // Draws a stream of frames like DrawImage(), but
+    // keeps the previous frame and only rewrites cells
+    // whose source block changed since. The rest of the
+    // buffer must be left as the last Draw() wrote it;
+    // call Invalidate() if it wasn't. A change of frame
+    // size, Rect or alignment redraws everything.
+
+    class ImageRenderer {
+        std::vector<uint8_t> previous;
+        SizeU32 previousSize;
+        RectU32 previousRect;
+        SizeU32 previousBufferSize;
+        Align horizontalAlign;
+        Align verticalAlign;
+        uint32_t backcolor;
+        bool valid;
+
+        details::ImagePlacement placement;
+        details::ImageAxis columns;
+        details::ImageAxis rows;
+        std::vector<uint32_t> dirtyLow; //per source row, first changed pixel
+        std::vector<uint32_t> dirtyHigh; //per source row, one past the last
+    public:
+        ImageRenderer();
+
+        void Invalidate();
+
+        // Returns the number of cells written.
+
+        size_t Draw(BufferGrid Buffer, RectU32 Rect, ImageView Image, Align HorizontalAlign, Align VerticalAlign, uint32_t Backcolor);
+    };
+}
+
+#endif // BRENDANTUI_IMAGE_H_
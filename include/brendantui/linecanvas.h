@@ -0,0 +1,98 @@
+﻿#ifndef BRENDANTUI_LINECANVAS_H_
+#define BRENDANTUI_LINECANVAS_H_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "windowbase.h"
+
+namespace btui {
+    enum LineConnection : uint8_t {
+        LineConnectionLeft = 1,
+        LineConnectionRight = 2,
+        LineConnectionTop = 4,
+        LineConnectionBottom = 8
+    };
+
+    enum LineWeight : uint8_t {
+        LineWeightLight,
+        LineWeightHeavy,
+        LineWeightDouble
+    };
+
+    namespace details {
+        // Box-drawing glyphs indexed by
+        // Weight * 16 + connection mask. Double lines have
+        // no half-line glyphs, so a lone stub is drawn as
+        // the full line.
+
+        inline constexpr std::array<wchar_t, 48> lineGlyphs = {
+            L' ', L'╴', L'╶', L'─', L'╵', L'┘', L'└', L'┴', L'╷', L'┐', L'┌', L'┬', L'│', L'┤', L'├', L'┼',
+            L' ', L'╸', L'╺', L'━', L'╹', L'┛', L'┗', L'┻', L'╻', L'┓', L'┏', L'┳', L'┃', L'┫', L'┣', L'╋',
+            L' ', L'═', L'═', L'═', L'║', L'╝', L'╚', L'╩', L'║', L'╗', L'╔', L'╦', L'║', L'╣', L'╠', L'╬'
+        };
+    }
+
+    static inline constexpr wchar_t LineGlyph(uint8_t Connections, LineWeight Weight) {
+        return details::lineGlyphs[(size_t)Weight * 16 + (Connections & 15)];
+    }
+
+    // A layer of line strokes. Each cell keeps a mask of
+    // the directions lines leave it in, and strokes are
+    // ORed in, so crossing and touching borders (nested
+    // panels, separators, several tables) join up no
+    // matter the order they are drawn in. Glyphs are
+    // looked up once, in Resolve(). Where strokes of
+    // different weights meet, the heavier one (double
+    // over heavy over light) and the colors of the last
+    // stroke win.
+
+    class LineCanvas {
+        struct Cell {
+            uint8_t connections;
+            LineWeight weight;
+            uint32_t backcolor;
+            uint32_t forecolor;
+
+            constexpr inline Cell()
+                : connections(0), weight(LineWeightLight), backcolor(0), forecolor(0) { }
+        };
+
+        std::vector<Cell> cells;
+        SizeU32 size;
+        RectU32 touched; //bounds of every cell with a connection
+
+        void Connect(uint32_t X, uint32_t Y, uint8_t Connections, LineWeight Weight, uint32_t Backcolor, uint32_t Forecolor);
+    public:
+        LineCanvas();
+        LineCanvas(SizeU32 Size);
+
+        // Both drop every stroke.
+
+        void Resize(SizeU32 NewSize);
+        void Clear();
+        SizeU32 Size() const;
+
+        // Length is in cells, including both ends; parts
+        // outside the canvas are clipped.
+
+        void HorizontalLine(uint32_t X, uint32_t Y, uint32_t Length, LineWeight Weight, uint32_t Backcolor, uint32_t Forecolor);
+        void VerticalLine(uint32_t X, uint32_t Y, uint32_t Length, LineWeight Weight, uint32_t Backcolor, uint32_t Forecolor);
+        void Box(RectU32 Rect, LineWeight Weight, uint32_t Backcolor, uint32_t Forecolor);
+
+        // Table borders, laid out like DrawTableInFrame():
+        // column and row sizes exclude the borders, and
+        // every border is drawn.
+
+        void Grid(PointU32 Origin, const uint32_t* ColumnWidths, uint32_t ColumnCount, const uint32_t* RowHeights, uint32_t RowCount, LineWeight Weight, uint32_t Backcolor, uint32_t Forecolor);
+
+        // Writes the glyph of every cell holding a line
+        // into Buffer (the canvas's top-left at the
+        // buffer's top-left); other cells are left alone.
+
+        void Resolve(BufferGrid Buffer) const;
+    };
+}
+
+#endif // BRENDANTUI_LINECANVAS_H_
@@ -0,0 +1,38 @@
+#ifndef BRENDANTUI_MAPPEDFILE_H_
+#define BRENDANTUI_MAPPEDFILE_H_
+
+#include <cstdint>
+#include <filesystem>
+
+namespace btui {
+    // A read-only memory mapping of a whole file.
+
+    class MappedFile {
+        const uint8_t* data;
+        uint64_t size;
+#ifdef _WIN32
+        void* fileHandle;
+        void* mappingHandle;
+#else
+        int fileDescriptor;
+#endif
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        MappedFile(MappedFile&& Other) noexcept;
+        MappedFile& operator=(MappedFile&& Other) noexcept;
+
+        bool Open(const std::filesystem::path& Path);
+        void Close();
+
+        bool IsOpen() const;
+        const uint8_t* Data() const;
+        uint64_t Size() const;
+    };
+}
+
+#endif // BRENDANTUI_MAPPEDFILE_H_
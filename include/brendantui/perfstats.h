@@ -0,0 +1,166 @@
+#ifndef BRENDANTUI_PERFSTATS_H_
+#define BRENDANTUI_PERFSTATS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace btui {
+    enum EventType {
+        EventTypeKeyPress,
+        EventTypeMouseDown,
+        EventTypeMouseUp,
+        EventTypeMouseMove,
+        EventTypeMouseEnter,
+        EventTypeMouseExit,
+        EventTypeMouseScroll,
+        EventTypeTextInput,
+        EventTypeFocusGained,
+        EventTypeFocusLost,
+        EventTypeCloseRequest,
+        EventTypeDisposed,
+        EventTypeWindowStateChange,
+        EventTypeResize,
+        EventTypeResizeComplete,
+        EventTypeFileDrop,
+        EventTypeCount
+    };
+
+    static constexpr inline const char* EventTypeName(EventType Type) {
+        constexpr const char* names[EventTypeCount] = {
+            "OnKeyPress",
+            "OnMouseDown",
+            "OnMouseUp",
+            "OnMouseMove",
+            "OnMouseEnter",
+            "OnMouseExit",
+            "OnMouseScroll",
+            "OnTextInput",
+            "OnFocusGained",
+            "OnFocusLost",
+            "OnCloseRequest",
+            "OnDisposed",
+            "OnWindowStateChange",
+            "OnResize",
+            "OnResizeComplete",
+            "OnFileDrop"
+        };
+        return (uint32_t)Type < EventTypeCount ? names[Type] : "Unknown";
+    }
+
+    // Count, total and max cover everything since the
+    // last reset; the percentiles cover roughly the
+    // last 5-10 seconds, and are upper bounds within
+    // about 25%.
+
+    struct DurationSummary {
+        uint64_t count;
+        uint64_t totalNs;
+        uint64_t maxNs;
+        uint64_t p50Ns;
+        uint64_t p99Ns;
+
+        constexpr inline DurationSummary()
+            : count(0), totalNs(0), maxNs(0), p50Ns(0), p99Ns(0) { }
+    };
+
+    struct WindowStats {
+        uint64_t paintCount;
+        DurationSummary paintTime; //all of WM_PAINT, including present
+        DurationSummary paintBufferTime; //time spent in PaintBuffer()
+        DurationSummary rasterizeTime; //time spent turning cells into pixels
+        uint64_t cellsChanged; //total over all paints
+        uint64_t lastPaintCellsChanged;
+        uint64_t bufferReallocations;
+
+        uint64_t taskQueueDepth; //tasks waiting right now
+        uint64_t taskQueueMaxDepth;
+        DurationSummary taskWaitTime; //queue to completion, as seen by the caller of InvokeOnWindowThread
+
+        // Only used while events are handled on a
+        // WorkerPool (see WindowBase::UseEventWorkers()).
+
+        uint64_t eventQueueDepth; //events waiting for their handler right now
+        uint64_t eventQueueMaxDepth;
+        uint64_t eventBacklogs; //times the depth rose past the backlog threshold
+        DurationSummary eventWaitTime; //from the window thread queuing an event to its handler starting
+
+        uint64_t eventCounts[EventTypeCount];
+
+        constexpr inline WindowStats()
+            : paintCount(0), paintTime(), paintBufferTime(), rasterizeTime(), cellsChanged(0), lastPaintCellsChanged(0), bufferReallocations(0), taskQueueDepth(0), taskQueueMaxDepth(0), taskWaitTime(), eventQueueDepth(0), eventQueueMaxDepth(0), eventBacklogs(0), eventWaitTime(), eventCounts() { }
+    };
+
+    namespace details {
+        inline uint64_t NowNs() {
+            return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        // Log-linear histogram (four buckets per power of
+        // two) over two alternating time windows. Writers
+        // only do relaxed atomic increments; whichever
+        // writer first sees a new window clears the stale
+        // one.
+
+        class RollingHistogram {
+            static constexpr uint32_t bucketCount = 256;
+            static constexpr uint64_t windowNs = 5000000000ull;
+
+            std::atomic<uint32_t> buckets[2][bucketCount];
+            std::atomic<uint64_t> windowEpoch;
+            std::atomic<uint64_t> count;
+            std::atomic<uint64_t> totalNs;
+            std::atomic<uint64_t> maxNs;
+
+            static uint32_t BucketIndex(uint64_t Ns);
+            static uint64_t BucketUpperBound(uint32_t Index);
+            void ClearWindow(uint32_t Window);
+        public:
+            RollingHistogram();
+
+            void Record(uint64_t DurationNs, uint64_t EndNs);
+            DurationSummary Summarize(uint64_t NowNs) const;
+            void Reset();
+        };
+
+        // The live counters behind WindowStats. Every
+        // member may be updated and read from any thread.
+
+        struct WindowCounters {
+            std::atomic<uint64_t> paintCount;
+            RollingHistogram paintTime;
+            RollingHistogram paintBufferTime;
+            RollingHistogram rasterizeTime;
+            std::atomic<uint64_t> cellsChanged;
+            std::atomic<uint64_t> lastPaintCellsChanged;
+            std::atomic<uint64_t> bufferReallocations;
+
+            std::atomic<uint64_t> taskQueueDepth;
+            std::atomic<uint64_t> taskQueueMaxDepth;
+            RollingHistogram taskWaitTime;
+
+            std::atomic<uint64_t> eventQueueDepth;
+            std::atomic<uint64_t> eventQueueMaxDepth;
+            std::atomic<uint64_t> eventBacklogs;
+            RollingHistogram eventWaitTime;
+
+            std::atomic<uint64_t> eventCounts[EventTypeCount];
+
+            WindowCounters();
+
+            inline void CountEvent(EventType Type) {
+                eventCounts[Type].fetch_add(1, std::memory_order_relaxed);
+            }
+            void TaskQueued();
+            void TaskDequeued();
+            void EventQueued(uint64_t BacklogThreshold);
+            void EventDequeued();
+            void PaintFinished(uint64_t ChangedCells);
+
+            WindowStats Snapshot() const;
+            void Reset();
+        };
+    }
+}
+
+#endif // BRENDANTUI_PERFSTATS_H_
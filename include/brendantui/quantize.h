@@ -0,0 +1,83 @@
+#ifndef BRENDANTUI_QUANTIZE_H_
+#define BRENDANTUI_QUANTIZE_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "windowbase.h"
+
+namespace btui {
+    enum ColorTarget {
+        ColorTarget16,
+        ColorTarget256
+    };
+
+    namespace details {
+        // Top 5 bits of each channel of an ARGB color.
+
+        constexpr inline uint32_t QuantizeCubeIndex(uint32_t Color) {
+            return ((Color >> 9) & 0x7C00) | ((Color >> 6) & 0x3E0) | ((Color >> 3) & 0x1F);
+        }
+    }
+
+    // The xterm palettes: the 16 ANSI colors (xterm's
+    // defaults), and those followed by the 6x6x6 color
+    // cube and the 24-step gray ramp.
+
+    const std::array<uint32_t, 16>& Ansi16Palette();
+    const std::array<uint32_t, 256>& Xterm256Palette();
+
+    // Maps ARGB colors to the nearest entry of a palette
+    // of up to 256 colors through a 32x32x32 lookup cube
+    // built once, so a lookup is a single load. For
+    // ColorTarget256, only entries 16 to 255 are matched,
+    // since terminals theme the first 16.
+    //
+    // Ordered dithering (4x4 Bayer) nudges each channel
+    // by up to about half the distance between palette
+    // neighbours, which turns banding in gradients into
+    // a fine pattern.
+
+    class ColorQuantizer {
+        std::unique_ptr<uint8_t[]> cube;
+        std::array<uint32_t, 256> palette;
+        uint32_t paletteSize;
+        std::array<int32_t, 16> ditherOffsets;
+
+        void Build(const uint32_t* Palette, uint32_t Count, uint32_t FirstMatched);
+    public:
+        ColorQuantizer(ColorTarget Target);
+        ColorQuantizer(const uint32_t* Palette, uint32_t Count);
+
+        uint32_t PaletteSize() const;
+        const uint32_t* Palette() const;
+
+        inline uint8_t Index(uint32_t Color) const {
+            return cube[details::QuantizeCubeIndex(Color)];
+        }
+        uint8_t IndexDithered(uint32_t Color, uint32_t X, uint32_t Y) const;
+
+        // The palette color, with Color's alpha.
+
+        inline uint32_t Quantize(uint32_t Color) const {
+            return (palette[Index(Color)] & 0x00FFFFFF) | (Color & 0xFF000000);
+        }
+
+        // Writes the palette index of every cell's
+        // forecolor and backcolor. Runs of one color,
+        // the common case, skip the lookup.
+
+        void Map(const BufferGridCell* Cells, size_t Count, uint8_t* Forecolors, uint8_t* Backcolors) const;
+        void MapDithered(BufferGrid Buffer, uint8_t* Forecolors, uint8_t* Backcolors) const;
+
+        // Replaces every color in Buffer with its palette
+        // color, e.g. to preview what a terminal with this
+        // palette will show.
+
+        void Apply(BufferGrid Buffer, bool Dither = false) const;
+    };
+}
+
+#endif // BRENDANTUI_QUANTIZE_H_
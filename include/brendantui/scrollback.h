@@ -0,0 +1,127 @@
+#ifndef BRENDANTUI_SCROLLBACK_H_
+#define BRENDANTUI_SCROLLBACK_H_
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "windowbase.h"
+
+namespace btui {
+    namespace details {
+        // A line handed over by a producer, text stored
+        // inline after the header.
+
+        struct PendingLine {
+            PendingLine* next;
+            uint32_t length;
+            uint32_t forecolor;
+
+            inline wchar_t* Text() {
+                return reinterpret_cast<wchar_t*>(this + 1);
+            }
+        };
+
+        struct ScrollbackLine {
+            uint32_t offset;
+            uint32_t length;
+            uint32_t forecolor;
+
+            constexpr inline ScrollbackLine()
+                : offset(0), length(0), forecolor(0) { }
+            constexpr inline ScrollbackLine(uint32_t Offset, uint32_t Length, uint32_t Forecolor)
+                : offset(Offset), length(Length), forecolor(Forecolor) { }
+        };
+
+        struct ScrollbackChunk {
+            std::unique_ptr<wchar_t[]> text;
+            uint32_t capacity;
+            uint32_t used;
+            std::vector<ScrollbackLine> lines;
+            uint64_t rows;
+
+            ScrollbackChunk(uint32_t Capacity, uint32_t LineCapacity);
+
+            size_t Bytes() const;
+        };
+    }
+
+    // An append-only, hard-wrapped log pane. Any thread
+    // may Append() without locking; lines are moved into
+    // a ring of fixed-size chunks when the pane is drawn,
+    // and the oldest chunks are dropped once the ring
+    // holds more than ByteCap bytes. A chunk ends when
+    // its text or its line table is full, each sized
+    // to about an eighth of ByteCap, so the cap holds
+    // however short the lines are. Lines longer
+    // than half of ByteCap are cut. Wrapping is
+    // per-character, so a line's row count is known in
+    // O(1) and a width change never rescans text.
+
+    class Scrollback {
+        static constexpr uint32_t chunkChars = 1 << 15;
+        static constexpr uint32_t chunkLines = 4096;
+
+        std::atomic<details::PendingLine*> pending;
+        std::atomic<uint64_t> pendingBytes;
+
+        std::mutex ringMtx;
+        std::deque<details::ScrollbackChunk> chunks;
+        size_t byteCap;
+        uint32_t chunkTextCapacity;
+        uint32_t chunkLineCapacity;
+        uint32_t maxLineLength;
+        size_t ringBytes;
+        uint64_t totalRows;
+        uint64_t droppedLines;
+        uint64_t lineCount;
+        uint32_t wrapWidth;
+        uint64_t scrollRows; //rows between the bottom of the view and the newest row
+
+        uint32_t textBackcolor;
+        uint32_t textForecolor;
+
+        static inline uint64_t RowsFor(uint32_t Length, uint32_t Width) {
+            return Length ? (Length + Width - 1) / Width : 1;
+        }
+        void DrainLocked();
+        void Ingest(details::PendingLine* Line);
+        void Rewrap(uint32_t Width);
+        void Trim();
+    public:
+        Scrollback(size_t ByteCap = 64 << 20, uint32_t TextBackcolor = 0xFF000000, uint32_t TextForecolor = 0xFFFFFFFF);
+        ~Scrollback();
+
+        Scrollback(const Scrollback&) = delete;
+        Scrollback& operator=(const Scrollback&) = delete;
+
+        // Thread-safe and lock-free, except when the
+        // backlog that has not been drawn yet exceeds
+        // the byte cap; then the caller drains it.
+
+        void Append(std::wstring_view Line);
+        void Append(std::wstring_view Line, uint32_t Forecolor);
+
+        // The remaining functions belong to the thread
+        // that draws the pane.
+
+        void Drain();
+        void Clear();
+
+        uint64_t LineCount();
+        uint64_t DroppedLines();
+        size_t MemoryBytes();
+
+        void ScrollBy(int64_t Rows);
+        void ScrollToBottom();
+        bool AtBottom();
+
+        void Draw(BufferGrid Buffer, RectU32 Rect);
+    };
+}
+
+#endif // BRENDANTUI_SCROLLBACK_H_
@@ -0,0 +1,14 @@
+#ifndef BRENDANTUI_SIMD_H_
+#define BRENDANTUI_SIMD_H_
+
+// SSE2 is part of every x86-64 target, so the vector
+// paths only need a scalar fallback for other
+// architectures. Define BTUI_NO_SIMD to force the
+// scalar code (e.g. to compare results).
+
+#if !defined(BTUI_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define BTUI_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#endif // BRENDANTUI_SIMD_H_
@@ -0,0 +1,224 @@
+﻿#ifndef BRENDANTUI_STATICTABLE_H_
+#define BRENDANTUI_STATICTABLE_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "drawing.h"
+#include "windowbase.h"
+
+namespace btui {
+    // The compile-time counterpart of
+    // DrawTableInFrame()'s arguments, with the same
+    // border layout: HorizontalBorders holds
+    // (RowCount + 1) * ColumnCount entries and
+    // VerticalBorders RowCount * (ColumnCount + 1).
+
+    template <size_t _ColumnCount, size_t _RowCount>
+    struct StaticTableSpec {
+        std::array<uint32_t, _ColumnCount> columnWidths;
+        std::array<uint32_t, _RowCount> rowHeights;
+        std::array<bool, (_RowCount + 1) * _ColumnCount> horizontalBorders;
+        std::array<bool, _RowCount * (_ColumnCount + 1)> verticalBorders;
+    };
+
+    // A spec with every border drawn.
+
+    template <size_t _ColumnCount, size_t _RowCount>
+    constexpr StaticTableSpec<_ColumnCount, _RowCount> MakeStaticTableSpec(const std::array<uint32_t, _ColumnCount>& ColumnWidths, const std::array<uint32_t, _RowCount>& RowHeights) {
+        StaticTableSpec<_ColumnCount, _RowCount> spec = { ColumnWidths, RowHeights, { }, { } };
+        spec.horizontalBorders.fill(true);
+        spec.verticalBorders.fill(true);
+        return spec;
+    }
+
+    namespace details {
+        struct StaticTableGlyph {
+            uint32_t x;
+            uint32_t y;
+            wchar_t glyph;
+        };
+        struct StaticTableRun {
+            uint32_t x;
+            uint32_t y;
+            uint32_t length;
+        };
+    }
+
+    // A table whose shape is fixed at compile time.
+    // The border glyph of every cell, the runs of cells
+    // between borders and the cell rects are all worked
+    // out during compilation, so Draw() is a copy of
+    // the border cells plus a fill of the rest; it
+    // draws the same thing DrawTableInFrame() would for
+    // the same spec.
+    //
+    //     static constexpr auto spec = MakeStaticTableSpec<2, 3>({ 10, 20 }, { 1, 1, 1 });
+    //     StaticTableLayout<spec>::Draw(buffer, frame, 0xFF000000, 0xFFFFFFFF, fill);
+
+    template <auto _Spec>
+    class StaticTableLayout {
+        static constexpr size_t columnCount = _Spec.columnWidths.size();
+        static constexpr size_t rowCount = _Spec.rowHeights.size();
+
+        static constexpr uint32_t SumTracks(const auto& Tracks) {
+            uint32_t total = 1;
+            for (uint32_t track : Tracks) total += track + 1;
+            return total;
+        }
+
+        static constexpr uint32_t tableWidth = SumTracks(_Spec.columnWidths);
+        static constexpr uint32_t tableHeight = SumTracks(_Spec.rowHeights);
+
+        // Marks each column (or row) position as either
+        // the index of the border on it, or ~0 between
+        // borders, and the track a position between
+        // borders belongs to.
+
+        template <size_t _Length>
+        static constexpr std::array<uint32_t, _Length> BorderIndices(const auto& Tracks) {
+            std::array<uint32_t, _Length> out = { };
+            uint32_t position = 0;
+            for (size_t i = 0; i <= Tracks.size(); ++i) {
+                out[position++] = (uint32_t)i;
+                if (i < Tracks.size())
+                    for (uint32_t j = 0; j < Tracks[i]; ++j) out[position++] = ~0u;
+            }
+            return out;
+        }
+        template <size_t _Length>
+        static constexpr std::array<uint32_t, _Length> TrackIndices(const auto& Tracks) {
+            std::array<uint32_t, _Length> out = { };
+            uint32_t position = 0;
+            for (size_t i = 0; i <= Tracks.size(); ++i) {
+                out[position++] = (uint32_t)i;
+                if (i < Tracks.size())
+                    for (uint32_t j = 0; j < Tracks[i]; ++j) out[position++] = (uint32_t)i;
+            }
+            return out;
+        }
+
+        static constexpr auto columnBorders = BorderIndices<tableWidth>(_Spec.columnWidths);
+        static constexpr auto rowBorders = BorderIndices<tableHeight>(_Spec.rowHeights);
+        static constexpr auto columnTracks = TrackIndices<tableWidth>(_Spec.columnWidths);
+        static constexpr auto rowTracks = TrackIndices<tableHeight>(_Spec.rowHeights);
+
+        static constexpr wchar_t GlyphAt(uint32_t X, uint32_t Y) {
+            uint32_t columnBorder = columnBorders[X];
+            uint32_t rowBorder = rowBorders[Y];
+            const auto& horizontal = _Spec.horizontalBorders;
+            const auto& vertical = _Spec.verticalBorders;
+
+            if (rowBorder != ~0u && columnBorder != ~0u) {
+                bool left = columnBorder && horizontal[rowBorder * columnCount + columnBorder - 1];
+                bool right = columnBorder < columnCount && horizontal[rowBorder * columnCount + columnBorder];
+                bool top = rowBorder && vertical[(rowBorder - 1) * (columnCount + 1) + columnBorder];
+                bool bottom = rowBorder < rowCount && vertical[rowBorder * (columnCount + 1) + columnBorder];
+                return left || right || top || bottom ? CharFromConnections(left, right, top, bottom) : 0;
+            }
+            if (rowBorder != ~0u)
+                return horizontal[rowBorder * columnCount + columnTracks[X]] ? L'─' : 0;
+            if (columnBorder != ~0u)
+                return vertical[rowTracks[Y] * (columnCount + 1) + columnBorder] ? L'│' : 0;
+            return 0;
+        }
+
+        static constexpr size_t CountGlyphs() {
+            size_t count = 0;
+            for (uint32_t y = 0; y < tableHeight; ++y)
+            for (uint32_t x = 0; x < tableWidth; ++x)
+                if (GlyphAt(x, y)) ++count;
+            return count;
+        }
+        static constexpr size_t CountRuns() {
+            size_t count = 0;
+            for (uint32_t y = 0; y < tableHeight; ++y)
+            for (uint32_t x = 0; x < tableWidth; ++x)
+                if (!GlyphAt(x, y) && (!x || GlyphAt(x - 1, y))) ++count;
+            return count;
+        }
+
+        static constexpr size_t glyphCount = CountGlyphs();
+        static constexpr size_t runCount = CountRuns();
+
+        static constexpr std::array<details::StaticTableGlyph, glyphCount> BuildGlyphs() {
+            std::array<details::StaticTableGlyph, glyphCount> out = { };
+            size_t i = 0;
+            for (uint32_t y = 0; y < tableHeight; ++y)
+            for (uint32_t x = 0; x < tableWidth; ++x)
+                if (wchar_t glyph = GlyphAt(x, y)) out[i++] = { x, y, glyph };
+            return out;
+        }
+        static constexpr std::array<details::StaticTableRun, runCount> BuildRuns() {
+            std::array<details::StaticTableRun, runCount> out = { };
+            size_t i = 0;
+            for (uint32_t y = 0; y < tableHeight; ++y)
+            for (uint32_t x = 0; x < tableWidth; ++x) {
+                if (GlyphAt(x, y)) continue;
+                if (x && !GlyphAt(x - 1, y)) ++out[i - 1].length;
+                else out[i++] = { x, y, 1 };
+            }
+            return out;
+        }
+        static constexpr std::array<RectU32, columnCount * rowCount> BuildCellRects() {
+            std::array<RectU32, columnCount * rowCount> out = { };
+            uint32_t y = 1;
+            for (size_t row = 0; row < rowCount; ++row) {
+                uint32_t x = 1;
+                for (size_t column = 0; column < columnCount; ++column) {
+                    out[row * columnCount + column] = RectU32(x, y, _Spec.columnWidths[column], _Spec.rowHeights[row]);
+                    x += _Spec.columnWidths[column] + 1;
+                }
+                y += _Spec.rowHeights[row] + 1;
+            }
+            return out;
+        }
+
+        static constexpr auto glyphs = BuildGlyphs();
+        static constexpr auto runs = BuildRuns();
+        static constexpr auto cellRects = BuildCellRects();
+    public:
+        static constexpr SizeU32 Size() {
+            return SizeU32(tableWidth, tableHeight);
+        }
+
+        // The interior of a cell, relative to the
+        // table's top-left corner.
+
+        static constexpr RectU32 CellRect(uint32_t Column, uint32_t Row) {
+            return cellRects[(size_t)Row * columnCount + Column];
+        }
+
+        // The table is drawn at FrameRect's top-left and
+        // clipped to it.
+
+        static void Draw(BufferGrid WindowBuffer, RectU32 FrameRect, uint32_t BorderBackcolor, uint32_t BorderForecolor, backgroundFill_t BackgroundFill) {
+            if (FrameRect.x >= WindowBuffer.width || FrameRect.y >= WindowBuffer.height) return;
+            uint32_t visibleWidth = std::min({ FrameRect.width, WindowBuffer.width - FrameRect.x, tableWidth });
+            uint32_t visibleHeight = std::min({ FrameRect.height, WindowBuffer.height - FrameRect.y, tableHeight });
+            if (!visibleWidth || !visibleHeight) return;
+
+            BufferGridCell* origin = WindowBuffer.buffer + (size_t)FrameRect.y * WindowBuffer.width + FrameRect.x;
+            for (const details::StaticTableGlyph& glyph : glyphs) {
+                if (glyph.y >= visibleHeight) break;
+                if (glyph.x < visibleWidth)
+                    origin[(size_t)glyph.y * WindowBuffer.width + glyph.x] = BufferGridCell(glyph.glyph, BorderForecolor, BorderBackcolor);
+            }
+
+            // Resolved once rather than per run.
+            const BufferGridCell* fillCell = std::get_if<BufferGridCell>(&BackgroundFill);
+            for (const details::StaticTableRun& run : runs) {
+                if (run.y >= visibleHeight) break;
+                if (run.x >= visibleWidth) continue;
+                uint32_t length = std::min(run.length, visibleWidth - run.x);
+                BufferGridCell* cells = origin + (size_t)run.y * WindowBuffer.width + run.x;
+                if (fillCell) std::fill_n(cells, length, *fillCell);
+                else for (uint32_t i = 0; i < length; ++i) OverwriteWithBackgroundFill(cells[i], BackgroundFill);
+            }
+        }
+    };
+}
+
+#endif // BRENDANTUI_STATICTABLE_H_
@@ -0,0 +1,76 @@
+#ifndef BRENDANTUI_TEXTSEARCH_H_
+#define BRENDANTUI_TEXTSEARCH_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "drawing.h"
+
+namespace btui {
+    // Incremental find-as-you-type over a text buffer.
+    // Candidates come from a vectorized filter on the
+    // query's first and last characters and are then
+    // verified. Extending the query by typing only
+    // re-checks the previous matches; deleting back to
+    // an earlier query restores its saved results. The
+    // scan can be spread over several frames with
+    // Continue(), and matches found so far are usable
+    // while it runs.
+    //
+    // Matches may overlap. The text is not copied and
+    // must stay valid and unchanged until SetText() is
+    // called again.
+
+    class TextSearch {
+        struct SavedResult {
+            size_t queryLength;
+            size_t scanPosition;
+            std::vector<size_t> matches;
+        };
+
+        std::wstring_view text;
+        std::wstring query;
+        std::wstring foldedQuery;
+        bool caseSensitive;
+        std::vector<size_t> matches;
+        size_t scanPosition; //first start position not scanned yet
+        std::vector<SavedResult> history;
+
+        static wchar_t FoldCase(wchar_t C);
+        bool Verify(size_t Position, size_t From) const;
+        void Scan(size_t Begin, size_t End);
+        void Restart();
+    public:
+        TextSearch();
+
+        void SetText(std::wstring_view Text);
+        void SetQuery(std::wstring_view Query, bool CaseSensitive = false);
+        std::wstring_view Query() const;
+
+        // Scans up to MaxChars more start positions and
+        // returns true once the whole text is covered.
+
+        bool Continue(size_t MaxChars = (size_t)-1);
+        bool Complete() const;
+
+        const std::vector<size_t>& Matches() const;
+        size_t MatchLength() const;
+
+        // Index range [first, second) into Matches() of
+        // the matches overlapping [Begin, End), found by
+        // binary search.
+
+        std::pair<size_t, size_t> MatchesInRange(size_t Begin, size_t End) const;
+
+        // Appends spans highlighting the matches visible
+        // in [Begin, End), relative to Begin, ready for
+        // DrawTextInFrame. Overlapping matches are merged.
+
+        void AppendHighlightSpans(size_t Begin, size_t End, uint32_t Forecolor, uint32_t Backcolor, uint32_t Flags, std::vector<TextSpan>& Spans) const;
+    };
+}
+
+#endif // BRENDANTUI_TEXTSEARCH_H_
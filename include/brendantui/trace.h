@@ -0,0 +1,119 @@
+#ifndef BRENDANTUI_TRACE_H_
+#define BRENDANTUI_TRACE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <ostream>
+#include <string>
+
+#include "perfstats.h"
+
+// Scoped trace spans. Build with BTUI_ENABLE_TRACING
+// defined (make TRACING=1) to compile them in; without
+// it BTUI_TRACE_SCOPE() expands to nothing. When
+// compiled in but disabled at runtime, a span costs one
+// relaxed load and a branch.
+//
+// Span names must be string literals (or otherwise
+// outlive the trace), since only the pointer is kept.
+
+#ifdef BTUI_ENABLE_TRACING
+#define BTUI_TRACE_CONCAT_INNER(A, B) A##B
+#define BTUI_TRACE_CONCAT(A, B) BTUI_TRACE_CONCAT_INNER(A, B)
+#define BTUI_TRACE_SCOPE(Name) ::btui::details::TraceScope BTUI_TRACE_CONCAT(btuiTraceScope, __COUNTER__)(Name)
+#else
+#define BTUI_TRACE_SCOPE(Name) ((void)0)
+#endif
+
+namespace btui {
+    // Runtime switch (off by default).
+
+    void SetTracingEnabled(bool Enabled);
+    bool TracingEnabled();
+
+    // Names the calling thread in dumped traces.
+
+    void SetTraceThreadName(std::string Name);
+
+    // Writes every buffered span in the Chrome trace
+    // event format, which chrome://tracing and Perfetto
+    // both load. Each thread keeps its most recent
+    // 65536 spans; when a thread exits, its spans join
+    // a shared pool holding the most recent 65536 spans
+    // of exited threads, and its buffer is freed.
+
+    void DumpTrace(std::ostream& Stream);
+    bool DumpTrace(const std::filesystem::path& Path);
+    void ClearTrace();
+
+    namespace details {
+        extern std::atomic<bool> tracingEnabled;
+
+        struct TraceEvent {
+            std::atomic<const char*> name;
+            std::atomic<uint64_t> startNs;
+            std::atomic<uint64_t> durationNs;
+        };
+
+        struct TraceSpan {
+            const char* name;
+            uint32_t threadId;
+            uint64_t startNs;
+            uint64_t durationNs;
+
+            constexpr inline TraceSpan()
+                : name(0), threadId(0), startNs(0), durationNs(0) { }
+            constexpr inline TraceSpan(const char* Name, uint32_t ThreadId, uint64_t StartNs, uint64_t DurationNs)
+                : name(Name), threadId(ThreadId), startNs(StartNs), durationNs(DurationNs) { }
+        };
+
+        // Single-writer ring owned by one thread. Readers
+        // (DumpTrace) only ever load, so recording never
+        // waits on them.
+
+        class TraceBuffer {
+            static constexpr uint32_t capacity = 65536;
+
+            std::atomic<TraceEvent*> events;
+            std::atomic<uint64_t> head;
+            std::atomic<uint64_t> clearedAt;
+        public:
+            const uint32_t threadId;
+            std::string threadName;
+
+            TraceBuffer(uint32_t ThreadId);
+            ~TraceBuffer();
+
+            void Record(const char* Name, uint64_t StartNs, uint64_t EndNs);
+            void Clear();
+            void WriteEvents(std::ostream& Stream, bool& First) const;
+
+            // Called by the owning thread as it exits:
+            // appends its spans to Spans, oldest first,
+            // and gives up the ring (null if it never
+            // recorded).
+
+            TraceEvent* TakeEvents(std::deque<TraceSpan>& Spans);
+        };
+
+        void RecordTraceSpan(const char* Name, uint64_t StartNs, uint64_t EndNs);
+
+        class TraceScope {
+            const char* name;
+            uint64_t startNs;
+        public:
+            inline TraceScope(const char* Name)
+                : name(tracingEnabled.load(std::memory_order_relaxed) ? Name : 0), startNs(name ? NowNs() : 0) { }
+            inline ~TraceScope() {
+                if (name) RecordTraceSpan(name, startNs, NowNs());
+            }
+
+            TraceScope(const TraceScope&) = delete;
+            TraceScope& operator=(const TraceScope&) = delete;
+        };
+    }
+}
+
+#endif // BRENDANTUI_TRACE_H_
@@ -0,0 +1,56 @@
+#ifndef BRENDANTUI_UITASK_H_
+#define BRENDANTUI_UITASK_H_
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+
+namespace btui {
+    namespace details {
+        // Coroutine frames come from per-thread free
+        // lists, one per 64-byte size class, so a
+        // coroutine started over and over reuses the same
+        // few blocks instead of going to the heap. Frames
+        // over 4 KiB skip the lists.
+
+        void* AllocateCoroutineFrame(size_t Size);
+        void FreeCoroutineFrame(void* Frame, size_t Size);
+    }
+
+    // The return type of a fire-and-forget coroutine,
+    // e.g. one written against the awaitables of
+    // WindowBase (NextEvent(), NextFrame(),
+    // OnWindowThread(), Delay()). It starts running
+    // at once, up to its first suspension, and its frame
+    // is freed when it finishes. An exception escaping
+    // it terminates the program, as nothing is left to
+    // catch it.
+
+    class UiTask {
+    public:
+        struct promise_type {
+            inline UiTask get_return_object() noexcept {
+                return UiTask();
+            }
+            inline std::suspend_never initial_suspend() noexcept {
+                return { };
+            }
+            inline std::suspend_never final_suspend() noexcept {
+                return { };
+            }
+            inline void return_void() noexcept { }
+            inline void unhandled_exception() noexcept {
+                std::terminate();
+            }
+
+            static inline void* operator new(size_t Size) {
+                return details::AllocateCoroutineFrame(Size);
+            }
+            static inline void operator delete(void* Frame, size_t Size) noexcept {
+                details::FreeCoroutineFrame(Frame, Size);
+            }
+        };
+    };
+}
+
+#endif // BRENDANTUI_UITASK_H_
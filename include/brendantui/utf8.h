@@ -0,0 +1,81 @@
+#ifndef BRENDANTUI_UTF8_H_
+#define BRENDANTUI_UTF8_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "windowbase.h"
+
+namespace btui {
+    namespace details {
+        // Decodes the character at P and moves P past it.
+        // Invalid or truncated sequences, and characters
+        // wchar_t cannot hold, become U+FFFD.
+
+        static inline wchar_t DecodeUtf8Char(const uint8_t*& P, const uint8_t* End) {
+            uint8_t lead = *P++;
+            if (lead < 0x80) return (wchar_t)lead;
+
+            uint32_t codepoint;
+            uint32_t extra;
+            uint32_t minimum;
+            if ((lead & 0xE0) == 0xC0) {
+                codepoint = lead & 0x1F;
+                extra = 1;
+                minimum = 0x80;
+            }
+            else if ((lead & 0xF0) == 0xE0) {
+                codepoint = lead & 0x0F;
+                extra = 2;
+                minimum = 0x800;
+            }
+            else if ((lead & 0xF8) == 0xF0) {
+                codepoint = lead & 0x07;
+                extra = 3;
+                minimum = 0x10000;
+            }
+            else return (wchar_t)0xFFFD;
+
+            for (uint32_t i = 0; i < extra; ++i) {
+                if (P == End || (*P & 0xC0) != 0x80) return (wchar_t)0xFFFD;
+                codepoint = codepoint << 6 | (*P++ & 0x3F);
+            }
+            if (codepoint < minimum || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) return (wchar_t)0xFFFD;
+            if (sizeof(wchar_t) == 2 && codepoint > 0xFFFF) return (wchar_t)0xFFFD;
+            return (wchar_t)codepoint;
+        }
+
+        // Decodes characters from P into Out until either
+        // runs out, and returns how many were written.
+        // ASCII runs are widened 16 bytes at a time.
+
+        size_t DecodeUtf8(const uint8_t*& P, const uint8_t* End, wchar_t* Out, size_t OutCapacity);
+    }
+
+    // Decodes Text into Out, writing at most
+    // OutCapacity characters; returns how many were
+    // written. Never writes more characters than Text
+    // has bytes.
+
+    size_t DecodeUtf8(std::string_view Text, wchar_t* Out, size_t OutCapacity);
+    size_t DecodeUtf8(std::u8string_view Text, wchar_t* Out, size_t OutCapacity);
+
+    // Appends the decoded Text to Out, reusing its
+    // capacity.
+
+    void AppendUtf8(std::wstring& Out, std::string_view Text);
+    void AppendUtf8(std::wstring& Out, std::u8string_view Text);
+
+    // Writes Text into one row of Buffer starting at
+    // Point, straight from UTF-8 into cells, and stops at
+    // MaxColumns or the edge of the buffer. Control
+    // characters become spaces. Returns the number of
+    // cells written.
+
+    uint32_t DrawUtf8Line(BufferGrid Buffer, PointU32 Point, std::string_view Text, uint32_t Backcolor, uint32_t Forecolor, uint32_t MaxColumns = 0xFFFFFFFF);
+    uint32_t DrawUtf8Line(BufferGrid Buffer, PointU32 Point, std::u8string_view Text, uint32_t Backcolor, uint32_t Forecolor, uint32_t MaxColumns = 0xFFFFFFFF);
+}
+
+#endif // BRENDANTUI_UTF8_H_
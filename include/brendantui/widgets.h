@@ -0,0 +1,295 @@
+#ifndef BRENDANTUI_WIDGETS_H_
+#define BRENDANTUI_WIDGETS_H_
+
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "drawing.h"
+#include "windowbase.h"
+
+namespace btui {
+    class WidgetTree;
+
+    // A node of the retained widget tree. Layout is
+    // two-phase: Measure() reports the size a widget
+    // wants for a given available size (cached until
+    // the available size changes or the widget is
+    // invalidated), and Arrange() assigns its final
+    // rect. Paint() only redraws widgets that were
+    // invalidated or moved since the last paint.
+    //
+    // Widgets are not thread-safe; mutate them on the
+    // window thread (in event handlers or tasks).
+
+    class Widget {
+        friend class PanelWidget;
+        friend class WidgetTree;
+
+        Widget* parent;
+        WidgetTree* tree;
+
+        SizeU32 lastAvailable;
+        SizeU32 desiredSize;
+        RectU32 bounds;
+        bool measureValid;
+        bool arrangeValid;
+        bool paintDirty;
+        bool childPaintDirty;
+
+        uint32_t flexGrow;
+
+        void AttachToTree(WidgetTree* Tree);
+    protected:
+        // Overridden by each widget type. MeasureOverride()
+        // must not return a size larger than Available.
+
+        virtual SizeU32 MeasureOverride(SizeU32 Available) = 0;
+        virtual void ArrangeOverride(RectU32 Bounds) { };
+        virtual void PaintOverride(BufferGrid Buffer) = 0;
+        virtual void PaintChildren(BufferGrid Buffer, bool Force) { };
+        virtual void ForEachChild(const std::function<void(Widget*)>& Func) { };
+
+        // Call InvalidateMeasure() when something that
+        // affects the measured size changes, and
+        // InvalidatePaint() when only the look changes.
+
+        void InvalidateMeasure();
+        void InvalidatePaint();
+    public:
+        Widget();
+        virtual ~Widget() = default;
+
+        Widget(const Widget&) = delete;
+        Widget& operator=(const Widget&) = delete;
+
+        SizeU32 Measure(SizeU32 Available);
+        void Arrange(RectU32 Bounds);
+        void Paint(BufferGrid Buffer, bool Force);
+
+        Widget* Parent() const;
+        WidgetTree* Tree() const;
+        SizeU32 DesiredSize() const;
+        RectU32 Bounds() const;
+        bool NeedsPaint() const;
+
+        // Share of the leftover main-axis space this
+        // widget receives inside a FlexPanel (0 means it
+        // keeps its measured size).
+
+        uint32_t GetFlexGrow() const;
+        void SetFlexGrow(uint32_t FlexGrow);
+    };
+
+    // Base class for widgets with children. Owns its
+    // children and optionally fills its own bounds
+    // before they are painted.
+
+    class PanelWidget : public Widget {
+        backgroundFill_t backgroundFill;
+    protected:
+        std::vector<std::unique_ptr<Widget>> children;
+
+        void PaintOverride(BufferGrid Buffer) override;
+        void PaintChildren(BufferGrid Buffer, bool Force) override;
+        void ForEachChild(const std::function<void(Widget*)>& Func) override;
+
+        virtual void OnChildAdded(size_t Index) { };
+        virtual void OnChildRemoved(size_t Index) { };
+    public:
+        PanelWidget();
+
+        Widget* AddChild(std::unique_ptr<Widget> Child);
+        template <std::derived_from<Widget> _T, typename... _Ts>
+        _T* Emplace(_Ts&&... Args) {
+            return static_cast<_T*>(AddChild(std::make_unique<_T>(std::forward<_Ts>(Args)...)));
+        }
+        std::unique_ptr<Widget> RemoveChild(Widget* Child);
+        size_t ChildCount() const;
+        Widget* GetChild(size_t Index) const;
+
+        const backgroundFill_t& GetBackgroundFill() const;
+        void SetBackgroundFill(backgroundFill_t BackgroundFill);
+    };
+
+    enum FlexDirection {
+        FlexDirectionRow,
+        FlexDirectionColumn
+    };
+
+    // Lays children out along one axis. Children keep
+    // their measured main-axis size, then share any
+    // leftover space in proportion to their flex grow
+    // factor. Children are stretched on the cross axis.
+
+    class FlexPanel : public PanelWidget {
+        FlexDirection direction;
+        uint32_t gap;
+    protected:
+        SizeU32 MeasureOverride(SizeU32 Available) override;
+        void ArrangeOverride(RectU32 Bounds) override;
+    public:
+        FlexPanel(FlexDirection Direction = FlexDirectionColumn, uint32_t Gap = 0);
+
+        FlexDirection GetDirection() const;
+        void SetDirection(FlexDirection Direction);
+        uint32_t GetGap() const;
+        void SetGap(uint32_t Gap);
+    };
+
+    // A grid column or row. A track with a nonzero
+    // size is fixed; one with a nonzero grow factor
+    // shares leftover space; one with neither sizes to
+    // its largest single-span child.
+
+    struct GridTrack {
+        uint32_t size;
+        uint32_t grow;
+
+        constexpr inline GridTrack()
+            : size(0), grow(0) { }
+        constexpr inline GridTrack(uint32_t Size, uint32_t Grow)
+            : size(Size), grow(Grow) { }
+
+        static constexpr inline GridTrack Auto() {
+            return GridTrack(0, 0);
+        }
+        static constexpr inline GridTrack Fixed(uint32_t Size) {
+            return GridTrack(Size, 0);
+        }
+        static constexpr inline GridTrack Grow(uint32_t Grow) {
+            return GridTrack(0, Grow);
+        }
+    };
+
+    struct GridPlacement {
+        uint32_t column;
+        uint32_t row;
+        uint32_t columnSpan;
+        uint32_t rowSpan;
+
+        constexpr inline GridPlacement()
+            : column(0), row(0), columnSpan(1), rowSpan(1) { }
+        constexpr inline GridPlacement(uint32_t Column, uint32_t Row, uint32_t ColumnSpan = 1, uint32_t RowSpan = 1)
+            : column(Column), row(Row), columnSpan(ColumnSpan), rowSpan(RowSpan) { }
+    };
+
+    class GridPanel : public PanelWidget {
+        std::vector<GridTrack> columns;
+        std::vector<GridTrack> rows;
+        std::vector<GridPlacement> placements;
+        std::vector<uint32_t> columnSizes;
+        std::vector<uint32_t> rowSizes;
+        uint32_t gap;
+
+        void ResolveAutoTracks();
+    protected:
+        SizeU32 MeasureOverride(SizeU32 Available) override;
+        void ArrangeOverride(RectU32 Bounds) override;
+        void OnChildAdded(size_t Index) override;
+        void OnChildRemoved(size_t Index) override;
+    public:
+        GridPanel(std::vector<GridTrack> Columns, std::vector<GridTrack> Rows, uint32_t Gap = 0);
+
+        void SetColumns(std::vector<GridTrack> Columns);
+        void SetRows(std::vector<GridTrack> Rows);
+        GridPlacement GetPlacement(Widget* Child) const;
+        void SetPlacement(Widget* Child, GridPlacement Placement);
+    };
+
+    // Leaf that draws text with DrawTextInFrame().
+
+    class Label : public Widget {
+        std::wstring text;
+        uint32_t forecolor;
+        uint32_t backcolor;
+        Align horizontalAlign;
+        Align verticalAlign;
+        WrapStyle wrapStyle;
+    protected:
+        SizeU32 MeasureOverride(SizeU32 Available) override;
+        void PaintOverride(BufferGrid Buffer) override;
+    public:
+        Label(std::wstring Text = L"", uint32_t Forecolor = 0xFFFFFFFF, uint32_t Backcolor = 0xFF000000);
+
+        const std::wstring& GetText() const;
+        void SetText(std::wstring Text);
+        void SetColors(uint32_t Forecolor, uint32_t Backcolor);
+        void SetAlign(Align HorizontalAlign, Align VerticalAlign);
+        void SetWrapStyle(WrapStyle Style);
+    };
+
+    // Leaf that draws table borders with
+    // DrawTableInFrame(). Border arrays use the same
+    // layout as DrawTableInFrame(); all borders are
+    // drawn until SetBorders() is called, and again
+    // after the tracks change.
+
+    class Table : public Widget {
+        std::vector<uint32_t> columnWidths;
+        std::vector<uint32_t> rowHeights;
+        std::unique_ptr<bool[]> horizontalBorders;
+        std::unique_ptr<bool[]> verticalBorders;
+        uint32_t borderForecolor;
+        uint32_t borderBackcolor;
+        backgroundFill_t backgroundFill;
+    protected:
+        SizeU32 MeasureOverride(SizeU32 Available) override;
+        void PaintOverride(BufferGrid Buffer) override;
+    public:
+        Table(std::vector<uint32_t> ColumnWidths, std::vector<uint32_t> RowHeights, uint32_t BorderForecolor = 0xFFFFFFFF, uint32_t BorderBackcolor = 0xFF000000);
+
+        void SetTracks(std::vector<uint32_t> ColumnWidths, std::vector<uint32_t> RowHeights);
+        void SetBorders(const bool* HorizontalBorders, const bool* VerticalBorders);
+        void SetColors(uint32_t BorderForecolor, uint32_t BorderBackcolor);
+        void SetBackgroundFill(backgroundFill_t BackgroundFill);
+
+        // The interior rect of a cell, relative to the
+        // buffer (valid after layout).
+
+        RectU32 CellRect(uint32_t Column, uint32_t Row) const;
+    };
+
+    // Owns the root widget. Call Paint() from
+    // WindowBase::PaintBuffer(); it relayouts only the
+    // widgets that were invalidated (stopping at the
+    // first ancestor whose measured size is unchanged)
+    // and repaints only dirty widgets, unless the buffer
+    // size changed.
+
+    class WidgetTree {
+        friend class Widget;
+        friend class PanelWidget;
+
+        std::unique_ptr<Widget> root;
+        std::vector<Widget*> layoutQueue;
+        SizeU32 lastSize;
+        bool fullRepaint;
+
+        void Enqueue(Widget* Target);
+        void Forget(Widget* Target);
+        void Relayout(Widget* Target);
+    public:
+        WidgetTree();
+        ~WidgetTree();
+
+        WidgetTree(const WidgetTree&) = delete;
+        WidgetTree& operator=(const WidgetTree&) = delete;
+
+        Widget* SetRoot(std::unique_ptr<Widget> Root);
+        template <std::derived_from<Widget> _T, typename... _Ts>
+        _T* EmplaceRoot(_Ts&&... Args) {
+            return static_cast<_T*>(SetRoot(std::make_unique<_T>(std::forward<_Ts>(Args)...)));
+        }
+        Widget* Root() const;
+
+        bool NeedsPaint() const;
+        void InvalidateAll();
+        void Paint(BufferGrid Buffer);
+    };
+}
+
+#endif // BRENDANTUI_WIDGETS_H_
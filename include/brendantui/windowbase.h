@@ -4,15 +4,29 @@
 #include <atomic>
 #include <chrono>
 #include <concepts>
+#include <coroutine>
+#include <deque>
+#include <filesystem>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <string>
 #include <thread>
+#include <variant>
 #include <vector>
 
+#include "perfstats.h"
+
 typedef struct HWND__* HWND;
 typedef struct HINSTANCE__* HINSTANCE;
+typedef struct HFONT__* HFONT;
+
+#ifdef _WIN32
+#define BTUI_STDCALL __stdcall
+#else
+#define BTUI_STDCALL
+#endif
 
 namespace btui {
     static constexpr inline uint32_t FromRGB(uint8_t R, uint8_t G, uint8_t B) {
@@ -349,54 +363,289 @@ namespace btui {
             : filePaths(), point() { }
     };
 
+    // An event as NextEvent() hands it out: its type
+    // and the *Info struct that goes with it.
+
+    struct WindowEvent {
+        EventType type;
+        std::variant<KeyPressInfo, MouseDownInfo, MouseUpInfo, MouseMoveInfo, MouseEnterInfo, MouseExitInfo, MouseScrollInfo, TextInputInfo, FocusGainedInfo, FocusLostInfo, CloseRequestInfo, DisposedInfo, WindowStateChangeInfo, ResizeInfo, ResizeCompleteInfo, FileDropInfo> info;
+
+        inline WindowEvent()
+            : type(EventTypeDisposed), info(DisposedInfo()) { }
+        template <typename _T>
+        inline WindowEvent(EventType Type, const _T& Info)
+            : type(Type), info(Info) { }
+
+        // Null if the event isn't of type _T.
+
+        template <typename _T>
+        inline const _T* Get() const {
+            return std::get_if<_T>(&info);
+        }
+    };
+
     namespace details {
         struct QueuedTask {
             std::function<void()> func;
-            int* statusCode; //0 for pending; 1 for complete; 2 for cancelled
+            std::atomic<int>* statusCode; //0 for pending; 1 for complete; 2 for cancelled
 
-            inline QueuedTask(std::function<void()> Func, int* StatusCodePointer)
+            inline QueuedTask(std::function<void()> Func, std::atomic<int>* StatusCodePointer)
                 : func(std::move(Func)), statusCode(StatusCodePointer) { }
 
             inline void Run() {
                 func();
-                *statusCode = 1;
+                statusCode->store(1);
+                statusCode->notify_one();
             }
             inline void Cancel() {
-                *statusCode = 2;
+                statusCode->store(2);
+                statusCode->notify_one();
             }
         };
+
+        // A coroutine suspended until its EventLoop
+        // resumes it. The awaiters derive from this and
+        // live in the coroutine's frame, so the lists of
+        // waiters never allocate.
+
+        struct LoopWaiter {
+            std::coroutine_handle<> handle;
+            LoopWaiter* next;
+            bool cancelled; //resumed because the loop or window went away
+
+            constexpr inline LoopWaiter()
+                : handle(), next(0), cancelled(false) { }
+        };
+
+        struct ScrollOp {
+            RectU32 rect;
+            int32_t dx;
+            int32_t dy;
+
+            constexpr inline ScrollOp()
+                : rect(), dx(0), dy(0) { }
+            constexpr inline ScrollOp(RectU32 Rect, int32_t Dx, int32_t Dy)
+                : rect(Rect), dx(Dx), dy(Dy) { }
+        };
     }
 
-    class WindowBase {
-        HWND hwnd;
+    class FrameRecorder;
+    class FrameSnapshot;
+    class EventLoop;
+    class GridBuffer;
+    class SwitchableQueue;
+    class WindowBase;
+    class WorkerPool;
+
+    namespace details {
+        class FrameSnapshotPool;
+        struct RasterTarget;
+    }
+
+    // Awaitables driven by an EventLoop. Each resumes
+    // the coroutine on the loop's thread, from the loop
+    // itself rather than from inside a window message,
+    // and the result is stored in the awaiter, so the
+    // window need not outlive the wait.
+
+    class EventAwaiter : details::LoopWaiter {
+        WindowBase* window;
+        WindowEvent event;
+
+        friend class WindowBase;
+    public:
+        EventAwaiter(WindowBase& Window);
+
+        bool await_ready();
+        bool await_suspend(std::coroutine_handle<> Handle);
+        WindowEvent await_resume();
+    };
+
+    class FrameAwaiter : details::LoopWaiter {
+        WindowBase* window;
+        uint64_t sequence;
+
+        friend class WindowBase;
+    public:
+        FrameAwaiter(WindowBase& Window);
+
+        bool await_ready();
+        bool await_suspend(std::coroutine_handle<> Handle);
+        uint64_t await_resume();
+    };
+
+    class LoopThreadAwaiter : details::LoopWaiter {
+        EventLoop* loop;
+
+        friend class EventLoop;
+    public:
+        LoopThreadAwaiter(EventLoop& Loop);
+
+        bool await_ready();
+        bool await_suspend(std::coroutine_handle<> Handle);
+        bool await_resume();
+    };
+
+    class DelayAwaiter : details::LoopWaiter {
+        EventLoop* loop;
+        uint64_t deadline; //steady clock, ns
+
+        friend class EventLoop;
+    public:
+        DelayAwaiter(EventLoop& Loop, uint32_t Milliseconds);
+
+        bool await_ready();
+        bool await_suspend(std::coroutine_handle<> Handle);
+        bool await_resume();
+    };
+
+    // One UI thread serving any number of windows. The
+    // loop registers a single window class and creates
+    // the font once; every window made with it gets its
+    // messages, events and InvokeOnWindowThread() tasks
+    // on the loop's thread, which sleeps while there is
+    // nothing to do. For a small pool, make a few loops
+    // and spread the windows over them.
+    //
+    // A loop must outlive the windows made with it.
+    // Stopping it disposes any that are left.
+
+    class EventLoop {
         HINSTANCE hInstance;
         std::wstring className;
+        HFONT font;
+        void* wakeEvent;
 
         std::mutex mtx;
-        std::thread updateThread;
+        std::thread thread;
         std::atomic<bool> isRunning;
-        std::atomic<bool> isJoined;
         std::queue<details::QueuedTask> taskQueue;
+        details::LoopWaiter* readyHead; //coroutines to resume, guarded by mtx
+        details::LoopWaiter* readyTail;
+        std::vector<WindowBase*> windows; //only touched on the loop's thread
+        DelayAwaiter* timers; //only touched on the loop's thread, soonest first
+        DelayAwaiter* newTimers; //started on other threads, guarded by mtx
+
+        void ThreadFunction();
+        void ProcessTasks();
+        void CancelTasks();
+        void CloseStoppedWindows();
+        void Wake();
+
+        void PushReady(details::LoopWaiter* Waiter);
+        bool Schedule(details::LoopWaiter* Waiter);
+        bool ResumeReady();
+        void AddTimer(DelayAwaiter* Timer);
+        bool ScheduleTimer(DelayAwaiter* Timer);
+        void TakeNewTimers();
+        void FireTimers();
+        void CancelTimers();
+        uint32_t TimerTimeout() const;
+
+        friend class WindowBase;
+        friend class EventAwaiter;
+        friend class FrameAwaiter;
+        friend class LoopThreadAwaiter;
+        friend class DelayAwaiter;
+    public:
+        EventLoop(HINSTANCE HInstance);
+        ~EventLoop();
+
+        EventLoop(const EventLoop&) = delete;
+        EventLoop& operator=(const EventLoop&) = delete;
+
+        EventLoop(EventLoop&&) = delete;
+        EventLoop& operator=(EventLoop&&) = delete;
+
+        void Stop();
+        bool Running() const;
+        bool IsLoopThread() const;
+
+        // Runs Func on the loop's thread and waits for it
+        // to finish. Returns false if the loop stopped
+        // before Func could run.
+
+        bool Invoke(std::function<void()> Func);
+
+        // co_await OnLoopThread() moves a coroutine onto
+        // the loop's thread, without blocking the caller.
+        // It yields false if the loop had stopped, and
+        // the coroutine then carries on where it was.
+
+        LoopThreadAwaiter OnLoopThread();
+
+        // co_await Delay(Milliseconds) resumes the
+        // coroutine on the loop's thread once the time is
+        // up, yielding true, or false if the loop stopped
+        // first. Awaited from another thread, e.g. a
+        // handler on a WorkerPool, it hands the timer to
+        // the loop rather than blocking that thread.
+
+        DelayAwaiter Delay(uint32_t Milliseconds);
+
+        // The loop whose thread is calling, or null.
+
+        static EventLoop* Current();
+    };
+
+    class WindowBase {
+        static constexpr size_t maxPendingEvents = 1024;
+
+        HWND hwnd;
+        EventLoop* loop;
+        std::unique_ptr<EventLoop> ownedLoop;
+
+        std::mutex mtx;
+        std::atomic<bool> isRunning;
+        std::atomic<bool> isJoined;
 
         uint32_t backColor;
         bool mouseContained;
-        BufferGridCell* lastBuffer;
-        SizeU32 lastBufferSize;
+        std::unique_ptr<GridBuffer> lastBuffer;
         WindowState lastWindowState;
         CursorType cursorType;
 
-        void UpdateFunction(bool* Initialized);
-        static std::int64_t __stdcall WindowProcStatic(HWND Hwnd, unsigned int Msg, std::uint64_t WParam, std::int64_t LParam);
+        details::WindowCounters counters;
+        std::unique_ptr<details::FrameSnapshotPool> snapshotPool;
+        std::atomic<std::shared_ptr<const FrameSnapshot>> latestFrame;
+        uint64_t frameSequence;
+        std::unique_ptr<FrameRecorder> recorder;
+        std::vector<details::ScrollOp> pendingScrolls;
+        std::unique_ptr<details::RasterTarget> raster;
+
+        std::unique_ptr<SwitchableQueue> eventQueue;
+        uint64_t eventBacklogThreshold; //only touched on the loop's thread
+
+        details::LoopWaiter* eventWaiters; //only touched on the loop's thread
+        details::LoopWaiter* frameWaiters; //only touched on the loop's thread
+        std::deque<WindowEvent> pendingEvents;
+        bool bufferEvents;
+
+        WindowBase(EventLoop& Loop, bool OwnsLoop);
+
+        void Create();
+        void Teardown();
+        static std::int64_t BTUI_STDCALL WindowProcStatic(HWND Hwnd, unsigned int Msg, std::uint64_t WParam, std::int64_t LParam);
         std::int64_t WindowProc(HWND Hwnd, unsigned int Msg, std::uint64_t WParam, std::int64_t LParam);
-        void ProcessTasks();
-        void CancelTasks();
+        template <typename _T>
+        void RaiseEvent(EventType Type, void (WindowBase::* Handler)(const _T&), const _T& Info);
+        bool PostEvent(EventType Type, std::function<void()> Handler);
+        void DeliverEvent(WindowEvent Event);
+        void ReleaseFrameWaiters(uint64_t Sequence);
         bool InvokeOnWindowThread(std::function<void()> Func);
+
+        friend class EventLoop;
+        friend class EventAwaiter;
+        friend class FrameAwaiter;
     public:
         // These functions initialize or dispose
         // a window. By default, the window is
-        // hidden (not visible).
+        // hidden (not visible). A window made from
+        // an HINSTANCE runs its own EventLoop; one
+        // made from a loop shares it.
 
         WindowBase(HINSTANCE HInstance);
+        WindowBase(EventLoop& Loop);
         ~WindowBase();
 
         void Dispose();
@@ -415,12 +664,81 @@ namespace btui {
 
         // The width and height of the buffer, as
         // well as functionality to copy it out.
+        // LatestFrame() returns the last presented
+        // frame (see framesnapshot.h) without copying
+        // or taking the window's lock; it is null
+        // before the first paint. CopyBufferOut()
+        // copies that same frame.
 
         SizeU32 BufferSize();
+        std::shared_ptr<const FrameSnapshot> LatestFrame() const;
         BufferGrid CopyBufferOut();
         bool CopyBufferOut(SizeU32 BufferSize, BufferGridCell* Buffer);
         bool CopyBufferOut(BufferGrid Buffer);
 
+        // Performance counters. These are plain relaxed
+        // atomics, so they are safe to read from any thread
+        // and never wait on the window.
+
+        WindowStats GetStats() const;
+        void ResetStats();
+
+        // Runs the On* handlers on Pool instead of the
+        // window thread. Each event is copied into this
+        // window's own queue, and its handlers run in
+        // order, one at a time, while the window keeps
+        // dispatching and painting. Handlers then run
+        // alongside PaintBuffer(), so state both use
+        // needs a lock. Null goes back to running them
+        // inline. Handlers never overlap or reorder
+        // across a switch: events arriving during one
+        // wait behind those queued before it, and the
+        // switch returns once those have run, however
+        // busy the window keeps it. The
+        // eventBacklogs stat counts each time more than
+        // BacklogThreshold events are waiting. Pool must
+        // outlive the window; don't call this from a
+        // handler.
+
+        void UseEventWorkers(WorkerPool* Pool, uint32_t BacklogThreshold = 64);
+
+        // Awaitables for coroutines (see uitask.h).
+        //
+        // NextEvent() yields the next event; the On*
+        // handlers still see every event too. From the first call
+        // on, events that arrive while nobody is waiting
+        // are kept (up to the last maxPendingEvents) for
+        // the next call; every coroutine waiting at the
+        // time gets a copy. Once the window is gone, it
+        // yields EventTypeDisposed.
+        //
+        // NextFrame() asks for a repaint and yields the
+        // sequence number of the frame once it has been
+        // presented, or 0 if the window went away first.
+        //
+        // OnWindowThread() and Delay() are the window's
+        // EventLoop::OnLoopThread() and EventLoop::Delay().
+        // Like a handler, the coroutine should check
+        // Running() if the window may have closed in the
+        // meantime.
+        //
+        // The first two resume on the window thread;
+        // awaited from elsewhere, they wait for it to
+        // register the coroutine.
+
+        EventAwaiter NextEvent();
+        FrameAwaiter NextFrame();
+        LoopThreadAwaiter OnWindowThread();
+        DelayAwaiter Delay(uint32_t Milliseconds);
+
+        // Records every painted frame to a file that
+        // FramePlayer can play back (see framerecording.h).
+        // Starting a new recording ends the current one.
+
+        bool StartRecording(const std::filesystem::path& Path);
+        void StopRecording();
+        bool IsRecording();
+
         // Invalidates the client area for redrawing.
 
         void Invalidate();
@@ -469,6 +787,15 @@ namespace btui {
 
         virtual void PaintBuffer(BufferGrid Buffer) = 0;
 
+        // Tells the window that, during this PaintBuffer()
+        // call, the cells of Rect were moved by (Dx, Dy)
+        // (e.g. with ScrollRegion() from drawing.h). The
+        // window then scrolls its pixels instead of
+        // redrawing every moved cell. Only valid from
+        // within PaintBuffer().
+
+        void ReportScroll(RectU32 Rect, int32_t Dx, int32_t Dy);
+
         // Events
 
         virtual void OnKeyPress(const KeyPressInfo& Info) { };
@@ -0,0 +1,140 @@
+#ifndef BRENDANTUI_WORKERPOOL_H_
+#define BRENDANTUI_WORKERPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace btui {
+    class WorkerPool;
+
+    // Runs tasks one at a time, in the order they were
+    // posted, on a WorkerPool's threads. Different
+    // queues run in parallel. Post() never waits for
+    // tasks to run, only for a short lock.
+
+    class SerialQueue {
+        static constexpr uint32_t batchSize = 16; //tasks run before giving other queues a turn
+
+        WorkerPool* pool;
+        std::mutex mtx;
+        std::condition_variable idle;
+        std::deque<std::function<void()>> tasks;
+        bool scheduled; //waiting in the pool or running
+        std::thread::id runner;
+
+        void RunBatch();
+
+        friend class WorkerPool;
+    public:
+        SerialQueue(WorkerPool& Pool);
+
+        // Waits for the queued tasks, like Drain().
+
+        ~SerialQueue();
+
+        SerialQueue(const SerialQueue&) = delete;
+        SerialQueue& operator=(const SerialQueue&) = delete;
+
+        void Post(std::function<void()> Task);
+
+        // Waits until every task posted so far has run.
+        // Called from one of the queue's own tasks, it
+        // returns at once, since it would wait forever.
+
+        void Drain();
+        size_t Size();
+
+        // True if nothing is queued or running.
+
+        bool Idle();
+    };
+
+    // Where a stream of tasks runs: inline, on the
+    // thread posting them, or on a SerialQueue. Tasks
+    // never overlap or run out of order across a
+    // switch. Moving to another pool posts a fence to
+    // the old queue and holds new tasks back until it
+    // runs; going inline, the next Post() waits for the
+    // old queue to empty. Either way a switch only waits
+    // for what was queued before it, however fast tasks
+    // keep coming. Tasks come from one thread;
+    // SwitchTo() and Drain() may be called from any
+    // other, but not from one of the tasks.
+
+    class SwitchableQueue {
+        std::mutex mtx; //guards everything below against Post()
+        std::mutex switchMtx; //one SwitchTo() or Drain() at a time
+        std::condition_variable fenced;
+        std::unique_ptr<SerialQueue> queue;
+        std::unique_ptr<SerialQueue> next; //waiting for the fence
+        std::unique_ptr<SerialQueue> retired; //ran the fence
+        std::shared_ptr<SerialQueue> retiring; //emptying before tasks run inline
+        std::deque<std::function<void()>> held; //posted while the fence is pending
+        bool fencePending;
+        std::atomic<bool> queued;
+
+        void RunFence();
+    public:
+        SwitchableQueue();
+
+        SwitchableQueue(const SwitchableQueue&) = delete;
+        SwitchableQueue& operator=(const SwitchableQueue&) = delete;
+
+        // A cheap check before building a task. It may
+        // be stale during a switch: if it says true and
+        // Post() then returns false, run the task inline;
+        // if it says false, running inline is right.
+
+        bool Queued() const;
+
+        // Queues Task and returns true, or returns false,
+        // leaving Task as it was, if tasks run inline.
+        // Right after a switch to inline, it first waits
+        // for the old queue.
+
+        bool Post(std::function<void()>& Task);
+
+        // Null runs tasks inline again. Returns once the
+        // tasks queued before the call have run.
+
+        void SwitchTo(WorkerPool* Pool);
+        void Drain();
+    };
+
+    // A fixed set of threads running SerialQueues. It
+    // must outlive its queues; destroying it runs what
+    // is still queued, then joins the threads.
+
+    class WorkerPool {
+        std::mutex mtx;
+        std::condition_variable wake;
+        std::deque<SerialQueue*> ready;
+        std::vector<std::thread> threads;
+        bool stopping;
+
+        void WorkerFunction();
+        void Schedule(SerialQueue* Queue);
+
+        friend class SerialQueue;
+    public:
+        // ThreadCount 0 uses one thread per hardware
+        // thread.
+
+        WorkerPool(uint32_t ThreadCount = 0);
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        uint32_t ThreadCount() const;
+    };
+}
+
+#endif // BRENDANTUI_WORKERPOOL_H_
@@ -0,0 +1,159 @@
+#include <brendantui/braille.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace btui {
+    BrailleCanvas::BrailleCanvas(SizeU32 Size, uint32_t DefaultColor)
+        : dots(), colors(), size(), defaultColor(DefaultColor) {
+        Resize(Size);
+    }
+
+    void BrailleCanvas::Resize(SizeU32 NewSize) {
+        size = NewSize;
+        dots.assign((size_t)size.width * size.height, 0);
+        colors.assign((size_t)size.width * size.height, defaultColor);
+    }
+    void BrailleCanvas::Clear() {
+        std::fill(dots.begin(), dots.end(), 0);
+        std::fill(colors.begin(), colors.end(), defaultColor);
+    }
+
+    SizeU32 BrailleCanvas::Size() const {
+        return size;
+    }
+    uint32_t BrailleCanvas::PixelWidth() const {
+        return size.width * 2;
+    }
+    uint32_t BrailleCanvas::PixelHeight() const {
+        return size.height * 4;
+    }
+
+    void BrailleCanvas::SetPixel(uint32_t X, uint32_t Y, uint32_t Color) {
+        if (X < PixelWidth() && Y < PixelHeight()) Plot(X, Y, Color);
+    }
+    void BrailleCanvas::ClearPixel(uint32_t X, uint32_t Y) {
+        if (X < PixelWidth() && Y < PixelHeight())
+            dots[(size_t)(Y >> 2) * size.width + (X >> 1)] &= ~details::brailleBits[X & 1][Y & 3];
+    }
+    bool BrailleCanvas::GetPixel(uint32_t X, uint32_t Y) const {
+        if (X >= PixelWidth() || Y >= PixelHeight()) return false;
+        return dots[(size_t)(Y >> 2) * size.width + (X >> 1)] & details::brailleBits[X & 1][Y & 3];
+    }
+
+    void BrailleCanvas::Line(int32_t X0, int32_t Y0, int32_t X1, int32_t Y1, uint32_t Color) {
+        // Bresenham; pixels off the canvas are skipped
+        // (the line is not clipped, so a line mostly off
+        // the canvas still walks all of its pixels).
+        int64_t width = PixelWidth();
+        int64_t height = PixelHeight();
+        int64_t x = X0;
+        int64_t y = Y0;
+        int64_t dx = std::abs((int64_t)X1 - X0);
+        int64_t dy = -std::abs((int64_t)Y1 - Y0);
+        int64_t stepX = X0 < X1 ? 1 : -1;
+        int64_t stepY = Y0 < Y1 ? 1 : -1;
+        int64_t error = dx + dy;
+        while (true) {
+            if (x >= 0 && y >= 0 && x < width && y < height) Plot((uint32_t)x, (uint32_t)y, Color);
+            if (x == X1 && y == Y1) break;
+            int64_t twice = 2 * error;
+            if (twice >= dy) {
+                error += dy;
+                x += stepX;
+            }
+            if (twice <= dx) {
+                error += dx;
+                y += stepY;
+            }
+        }
+    }
+
+    void BrailleCanvas::FillRect(RectU32 PixelRect, uint32_t Color) {
+        if (PixelRect.x >= PixelWidth() || PixelRect.y >= PixelHeight()) return;
+        uint32_t endX = PixelRect.x + std::min(PixelRect.width, PixelWidth() - PixelRect.x);
+        uint32_t endY = PixelRect.y + std::min(PixelRect.height, PixelHeight() - PixelRect.y);
+        if (endX == PixelRect.x || endY == PixelRect.y) return;
+
+        // Work a cell at a time: OR in the dots of the
+        // rows and columns of the cell that are covered.
+        for (uint32_t cellY = PixelRect.y >> 2; cellY <= (endY - 1) >> 2; ++cellY) {
+            uint8_t rowMask[2] = { 0, 0 };
+            for (uint32_t row = 0; row < 4; ++row) {
+                uint32_t y = cellY * 4 + row;
+                if (y < PixelRect.y || y >= endY) continue;
+                rowMask[0] |= details::brailleBits[0][row];
+                rowMask[1] |= details::brailleBits[1][row];
+            }
+            for (uint32_t cellX = PixelRect.x >> 1; cellX <= (endX - 1) >> 1; ++cellX) {
+                uint8_t mask = 0;
+                if (cellX * 2 >= PixelRect.x) mask |= rowMask[0];
+                if (cellX * 2 + 1 < endX) mask |= rowMask[1];
+                size_t cell = (size_t)cellY * size.width + cellX;
+                dots[cell] |= mask;
+                colors[cell] = Color;
+            }
+        }
+    }
+
+    // The point loops keep the arrays in locals: stores
+    // through uint8_t* may alias anything, so plotting
+    // through the members would reload them every point.
+
+    void BrailleCanvas::Points(const uint32_t* Xs, const uint32_t* Ys, size_t Count, uint32_t Color) {
+        uint8_t* cellDots = dots.data();
+        uint32_t* cellColors = colors.data();
+        uint32_t stride = size.width;
+        uint32_t width = PixelWidth();
+        uint32_t height = PixelHeight();
+        for (size_t i = 0; i < Count; ++i) {
+            uint32_t x = Xs[i];
+            uint32_t y = Ys[i];
+            if (x >= width || y >= height) continue;
+            size_t cell = (size_t)(y >> 2) * stride + (x >> 1);
+            cellDots[cell] |= details::brailleBits[x & 1][y & 3];
+            cellColors[cell] = Color;
+        }
+    }
+    void BrailleCanvas::Points(const float* Xs, const float* Ys, size_t Count, float XMin, float XMax, float YMin, float YMax, uint32_t Color) {
+        if (!(XMax > XMin) || !(YMax > YMin) || !size.width || !size.height) return;
+
+        uint8_t* cellDots = dots.data();
+        uint32_t* cellColors = colors.data();
+        uint32_t stride = size.width;
+        uint32_t lastX = PixelWidth() - 1;
+        uint32_t lastY = PixelHeight() - 1;
+
+        // Scale so the range maps onto [0, pixels); the
+        // top of the range lands in the last pixel.
+        float width = (float)PixelWidth();
+        float height = (float)PixelHeight();
+        float scaleX = width / (XMax - XMin);
+        float scaleY = height / (YMax - YMin);
+        for (size_t i = 0; i < Count; ++i) {
+            float fx = (Xs[i] - XMin) * scaleX;
+            float fy = (YMax - Ys[i]) * scaleY;
+            // Written so NaN fails the test.
+            if (!(fx >= 0.0f && fx <= width && fy >= 0.0f && fy <= height)) continue;
+            uint32_t x = std::min((uint32_t)fx, lastX);
+            uint32_t y = std::min((uint32_t)fy, lastY);
+            size_t cell = (size_t)(y >> 2) * stride + (x >> 1);
+            cellDots[cell] |= details::brailleBits[x & 1][y & 3];
+            cellColors[cell] = Color;
+        }
+    }
+
+    void BrailleCanvas::Draw(BufferGrid Buffer, RectU32 Rect, uint32_t Backcolor) const {
+        if (Rect.x >= Buffer.width || Rect.y >= Buffer.height) return;
+        uint32_t width = std::min({ Rect.width, Buffer.width - Rect.x, size.width });
+        uint32_t height = std::min({ Rect.height, Buffer.height - Rect.y, size.height });
+
+        for (uint32_t y = 0; y < height; ++y) {
+            const uint8_t* rowDots = dots.data() + (size_t)y * size.width;
+            const uint32_t* rowColors = colors.data() + (size_t)y * size.width;
+            BufferGridCell* out = Buffer.buffer + (size_t)(Rect.y + y) * Buffer.width + Rect.x;
+            for (uint32_t x = 0; x < width; ++x)
+                out[x] = BufferGridCell(rowDots[x] ? (wchar_t)(0x2800 + rowDots[x]) : L' ', rowColors[x], Backcolor);
+        }
+    }
+}
@@ -0,0 +1,241 @@
+﻿#include <brendantui/charts.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <brendantui/simd.h>
+
+namespace btui {
+    namespace details {
+        static inline void MinMax(const float* Samples, size_t Count, float& Min, float& Max) {
+            size_t i = 0;
+#ifdef BTUI_SSE2
+            if (Count >= 8) {
+                __m128 vMin = _mm_loadu_ps(Samples);
+                __m128 vMax = vMin;
+                for (i = 4; i + 4 <= Count; i += 4) {
+                    __m128 v = _mm_loadu_ps(Samples + i);
+                    vMin = _mm_min_ps(vMin, v);
+                    vMax = _mm_max_ps(vMax, v);
+                }
+                float mins[4];
+                float maxes[4];
+                _mm_storeu_ps(mins, vMin);
+                _mm_storeu_ps(maxes, vMax);
+                Min = std::min({ Min, mins[0], mins[1], mins[2], mins[3] });
+                Max = std::max({ Max, maxes[0], maxes[1], maxes[2], maxes[3] });
+            }
+#endif
+            for (; i < Count; ++i) {
+                Min = std::min(Min, Samples[i]);
+                Max = std::max(Max, Samples[i]);
+            }
+        }
+
+        void ChartBucket::Add(const float* Samples, size_t Count) {
+            if (!Count) return;
+            if (!count) {
+                min = Samples[0];
+                max = Samples[0];
+            }
+            MinMax(Samples, Count, min, max);
+            last = Samples[Count - 1];
+            count += Count;
+        }
+
+        static const wchar_t eighthBlocks[9] = { L' ', L'▁', L'▂', L'▃', L'▄', L'▅', L'▆', L'▇', L'█' };
+
+        void DrawChartBuckets(BufferGrid Buffer, RectU32 Rect, const ChartBucket* Buckets, uint32_t BucketCount, ChartStyle Style, float Low, float High, uint32_t Backcolor, uint32_t Forecolor) {
+            if (Rect.x >= Buffer.width || Rect.y >= Buffer.height) return;
+            uint32_t width = std::min(Rect.width, Buffer.width - Rect.x);
+            uint32_t height = std::min(Rect.height, Buffer.height - Rect.y);
+            if (!width || !height) return;
+
+            // The newest column sits at the right edge of
+            // Rect, even if Rect is clipped.
+            BucketCount = std::min(BucketCount, Rect.width);
+            uint32_t firstColumn = Rect.width - BucketCount;
+
+            if (Low >= High) {
+                bool any = false;
+                for (uint32_t i = 0; i < BucketCount; ++i) {
+                    if (!Buckets[i].count) continue;
+                    Low = any ? std::min(Low, Buckets[i].min) : Buckets[i].min;
+                    High = any ? std::max(High, Buckets[i].max) : Buckets[i].max;
+                    any = true;
+                }
+                if (Low >= High) {
+                    Low -= 0.5f;
+                    High += 0.5f;
+                }
+            }
+            float scale = 1.0f / (High - Low);
+
+            BufferGridCell blank(L' ', Forecolor, Backcolor);
+            bool havePrevious = false;
+            float previous = 0;
+            for (uint32_t column = 0; column < width; ++column) {
+                BufferGridCell* top = Buffer.buffer + (size_t)Rect.y * Buffer.width + Rect.x + column;
+                const ChartBucket* bucket = column >= firstColumn ? Buckets + (column - firstColumn) : 0;
+                if (!bucket || !bucket->count) {
+                    for (uint32_t row = 0; row < height; ++row) top[(size_t)row * Buffer.width] = blank;
+                    havePrevious = false;
+                    continue;
+                }
+
+                // Rows are counted from the bottom of Rect.
+                if (Style == ChartStyleBars) {
+                    float level = std::clamp((bucket->max - Low) * scale, 0.0f, 1.0f);
+                    uint32_t eighths = std::max(1u, (uint32_t)(level * Rect.height * 8 + 0.5f));
+                    for (uint32_t row = 0; row < height; ++row) {
+                        uint32_t fromBottom = Rect.height - 1 - row;
+                        uint32_t filled = eighths > fromBottom * 8 ? std::min(8u, eighths - fromBottom * 8) : 0;
+                        top[(size_t)row * Buffer.width] = BufferGridCell(eighthBlocks[filled], Forecolor, Backcolor);
+                    }
+                }
+                else {
+                    float spanLow = bucket->min;
+                    float spanHigh = bucket->max;
+                    if (havePrevious) {
+                        spanLow = std::min(spanLow, previous);
+                        spanHigh = std::max(spanHigh, previous);
+                    }
+                    uint32_t halves = Rect.height * 2;
+                    uint32_t low = (uint32_t)(std::clamp((spanLow - Low) * scale, 0.0f, 1.0f) * (halves - 1) + 0.5f);
+                    uint32_t high = (uint32_t)(std::clamp((spanHigh - Low) * scale, 0.0f, 1.0f) * (halves - 1) + 0.5f);
+                    for (uint32_t row = 0; row < height; ++row) {
+                        uint32_t lower = (Rect.height - 1 - row) * 2;
+                        bool lowerSet = lower >= low && lower <= high;
+                        bool upperSet = lower + 1 >= low && lower + 1 <= high;
+                        wchar_t c = lowerSet ? (upperSet ? L'█' : L'▄') : (upperSet ? L'▀' : L' ');
+                        top[(size_t)row * Buffer.width] = BufferGridCell(c, Forecolor, Backcolor);
+                    }
+                }
+                havePrevious = true;
+                previous = bucket->last;
+            }
+        }
+    }
+
+    void DrawChart(BufferGrid Buffer, RectU32 Rect, const float* Samples, size_t Count, ChartStyle Style, float Low, float High, uint32_t Backcolor, uint32_t Forecolor) {
+        if (!Rect.width) return;
+
+        uint32_t columns = (uint32_t)std::min<size_t>(Rect.width, Count);
+        std::vector<details::ChartBucket> buckets(columns);
+        for (uint32_t i = 0; i < columns; ++i) {
+            size_t begin = (size_t)((uint64_t)i * Count / columns);
+            size_t end = (size_t)((uint64_t)(i + 1) * Count / columns);
+            buckets[i].Add(Samples + begin, end - begin);
+        }
+        details::DrawChartBuckets(Buffer, Rect, buckets.data(), columns, Style, Low, High, Backcolor, Forecolor);
+    }
+
+    ChartSeries::ChartSeries(size_t Capacity)
+        : ring(new float[std::max<size_t>(Capacity, 1)]), capacity(std::max<size_t>(Capacity, 1)), total(0), buckets(), bucketSamples(0), firstBucket(0), frontStart(0), aggregated(0) { }
+
+    void ChartSeries::Push(float Sample) {
+        ring[total % capacity] = Sample;
+        ++total;
+    }
+    void ChartSeries::Push(const float* Samples, size_t Count) {
+        // Only the last capacity samples can survive.
+        if (Count > capacity) {
+            total += Count - capacity;
+            Samples += Count - capacity;
+            Count = capacity;
+        }
+        while (Count) {
+            size_t position = total % capacity;
+            size_t chunk = std::min(Count, capacity - position);
+            std::copy_n(Samples, chunk, ring.get() + position);
+            Samples += chunk;
+            Count -= chunk;
+            total += chunk;
+        }
+    }
+    void ChartSeries::Clear() {
+        total = 0;
+        buckets.clear();
+        bucketSamples = 0;
+        aggregated = 0;
+    }
+
+    size_t ChartSeries::Capacity() const {
+        return capacity;
+    }
+    size_t ChartSeries::Size() const {
+        return (size_t)std::min<uint64_t>(total, capacity);
+    }
+    uint64_t ChartSeries::TotalPushed() const {
+        return total;
+    }
+    float ChartSeries::At(size_t Index) const {
+        return ring[(total - Size() + Index) % capacity];
+    }
+
+    void ChartSeries::AddRange(details::ChartBucket& Bucket, uint64_t Begin, uint64_t End) const {
+        // [Begin, End) may wrap around the ring.
+        size_t position = Begin % capacity;
+        size_t count = (size_t)(End - Begin);
+        size_t first = std::min(count, capacity - position);
+        Bucket.Add(ring.get() + position, first);
+        Bucket.Add(ring.get(), count - first);
+    }
+    void ChartSeries::CatchUp(uint32_t Columns) {
+        uint64_t oldest = total - Size();
+        uint64_t perColumn = std::max<uint64_t>(1, (capacity + Columns - 1) / Columns);
+        if (perColumn != bucketSamples || aggregated < oldest || aggregated > total) {
+            bucketSamples = perColumn;
+            buckets.clear();
+            aggregated = oldest;
+        }
+        if (buckets.empty()) firstBucket = aggregated / bucketSamples;
+
+        while (aggregated < total) {
+            uint64_t bucket = aggregated / bucketSamples;
+            uint64_t end = std::min(total, (bucket + 1) * bucketSamples);
+            if (buckets.empty() || firstBucket + buckets.size() <= bucket) {
+                if (buckets.empty()) {
+                    firstBucket = bucket;
+                    frontStart = aggregated;
+                }
+                buckets.emplace_back();
+            }
+            AddRange(buckets.back(), aggregated, end);
+            aggregated = end;
+        }
+
+        // Drop columns whose samples have all left the
+        // ring and rebuild the front one from what is
+        // left of its samples, so what is shown doesn't
+        // depend on how often it is drawn.
+        while (buckets.size() > Columns || (!buckets.empty() && (firstBucket + 1) * bucketSamples <= oldest)) {
+            buckets.pop_front();
+            ++firstBucket;
+            frontStart = firstBucket * bucketSamples;
+        }
+        if (!buckets.empty() && frontStart < oldest) {
+            details::ChartBucket clipped;
+            AddRange(clipped, oldest, std::min(total, (firstBucket + 1) * bucketSamples));
+            buckets.front() = clipped;
+            frontStart = oldest;
+        }
+    }
+
+    void ChartSeries::Draw(BufferGrid Buffer, RectU32 Rect, ChartStyle Style, float Low, float High, uint32_t Backcolor, uint32_t Forecolor) {
+        if (!Rect.width || !Rect.height) return;
+        CatchUp(Rect.width);
+
+        // The deque isn't contiguous; the copy is
+        // O(columns) like the rest of the draw.
+        details::ChartBucket visible[512];
+        std::vector<details::ChartBucket> large;
+        details::ChartBucket* out = visible;
+        if (buckets.size() > 512) {
+            large.resize(buckets.size());
+            out = large.data();
+        }
+        std::copy(buckets.begin(), buckets.end(), out);
+        details::DrawChartBuckets(Buffer, Rect, out, (uint32_t)buckets.size(), Style, Low, High, Backcolor, Forecolor);
+    }
+}
@@ -0,0 +1,397 @@
+#include <brendantui/docview.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <brendantui/utf8.h>
+
+namespace btui {
+    namespace details {
+        LineRope::Node::Node(const LineSegment& Segment, uint32_t Priority)
+            : segment(Segment), lines(Segment.count), priority(Priority) { }
+        void LineRope::Node::Update() {
+            lines = segment.count + (left ? left->lines : 0) + (right ? right->lines : 0);
+        }
+
+        LineRope::LineRope()
+            : seed(0x9E3779B9) { }
+
+        uint32_t LineRope::NextPriority() {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            return seed;
+        }
+        std::unique_ptr<LineRope::Node> LineRope::Merge(std::unique_ptr<Node> A, std::unique_ptr<Node> B) {
+            if (!A) return B;
+            if (!B) return A;
+            if (A->priority > B->priority) {
+                A->right = Merge(std::move(A->right), std::move(B));
+                A->Update();
+                return A;
+            }
+            B->left = Merge(std::move(A), std::move(B->left));
+            B->Update();
+            return B;
+        }
+        void LineRope::Split(std::unique_ptr<Node> T, uint64_t Lines, std::unique_ptr<Node>& A, std::unique_ptr<Node>& B) {
+            if (!T) {
+                A.reset();
+                B.reset();
+                return;
+            }
+
+            uint64_t leftLines = T->left ? T->left->lines : 0;
+            if (Lines <= leftLines) {
+                std::unique_ptr<Node> left = std::move(T->left);
+                Split(std::move(left), Lines, A, T->left);
+                T->Update();
+                B = std::move(T);
+            }
+            else if (Lines >= leftLines + T->segment.count) {
+                std::unique_ptr<Node> right = std::move(T->right);
+                Split(std::move(right), Lines - leftLines - T->segment.count, T->right, B);
+                T->Update();
+                A = std::move(T);
+            }
+            else {
+                // The cut falls inside this node's segment.
+                uint64_t cut = Lines - leftLines;
+                LineSegment second = T->segment;
+                second.start += cut;
+                second.count -= cut;
+                T->segment.count = cut;
+
+                std::unique_ptr<Node> right = std::move(T->right);
+                T->Update();
+                A = std::move(T);
+                B = Merge(std::make_unique<Node>(second, NextPriority()), std::move(right));
+            }
+        }
+        template <typename _TFunc>
+        void LineRope::ForEach(Node* T, _TFunc& Func) {
+            if (!T) return;
+            ForEach(T->left.get(), Func);
+            Func(*T);
+            ForEach(T->right.get(), Func);
+        }
+
+        uint64_t LineRope::LineCount() const {
+            return root ? root->lines : 0;
+        }
+        const LineSegment* LineRope::Find(uint64_t Line, uint64_t& Offset) const {
+            const Node* node = root.get();
+            while (node) {
+                uint64_t leftLines = node->left ? node->left->lines : 0;
+                if (Line < leftLines) node = node->left.get();
+                else if (Line < leftLines + node->segment.count) {
+                    Offset = Line - leftLines;
+                    return &node->segment;
+                }
+                else {
+                    Line -= leftLines + node->segment.count;
+                    node = node->right.get();
+                }
+            }
+            return 0;
+        }
+
+        void LineRope::Insert(uint64_t Line, const LineSegment& Segment) {
+            if (!Segment.count) return;
+            std::unique_ptr<Node> a, b;
+            Split(std::move(root), Line, a, b);
+            root = Merge(Merge(std::move(a), std::make_unique<Node>(Segment, NextPriority())), std::move(b));
+        }
+        void LineRope::Erase(uint64_t Line, uint64_t Count) {
+            std::unique_ptr<Node> a, rest, middle, b;
+            Split(std::move(root), Line, a, rest);
+            Split(std::move(rest), Count, middle, b);
+            root = Merge(std::move(a), std::move(b));
+        }
+        void LineRope::Append(const LineSegment& Segment) {
+            if (!Segment.count) return;
+            root = Merge(std::move(root), std::make_unique<Node>(Segment, NextPriority()));
+        }
+        void LineRope::SetHighlight(uint64_t Line, uint64_t Count, bool Highlighted, uint32_t Backcolor) {
+            std::unique_ptr<Node> a, rest, middle, b;
+            Split(std::move(root), Line, a, rest);
+            Split(std::move(rest), Count, middle, b);
+            auto mark = [Highlighted, Backcolor](Node& N) {
+                N.segment.highlighted = Highlighted;
+                N.segment.highlightBackcolor = Backcolor;
+            };
+            ForEach(middle.get(), mark);
+            root = Merge(Merge(std::move(a), std::move(middle)), std::move(b));
+        }
+        void LineRope::Clear() {
+            root.reset();
+        }
+    }
+
+    Document::Document()
+        : stopIndexing(false), indexingComplete(false), indexedBytes(0), fileLines(0), ropeFileEnd(0) { }
+    Document::~Document() {
+        Close();
+    }
+
+    bool Document::Open(const std::filesystem::path& Path) {
+        Close();
+
+        if (!file.Open(Path)) return false;
+
+        checkpoints.assign(1, 0);
+        stopIndexing.store(false);
+        indexingComplete.store(false);
+        indexedBytes.store(0);
+        fileLines.store(0);
+        indexer = std::thread(&Document::IndexFunction, this);
+        return true;
+    }
+    void Document::Close() {
+        stopIndexing.store(true);
+        if (indexer.joinable()) indexer.join();
+
+        file.Close();
+        checkpoints.clear();
+        indexingComplete.store(false);
+        indexedBytes.store(0);
+        fileLines.store(0);
+        rope.Clear();
+        ropeFileEnd = 0;
+        editLines.clear();
+    }
+    bool Document::IsOpen() const {
+        return file.IsOpen();
+    }
+
+    void Document::IndexFunction() {
+        static constexpr uint64_t chunkSize = 1 << 22;
+
+        const uint8_t* data = file.Data();
+        uint64_t size = file.Size();
+        uint64_t position = 0;
+        uint64_t lines = 0;
+        std::vector<uint64_t> found;
+
+        // Publishes after every chunk, so the first
+        // screenful is available almost immediately.
+
+        while (position < size) {
+            if (stopIndexing.load(std::memory_order_relaxed)) return;
+
+            uint64_t chunkEnd = std::min(size, position + chunkSize);
+            const uint8_t* p = data + position;
+            const uint8_t* end = data + chunkEnd;
+            while ((p = (const uint8_t*)memchr(p, '\n', end - p))) {
+                ++p;
+                ++lines;
+                if (!(lines % checkpointInterval)) found.push_back(p - data);
+            }
+
+            if (!found.empty()) {
+                std::lock_guard<std::mutex> lock(checkpointMtx);
+                checkpoints.insert(checkpoints.end(), found.begin(), found.end());
+                found.clear();
+            }
+            indexedBytes.store(chunkEnd, std::memory_order_release);
+            fileLines.store(lines, std::memory_order_release);
+            position = chunkEnd;
+        }
+
+        // An unterminated last line is only counted once
+        // nothing more can follow it.
+        if (size && data[size - 1] != '\n') fileLines.store(lines + 1, std::memory_order_release);
+        indexingComplete.store(true, std::memory_order_release);
+    }
+    bool Document::FileLineRange(uint64_t Line, uint64_t& Start, uint64_t& End) const {
+        if (Line >= fileLines.load(std::memory_order_acquire)) return false;
+
+        const uint8_t* data = file.Data();
+        uint64_t size = file.Size();
+        {
+            std::lock_guard<std::mutex> lock(checkpointMtx);
+            Start = checkpoints[Line / checkpointInterval];
+        }
+        for (uint64_t i = Line % checkpointInterval; i; --i) {
+            const uint8_t* newline = (const uint8_t*)memchr(data + Start, '\n', size - Start);
+            Start = newline - data + 1;
+        }
+
+        const uint8_t* newline = (const uint8_t*)memchr(data + Start, '\n', size - Start);
+        End = newline ? newline - data : size;
+        if (End > Start && data[End - 1] == '\r') --End;
+        return true;
+    }
+    bool Document::CoverLines(uint64_t Lines) {
+        uint64_t covered = rope.LineCount();
+        if (covered >= Lines) return true;
+
+        uint64_t needed = Lines - covered;
+        if (ropeFileEnd + needed > fileLines.load(std::memory_order_acquire)) return false;
+        rope.Append(details::LineSegment(LineSourceFile, ropeFileEnd, needed));
+        ropeFileEnd += needed;
+        return true;
+    }
+
+    bool Document::IndexingComplete() const {
+        return indexingComplete.load(std::memory_order_acquire);
+    }
+    uint64_t Document::IndexedBytes() const {
+        return indexedBytes.load(std::memory_order_acquire);
+    }
+    uint64_t Document::FileSize() const {
+        return file.Size();
+    }
+    uint64_t Document::LineCount() const {
+        return rope.LineCount() + (fileLines.load(std::memory_order_acquire) - ropeFileEnd);
+    }
+
+    uint32_t Document::DecodeLine(uint64_t Line, uint64_t FirstColumn, wchar_t* Out, uint32_t MaxColumns) const {
+        LineSource source = LineSourceFile;
+        uint64_t index;
+        uint64_t ropeLines = rope.LineCount();
+        if (Line < ropeLines) {
+            uint64_t offset;
+            const details::LineSegment* segment = rope.Find(Line, offset);
+            source = segment->source;
+            index = segment->start + offset;
+        }
+        else index = ropeFileEnd + (Line - ropeLines);
+
+        uint32_t written = 0;
+        if (source == LineSourceEdit) {
+            const std::wstring& text = editLines[index];
+            for (uint64_t i = FirstColumn; i < text.size() && written < MaxColumns; ++i)
+                Out[written++] = text[i] < L' ' ? L' ' : text[i];
+            return written;
+        }
+
+        uint64_t start, end;
+        if (!FileLineRange(index, start, end)) return 0;
+
+        const uint8_t* p = file.Data() + start;
+        const uint8_t* pEnd = file.Data() + end;
+        for (uint64_t i = 0; i < FirstColumn && p < pEnd; ++i) {
+            if (*p < 0x80) ++p;
+            else details::DecodeUtf8Char(p, pEnd);
+        }
+        while (p < pEnd && written < MaxColumns) {
+            wchar_t c = *p < 0x80 ? (wchar_t)*p++ : details::DecodeUtf8Char(p, pEnd);
+            Out[written++] = c < L' ' ? L' ' : c;
+        }
+        return written;
+    }
+    std::wstring Document::GetLine(uint64_t Line, uint64_t FirstColumn, uint32_t MaxColumns) const {
+        std::wstring text;
+        if (Line >= LineCount()) return text;
+
+        // Bytes bound the number of characters for file
+        // lines; edit lines report their own length.
+        uint64_t capacity = MaxColumns;
+        uint64_t ropeLines = rope.LineCount();
+        uint64_t offset;
+        const details::LineSegment* segment = Line < ropeLines ? rope.Find(Line, offset) : 0;
+        if (segment && segment->source == LineSourceEdit) capacity = std::min(capacity, (uint64_t)editLines[segment->start + offset].size());
+        else {
+            uint64_t start, end;
+            if (!FileLineRange(segment ? segment->start + offset : ropeFileEnd + (Line - ropeLines), start, end)) return text;
+            capacity = std::min(capacity, end - start);
+        }
+
+        text.resize((size_t)capacity);
+        text.resize(DecodeLine(Line, FirstColumn, text.data(), (uint32_t)capacity));
+        return text;
+    }
+    bool Document::LineHighlight(uint64_t Line, uint32_t& Backcolor) const {
+        if (Line >= rope.LineCount()) return false;
+        uint64_t offset;
+        const details::LineSegment* segment = rope.Find(Line, offset);
+        if (!segment->highlighted) return false;
+        Backcolor = segment->highlightBackcolor;
+        return true;
+    }
+
+    bool Document::InsertLines(uint64_t Line, const std::vector<std::wstring>& Lines) {
+        if (Line > LineCount() || !CoverLines(Line)) return false;
+        uint64_t first = editLines.size();
+        editLines.insert(editLines.end(), Lines.begin(), Lines.end());
+        rope.Insert(Line, details::LineSegment(LineSourceEdit, first, Lines.size()));
+        return true;
+    }
+    bool Document::DeleteLines(uint64_t Line, uint64_t Count) {
+        if (Line + Count > LineCount() || !CoverLines(Line + Count)) return false;
+        rope.Erase(Line, Count);
+        return true;
+    }
+    bool Document::ReplaceLine(uint64_t Line, const std::wstring& Text) {
+        if (Line >= LineCount() || !CoverLines(Line + 1)) return false;
+
+        // Each edit line backs exactly one document line,
+        // so an edit line being replaced can take the new
+        // text in place.
+        uint64_t offset;
+        const details::LineSegment* segment = rope.Find(Line, offset);
+        uint64_t index;
+        if (segment->source == LineSourceEdit) {
+            index = segment->start + offset;
+            editLines[index] = Text;
+        }
+        else {
+            index = editLines.size();
+            editLines.push_back(Text);
+        }
+        rope.Erase(Line, 1);
+        rope.Insert(Line, details::LineSegment(LineSourceEdit, index, 1));
+        return true;
+    }
+    bool Document::HighlightLines(uint64_t Line, uint64_t Count, uint32_t Backcolor) {
+        if (Line + Count > LineCount() || !CoverLines(Line + Count)) return false;
+        rope.SetHighlight(Line, Count, true, Backcolor);
+        return true;
+    }
+    bool Document::ClearHighlight(uint64_t Line, uint64_t Count) {
+        if (Line + Count > LineCount() || !CoverLines(Line + Count)) return false;
+        rope.SetHighlight(Line, Count, false, 0);
+        return true;
+    }
+
+    DocumentView::DocumentView(Document& Doc, uint32_t TextBackcolor, uint32_t TextForecolor)
+        : document(&Doc), topLine(0), leftColumn(0), textBackcolor(TextBackcolor), textForecolor(TextForecolor) { }
+
+    uint64_t DocumentView::TopLine() const {
+        return topLine;
+    }
+    uint64_t DocumentView::LeftColumn() const {
+        return leftColumn;
+    }
+    void DocumentView::ScrollTo(uint64_t Line, uint64_t Column) {
+        topLine = Line;
+        leftColumn = Column;
+    }
+    void DocumentView::ScrollBy(int64_t Lines, int64_t Columns) {
+        topLine = Lines < 0 && (uint64_t)-Lines > topLine ? 0 : topLine + Lines;
+        leftColumn = Columns < 0 && (uint64_t)-Columns > leftColumn ? 0 : leftColumn + Columns;
+    }
+
+    void DocumentView::Draw(BufferGrid Buffer, RectU32 Rect) {
+        if (Rect.x >= Buffer.width || Rect.y >= Buffer.height) return;
+        uint32_t width = std::min(Rect.width, Buffer.width - Rect.x);
+        uint32_t height = std::min(Rect.height, Buffer.height - Rect.y);
+        lineBuffer.resize(width);
+
+        uint64_t lineCount = document->LineCount();
+        for (uint32_t row = 0; row < height; ++row) {
+            uint64_t line = topLine + row;
+            uint32_t length = 0;
+            uint32_t backcolor = textBackcolor;
+            if (line < lineCount) {
+                length = document->DecodeLine(line, leftColumn, lineBuffer.data(), width);
+                document->LineHighlight(line, backcolor);
+            }
+
+            BufferGridCell* cells = Buffer.buffer + (size_t)(Rect.y + row) * Buffer.width + Rect.x;
+            for (uint32_t i = 0; i < width; ++i)
+                cells[i] = BufferGridCell(i < length ? lineBuffer[i] : L' ', textForecolor, backcolor);
+        }
+    }
+}
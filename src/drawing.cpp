@@ -1,5 +1,13 @@
 ﻿#include <brendantui/drawing.h>
 
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <brendantui/simd.h>
+#include <brendantui/utf8.h>
+
 namespace btui {
     void OverwriteWithBackgroundFill(BufferGridCell& Cell, const backgroundFill_t& BackgroundFill) {
         switch (BackgroundFill.index()) {
@@ -54,275 +62,311 @@ namespace btui {
                 OverwriteWithBackgroundFill(WindowBuffer.buffer[j * WindowBuffer.width + i], BackgroundFill);
     }
 
-    void DrawTextInFrame(BufferGrid WindowBuffer, RectU32 FrameRect, const std::wstring& Text, uint32_t TextBackcolor, uint32_t TextForecolor, Align TextHorizontalAlign, Align TextVerticalAlign, WrapStyle TextWrapStyle, backgroundFill_t BackgroundFill) {
-        std::vector<std::wstring> lines;
-
-        switch (TextWrapStyle) {
-        case WrapStyleNoWrap:
-            {
-                std::wstringstream currentStream;
-                uint32_t size = 0;
-                for (wchar_t c : Text) {
-                    if (c == L'\n') {
-                        lines.push_back(currentStream.str());
-                        currentStream.str(L"");
-                        size = 0;
-                        continue;
-                    }
-                    if (size >= FrameRect.width) continue;
-                    if (c == L'\r') continue;
-
-                    currentStream << c;
-                    size++;
-                }
-                lines.push_back(currentStream.str());
+    namespace details {
+        // Wrapped text as one flat buffer: line i is
+        // chars[lineStarts[i], lineStarts[i + 1]). sources
+        // maps every character back to its index in the
+        // input (spaces added by justification take the
+        // index of the space they widen), so styles can
+        // follow the text through wrapping.
+
+        struct TextLayout {
+            std::wstring chars;
+            std::vector<uint32_t> sources;
+            std::vector<uint32_t> lineStarts;
+            std::vector<bool> wrappedRecord;
+
+            inline void Put(wchar_t C, uint32_t Source) {
+                chars.push_back(C);
+                sources.push_back(Source);
             }
-            break;
-        case WrapStyleWrapByChar:
-            {
-                std::wstringstream currentStream;
-                uint32_t size = 0;
-                for (wchar_t c : Text) {
-                    if (c == L'\n') {
-                        lines.push_back(currentStream.str());
-                        currentStream.str(L"");
-                        size = 0;
-                        continue;
-                    }
-                    if (c == L'\r') continue;
+            inline void EndLine() {
+                lineStarts.push_back((uint32_t)chars.size());
+            }
+            inline uint32_t LineCount() const {
+                return (uint32_t)lineStarts.size() - 1;
+            }
+            inline uint32_t LineSize(uint32_t Line) const {
+                return lineStarts[Line + 1] - lineStarts[Line];
+            }
+        };
 
-                    currentStream << c;
-                    size++;
+        static void LayOutText(TextLayout& Layout, std::wstring_view Text, uint32_t Width, WrapStyle TextWrapStyle) {
+            Layout.lineStarts.push_back(0);
+
+            switch (TextWrapStyle) {
+            case WrapStyleNoWrap:
+                {
+                    uint32_t size = 0;
+                    for (uint32_t i = 0; i < Text.size(); ++i) {
+                        wchar_t c = Text[i];
+                        if (c == L'\n') {
+                            Layout.EndLine();
+                            size = 0;
+                            continue;
+                        }
+                        if (size >= Width) continue;
+                        if (c == L'\r') continue;
 
-                    if (size >= FrameRect.width) {
-                        lines.push_back(currentStream.str());
-                        currentStream.str(L"");
-                        size = 0;
-                        continue;
+                        Layout.Put(c, i);
+                        size++;
                     }
+                    Layout.EndLine();
                 }
-                lines.push_back(currentStream.str());
-            }
-            break;
-        case WrapStyleWrapByWord:
-        case WrapStyleWrapByWordAndStretch:
-            {
-                std::vector<bool> wrappedRecord;
-                std::wstringstream currentStream;
-                uint32_t size = 0;
-                uint32_t lastSpaceImAfter = 0;
-                bool notFirst = false;
-                bool lastWasWhitespace = true;
-                for (uint32_t i = 0; i < Text.size(); ++i) {
-                    wchar_t c = Text[i];
-
-                    if (c == L'\r') continue;
-                    if (c == L'\n') {
-                        if (lastWasWhitespace) {
-                            notFirst = true;
+                break;
+            case WrapStyleWrapByChar:
+                {
+                    uint32_t size = 0;
+                    for (uint32_t i = 0; i < Text.size(); ++i) {
+                        wchar_t c = Text[i];
+                        if (c == L'\n') {
+                            Layout.EndLine();
                             size = 0;
-                            lines.push_back(currentStream.str());
-                            wrappedRecord.push_back(false);
-                            currentStream.str(L"");
-                            lastSpaceImAfter = i + 1;
                             continue;
                         }
-                        if (notFirst) currentStream << L' ';
-                        for (uint32_t j = lastSpaceImAfter; j < i; ++j)
-                            currentStream << Text[j];
-                        notFirst = false;
-                        size = 0;
-                        lines.push_back(currentStream.str());
-                        wrappedRecord.push_back(false);
-                        currentStream.str(L"");
-                        lastSpaceImAfter = i + 1;
-                        lastWasWhitespace = true;
-                        continue;
-                    }
-                    if (c == L' ') {
-                        if (lastWasWhitespace) {
-                            lastSpaceImAfter = i + 1;
+                        if (c == L'\r') continue;
+
+                        Layout.Put(c, i);
+                        size++;
+
+                        if (size >= Width) {
+                            Layout.EndLine();
+                            size = 0;
                             continue;
                         }
-                        if (size >= FrameRect.width) {
-                            if (notFirst) currentStream << L' ';
+                    }
+                    Layout.EndLine();
+                }
+                break;
+            case WrapStyleWrapByWord:
+            case WrapStyleWrapByWordAndStretch:
+                {
+                    std::vector<bool>& wrappedRecord = Layout.wrappedRecord;
+                    uint32_t size = 0;
+                    uint32_t lastSpaceImAfter = 0;
+                    bool notFirst = false;
+                    bool lastWasWhitespace = true;
+                    for (uint32_t i = 0; i < Text.size(); ++i) {
+                        wchar_t c = Text[i];
+
+                        if (c == L'\r') continue;
+                        if (c == L'\n') {
+                            if (lastWasWhitespace) {
+                                notFirst = true;
+                                size = 0;
+                                Layout.EndLine();
+                                wrappedRecord.push_back(false);
+                                lastSpaceImAfter = i + 1;
+                                continue;
+                            }
+                            if (notFirst) Layout.Put(L' ', lastSpaceImAfter - 1);
                             for (uint32_t j = lastSpaceImAfter; j < i; ++j)
-                                currentStream << Text[j];
+                                Layout.Put(Text[j], j);
                             notFirst = false;
                             size = 0;
-                            lines.push_back(currentStream.str());
-                            wrappedRecord.push_back(true);
-                            currentStream.str(L"");
+                            Layout.EndLine();
+                            wrappedRecord.push_back(false);
                             lastSpaceImAfter = i + 1;
                             lastWasWhitespace = true;
                             continue;
                         }
-                        if (notFirst) {
-                            currentStream << L' ';
-                            size++;
-                        }
-                        for (uint32_t j = lastSpaceImAfter; j < i; ++j)
-                            currentStream << Text[j];
-                        size += i - lastSpaceImAfter - 2;
-                        lastSpaceImAfter = i + 1;
-                        lastWasWhitespace = true;
-                        notFirst = true;
-                        continue;
-                    }
-                    if (size >= FrameRect.width) {
-                        if (!notFirst) {
+                        if (c == L' ') {
+                            if (lastWasWhitespace) {
+                                lastSpaceImAfter = i + 1;
+                                continue;
+                            }
+                            if (size >= Width) {
+                                if (notFirst) Layout.Put(L' ', lastSpaceImAfter - 1);
+                                for (uint32_t j = lastSpaceImAfter; j < i; ++j)
+                                    Layout.Put(Text[j], j);
+                                notFirst = false;
+                                size = 0;
+                                Layout.EndLine();
+                                wrappedRecord.push_back(true);
+                                lastSpaceImAfter = i + 1;
+                                lastWasWhitespace = true;
+                                continue;
+                            }
+                            if (notFirst) {
+                                Layout.Put(L' ', lastSpaceImAfter - 1);
+                                size++;
+                            }
                             for (uint32_t j = lastSpaceImAfter; j < i; ++j)
-                                currentStream << Text[j];
+                                Layout.Put(Text[j], j);
+                            size += i - lastSpaceImAfter - 2;
+                            lastSpaceImAfter = i + 1;
+                            lastWasWhitespace = true;
+                            notFirst = true;
+                            continue;
                         }
-                        lines.push_back(currentStream.str());
-                        wrappedRecord.push_back(true);
-                        currentStream.str(L"");
-                        notFirst = false;
-                        size = 0;
+                        if (size >= Width) {
+                            if (!notFirst) {
+                                for (uint32_t j = lastSpaceImAfter; j < i; ++j)
+                                    Layout.Put(Text[j], j);
+                            }
+                            Layout.EndLine();
+                            wrappedRecord.push_back(true);
+                            notFirst = false;
+                            size = 0;
+                            lastWasWhitespace = false;
+                            continue;
+                        }
+
+                        size++;
                         lastWasWhitespace = false;
-                        continue;
                     }
-
-                    size++;
-                    lastWasWhitespace = false;
-                }
-                if (notFirst) currentStream << L' ';
-                for (uint32_t i = lastSpaceImAfter; i < Text.size(); ++i)
-                    currentStream << Text[i];
-                lines.push_back(currentStream.str());
-                wrappedRecord.push_back(false);
-
-                if (TextWrapStyle == WrapStyleWrapByWordAndStretch) {
-                    for (size_t lineIdx = 0; lineIdx < lines.size(); ++lineIdx) {
-                        std::wstring& line = lines[lineIdx];
-                        bool lineWasWrapped = wrappedRecord[lineIdx];
-
-                        if (!lineWasWrapped) continue;
-
-                        uint32_t rem = FrameRect.width - line.size();
-                        if (!rem) continue;
-
-                        uint32_t spaceCount = 0;
-                        for (wchar_t c : line)
-                            if (c == L' ') spaceCount++;
-                        if (!spaceCount) continue;
-
-                        uint32_t perSpaceAddBase = rem / spaceCount;
-                        uint32_t perSpaceAddBaseRem = rem % spaceCount;
-
-                        std::wstringstream newLineStream;
-                        uint32_t countOfSpacesSeenSoFar = 0;
-                        for (wchar_t c : line) {
-                            newLineStream << c;
-                            if (c == L' ') {
-                                countOfSpacesSeenSoFar++;
-                                if (countOfSpacesSeenSoFar <= perSpaceAddBaseRem)
-                                    newLineStream << L' ';
-                                for (uint32_t i = 0; i < perSpaceAddBase; ++i)
-                                    newLineStream << L' ';
+                    if (notFirst) Layout.Put(L' ', lastSpaceImAfter - 1);
+                    for (uint32_t i = lastSpaceImAfter; i < Text.size(); ++i)
+                        Layout.Put(Text[i], i);
+                    Layout.EndLine();
+                    wrappedRecord.push_back(false);
+
+                    if (TextWrapStyle == WrapStyleWrapByWordAndStretch) {
+                        TextLayout stretched;
+                        stretched.chars.reserve(Layout.LineCount() * Width);
+                        stretched.sources.reserve(Layout.LineCount() * Width);
+                        stretched.lineStarts.push_back(0);
+                        stretched.wrappedRecord = std::move(wrappedRecord);
+
+                        for (uint32_t lineIdx = 0; lineIdx < Layout.LineCount(); ++lineIdx) {
+                            uint32_t lineStart = Layout.lineStarts[lineIdx];
+                            uint32_t lineEnd = Layout.lineStarts[lineIdx + 1];
+                            uint32_t lineSize = lineEnd - lineStart;
+
+                            uint32_t spaceCount = 0;
+                            for (uint32_t i = lineStart; i < lineEnd; ++i)
+                                if (Layout.chars[i] == L' ') spaceCount++;
+
+                            // Lines the word wrap let run past the frame
+                            // are left alone rather than "stretched"
+                            // by a wrapped-around remainder.
+                            bool stretch = stretched.wrappedRecord[lineIdx] && lineSize < Width && spaceCount;
+                            uint32_t rem = stretch ? Width - lineSize : 0;
+                            uint32_t perSpaceAddBase = stretch ? rem / spaceCount : 0;
+                            uint32_t perSpaceAddBaseRem = stretch ? rem % spaceCount : 0;
+
+                            uint32_t countOfSpacesSeenSoFar = 0;
+                            for (uint32_t i = lineStart; i < lineEnd; ++i) {
+                                wchar_t c = Layout.chars[i];
+                                uint32_t source = Layout.sources[i];
+                                stretched.Put(c, source);
+                                if (stretch && c == L' ') {
+                                    countOfSpacesSeenSoFar++;
+                                    if (countOfSpacesSeenSoFar <= perSpaceAddBaseRem)
+                                        stretched.Put(L' ', source);
+                                    for (uint32_t j = 0; j < perSpaceAddBase; ++j)
+                                        stretched.Put(L' ', source);
+                                }
                             }
+                            stretched.EndLine();
                         }
 
-                        line = newLineStream.str();
+                        Layout = std::move(stretched);
                     }
                 }
+                break;
             }
-            break;
         }
 
-        CanvasIntoFrameMappingInfo1D mapInfo = MakeCanvasIntoFrameMappingInfo1D(lines.size(), FrameRect.height, TextVerticalAlign);
-        mapInfo.outStartCoord += FrameRect.y;
-
-        uint32_t rYEnd = mapInfo.inStartCoord + mapInfo.ioLength;
-        uint32_t wYEnd = mapInfo.outStartCoord + mapInfo.ioLength;
-        uint32_t pXEnd = FrameRect.x + FrameRect.width;
-        uint32_t pYEnd = FrameRect.y + FrameRect.height;
-        switch (TextHorizontalAlign) {
-        case AlignStart:
-            for (uint32_t rJ = mapInfo.inStartCoord, wJ = mapInfo.outStartCoord; rJ < rYEnd; rJ++, wJ++) {
-                if (wJ >= WindowBuffer.height) break;
+        // Walks a sorted span array forward; Advance()
+        // is amortized O(1) as long as sources only
+        // increase.
 
-                const std::wstring& line = lines[rJ];
-                for (uint32_t lI = 0, wI = FrameRect.x; lI < line.size(); lI++, wI++) {
-                    if (wI >= WindowBuffer.width) break;
+        struct SpanCursor {
+            const TextSpan* spans;
+            const TextSpan* spansEnd;
 
-                    BufferGridCell& cell = WindowBuffer.buffer[wJ * WindowBuffer.width + wI];
+            constexpr inline SpanCursor(const TextSpan* Spans, size_t SpanCount)
+                : spans(Spans), spansEnd(Spans + SpanCount) { }
 
-                    cell.character = line[lI];
-                    cell.forecolor = TextForecolor;
-                    cell.backcolor = TextBackcolor;
-                }
-                if (BackgroundFill.index()) {
-                    for (uint32_t wI = FrameRect.x + line.size(); wI < pXEnd; ++wI) {
-                        if (wI >= WindowBuffer.width) break;
-
-                        BufferGridCell& cell = WindowBuffer.buffer[wJ * WindowBuffer.width + wI];
-
-                        OverwriteWithBackgroundFill(cell, BackgroundFill);
-                    }
-                }
+            inline const TextSpan* Advance(uint32_t Source) {
+                while (spans != spansEnd && spans->start + spans->length <= Source) ++spans;
+                return spans != spansEnd && spans->start <= Source ? spans : 0;
             }
-            break;
-        case AlignMiddle:
-            for (uint32_t rJ = mapInfo.inStartCoord, wJ = mapInfo.outStartCoord; rJ < rYEnd; rJ++, wJ++) {
-                if (wJ >= WindowBuffer.height) break;
+        };
 
-                const std::wstring& line = lines[rJ];
-                uint32_t wIStart = FrameRect.width / 2 - line.size() / 2 + FrameRect.x;
-                for (uint32_t lI = 0, wI = wIStart; lI < line.size(); lI++, wI++) {
-                    if (wI >= WindowBuffer.width) break;
+        static inline void ApplyTextStyle(BufferGridCell& Cell, wchar_t Character, const TextSpan* Span, uint32_t TextBackcolor, uint32_t TextForecolor) {
+            Cell.character = Character;
+            if (!Span) {
+                Cell.forecolor = TextForecolor;
+                Cell.backcolor = TextBackcolor;
+                return;
+            }
 
-                    BufferGridCell& cell = WindowBuffer.buffer[wJ * WindowBuffer.width + wI];
+            uint32_t forecolor = Span->flags & TextStyleFlagsDefaultForecolor ? TextForecolor : Span->forecolor;
+            uint32_t backcolor = Span->flags & TextStyleFlagsDefaultBackcolor ? TextBackcolor : Span->backcolor;
+            if (Span->flags & TextStyleFlagsInverse) std::swap(forecolor, backcolor);
+            if (Span->flags & TextStyleFlagsTransparent) backcolor = OverlayColor(Cell.backcolor, backcolor);
+            Cell.forecolor = forecolor;
+            Cell.backcolor = backcolor;
+        }
+    }
 
-                    cell.character = line[lI];
-                    cell.forecolor = TextForecolor;
-                    cell.backcolor = TextBackcolor;
-                }
-                uint32_t wIEnd = wIStart + line.size();
-                if (BackgroundFill.index()) {
-                    for (uint32_t wI = FrameRect.x; wI < wIStart; ++wI) {
-                        if (wI >= WindowBuffer.width) break;
+    void DrawTextInFrame(BufferGrid WindowBuffer, RectU32 FrameRect, const std::wstring& Text, uint32_t TextBackcolor, uint32_t TextForecolor, Align TextHorizontalAlign, Align TextVerticalAlign, WrapStyle TextWrapStyle, backgroundFill_t BackgroundFill) {
+        DrawTextInFrame(WindowBuffer, FrameRect, std::wstring_view(Text), 0, 0, TextBackcolor, TextForecolor, TextHorizontalAlign, TextVerticalAlign, TextWrapStyle, std::move(BackgroundFill));
+    }
+    void DrawTextInFrame(BufferGrid WindowBuffer, RectU32 FrameRect, const AttributedText& Text, uint32_t TextBackcolor, uint32_t TextForecolor, Align TextHorizontalAlign, Align TextVerticalAlign, WrapStyle TextWrapStyle, backgroundFill_t BackgroundFill) {
+        DrawTextInFrame(WindowBuffer, FrameRect, std::wstring_view(Text.text), Text.spans.data(), Text.spans.size(), TextBackcolor, TextForecolor, TextHorizontalAlign, TextVerticalAlign, TextWrapStyle, std::move(BackgroundFill));
+    }
+    void DrawTextInFrame(BufferGrid WindowBuffer, RectU32 FrameRect, std::string_view Text, uint32_t TextBackcolor, uint32_t TextForecolor, Align TextHorizontalAlign, Align TextVerticalAlign, WrapStyle TextWrapStyle, backgroundFill_t BackgroundFill) {
+        thread_local std::wstring decoded;
+        decoded.clear();
+        AppendUtf8(decoded, Text);
+        DrawTextInFrame(WindowBuffer, FrameRect, std::wstring_view(decoded), 0, 0, TextBackcolor, TextForecolor, TextHorizontalAlign, TextVerticalAlign, TextWrapStyle, std::move(BackgroundFill));
+    }
+    void DrawTextInFrame(BufferGrid WindowBuffer, RectU32 FrameRect, std::u8string_view Text, uint32_t TextBackcolor, uint32_t TextForecolor, Align TextHorizontalAlign, Align TextVerticalAlign, WrapStyle TextWrapStyle, backgroundFill_t BackgroundFill) {
+        DrawTextInFrame(WindowBuffer, FrameRect, std::string_view((const char*)Text.data(), Text.size()), TextBackcolor, TextForecolor, TextHorizontalAlign, TextVerticalAlign, TextWrapStyle, std::move(BackgroundFill));
+    }
+    void DrawTextInFrame(BufferGrid WindowBuffer, RectU32 FrameRect, std::wstring_view Text, const TextSpan* Spans, size_t SpanCount, uint32_t TextBackcolor, uint32_t TextForecolor, Align TextHorizontalAlign, Align TextVerticalAlign, WrapStyle TextWrapStyle, backgroundFill_t BackgroundFill) {
+        details::TextLayout layout;
+        details::LayOutText(layout, Text, FrameRect.width, TextWrapStyle);
 
-                        BufferGridCell& cell = WindowBuffer.buffer[wJ * WindowBuffer.width + wI];
+        CanvasIntoFrameMappingInfo1D mapInfo = MakeCanvasIntoFrameMappingInfo1D(layout.LineCount(), FrameRect.height, TextVerticalAlign);
+        mapInfo.outStartCoord += FrameRect.y;
 
-                        OverwriteWithBackgroundFill(cell, BackgroundFill);
-                    }
-                    for (uint32_t wI = wIEnd; wI < pXEnd; ++wI) {
-                        if (wI >= WindowBuffer.width) break;
+        uint32_t rYEnd = mapInfo.inStartCoord + mapInfo.ioLength;
+        uint32_t wYEnd = mapInfo.outStartCoord + mapInfo.ioLength;
+        uint32_t pXEnd = FrameRect.x + FrameRect.width;
+        uint32_t pYEnd = FrameRect.y + FrameRect.height;
 
-                        BufferGridCell& cell = WindowBuffer.buffer[wJ * WindowBuffer.width + wI];
+        details::SpanCursor spanCursor(Spans, SpanCount);
+        for (uint32_t rJ = mapInfo.inStartCoord, wJ = mapInfo.outStartCoord; rJ < rYEnd; rJ++, wJ++) {
+            if (wJ >= WindowBuffer.height) break;
 
-                        OverwriteWithBackgroundFill(cell, BackgroundFill);
-                    }
-                }
+            uint32_t lineStart = layout.lineStarts[rJ];
+            uint32_t lineSize = layout.LineSize(rJ);
+            uint32_t wIStart;
+            switch (TextHorizontalAlign) {
+            case AlignStart:
+                wIStart = FrameRect.x;
+                break;
+            case AlignMiddle:
+                wIStart = FrameRect.width / 2 - lineSize / 2 + FrameRect.x;
+                break;
+            default:
+                wIStart = pXEnd - lineSize;
+                break;
             }
-            break;
-        case AlignEnd:
-            for (uint32_t rJ = mapInfo.inStartCoord, wJ = mapInfo.outStartCoord; rJ < rYEnd; rJ++, wJ++) {
-                if (wJ >= WindowBuffer.height) break;
 
-                const std::wstring& line = lines[rJ];
-                uint32_t wIStart = pXEnd - line.size();
-                for (uint32_t lI = 0, wI = wIStart; lI < line.size(); lI++, wI++) {
-                    if (wI >= WindowBuffer.width) break;
+            BufferGridCell* row = WindowBuffer.buffer + wJ * WindowBuffer.width;
+            for (uint32_t lI = 0, wI = wIStart; lI < lineSize; lI++, wI++) {
+                if (wI >= WindowBuffer.width) break;
 
-                    BufferGridCell& cell = WindowBuffer.buffer[wJ * WindowBuffer.width + wI];
+                uint32_t i = lineStart + lI;
+                details::ApplyTextStyle(row[wI], layout.chars[i], spanCursor.Advance(layout.sources[i]), TextBackcolor, TextForecolor);
+            }
+            if (BackgroundFill.index()) {
+                for (uint32_t wI = FrameRect.x; wI < wIStart; ++wI) {
+                    if (wI >= WindowBuffer.width) break;
 
-                    cell.character = line[lI];
-                    cell.forecolor = TextForecolor;
-                    cell.backcolor = TextBackcolor;
+                    OverwriteWithBackgroundFill(row[wI], BackgroundFill);
                 }
-                if (BackgroundFill.index()) {
-                    for (uint32_t wI = FrameRect.x; wI < wIStart; ++wI) {
-                        if (wI >= WindowBuffer.width) break;
-
-                        BufferGridCell& cell = WindowBuffer.buffer[wJ * WindowBuffer.width + wI];
+                for (uint32_t wI = wIStart + lineSize; wI < pXEnd; ++wI) {
+                    if (wI >= WindowBuffer.width) break;
 
-                        OverwriteWithBackgroundFill(cell, BackgroundFill);
-                    }
+                    OverwriteWithBackgroundFill(row[wI], BackgroundFill);
                 }
             }
-            break;
         }
         if (BackgroundFill.index()) {
             for (uint32_t wI = FrameRect.x; wI < pXEnd; ++wI) {
@@ -345,6 +389,14 @@ namespace btui {
             }
         }
     }
+    SizeU32 MeasureTextInFrame(std::wstring_view Text, uint32_t Width, WrapStyle TextWrapStyle) {
+        details::TextLayout layout;
+        details::LayOutText(layout, Text, Width, TextWrapStyle);
+
+        SizeU32 size(0, layout.LineCount());
+        for (uint32_t i = 0; i < size.height; ++i) size.width = std::max(size.width, layout.LineSize(i));
+        return size;
+    }
     void DrawTableInFrame(BufferGrid WindowBuffer, RectU32 FrameRect, uint32_t ColumnCount, uint32_t RowCount, uint32_t* ColumnWidths, uint32_t* RowHeights, bool* HorizontalBorders, bool* VerticalBorders, uint32_t BorderBackcolor, uint32_t BorderForecolor, backgroundFill_t BackgroundFill) {
         if (FrameRect.x >= WindowBuffer.width || FrameRect.y >= WindowBuffer.height) return;
         if (FrameRect.x + FrameRect.width >= WindowBuffer.width) FrameRect.width = WindowBuffer.width - FrameRect.x/* - 1*/;
@@ -393,6 +445,7 @@ namespace btui {
                         }
                     }
                 }
+                if (x >= frameXMax) goto NextRow;
                 {
                     bool left = ColumnCount && HorizontalBorders[rowBorderIdx * ColumnCount + ColumnCount - 1];
                     bool right = (ColumnCount < ColumnCount) && HorizontalBorders[rowBorderIdx * ColumnCount + ColumnCount];
@@ -464,4 +517,176 @@ namespace btui {
             }
         }
     }
+
+    namespace details {
+        static inline void FillCells(BufferGridCell* Dest, size_t Count, const BufferGridCell& Cell) {
+#ifdef BTUI_SSE2
+            // 12-byte cells repeat every 48 bytes, i.e.
+            // every three vectors.
+            if constexpr (sizeof(BufferGridCell) == 12) {
+                if (Count >= 8) {
+                    BufferGridCell pattern[4] = { Cell, Cell, Cell, Cell };
+                    __m128i p0 = _mm_loadu_si128((const __m128i*)pattern);
+                    __m128i p1 = _mm_loadu_si128((const __m128i*)pattern + 1);
+                    __m128i p2 = _mm_loadu_si128((const __m128i*)pattern + 2);
+
+                    __m128i* out = (__m128i*)Dest;
+                    size_t groups = Count / 4;
+                    for (size_t i = 0; i < groups; ++i, out += 3) {
+                        _mm_storeu_si128(out, p0);
+                        _mm_storeu_si128(out + 1, p1);
+                        _mm_storeu_si128(out + 2, p2);
+                    }
+                    for (size_t i = groups * 4; i < Count; ++i) Dest[i] = Cell;
+                    return;
+                }
+            }
+#endif
+            std::fill_n(Dest, Count, Cell);
+        }
+
+        static inline bool ClipRect(BufferGrid WindowBuffer, RectU32& Rect) {
+            if (Rect.x >= WindowBuffer.width || Rect.y >= WindowBuffer.height) return false;
+            Rect.width = std::min(Rect.width, WindowBuffer.width - Rect.x);
+            Rect.height = std::min(Rect.height, WindowBuffer.height - Rect.y);
+            return Rect.width && Rect.height;
+        }
+
+        struct BoxGlyphs {
+            wchar_t horizontal;
+            wchar_t vertical;
+            wchar_t topLeft;
+            wchar_t topRight;
+            wchar_t bottomLeft;
+            wchar_t bottomRight;
+        };
+
+        static constexpr BoxGlyphs boxGlyphs[] = {
+            { L'─', L'│', L'┌', L'┐', L'└', L'┘' },
+            { L'═', L'║', L'╔', L'╗', L'╚', L'╝' },
+            { L'━', L'┃', L'┏', L'┓', L'┗', L'┛' },
+            { L'─', L'│', L'╭', L'╮', L'╰', L'╯' }
+        };
+    }
+
+    void FillRect(BufferGrid WindowBuffer, RectU32 Rect, BufferGridCell Cell) {
+        if (!details::ClipRect(WindowBuffer, Rect)) return;
+
+        BufferGridCell* row = WindowBuffer.buffer + (size_t)Rect.y * WindowBuffer.width + Rect.x;
+        if (Rect.width == WindowBuffer.width) {
+            details::FillCells(row, (size_t)Rect.width * Rect.height, Cell);
+            return;
+        }
+        for (uint32_t j = 0; j < Rect.height; ++j, row += WindowBuffer.width)
+            details::FillCells(row, Rect.width, Cell);
+    }
+    void ClearRect(BufferGrid WindowBuffer, RectU32 Rect, uint32_t Backcolor) {
+        FillRect(WindowBuffer, Rect, BufferGridCell(L' ', 0xFFFFFFFF, Backcolor));
+    }
+    void ClearBuffer(BufferGrid WindowBuffer, uint32_t Backcolor) {
+        FillRect(WindowBuffer, RectU32(PointU32(0, 0), WindowBuffer.size), BufferGridCell(L' ', 0xFFFFFFFF, Backcolor));
+    }
+
+    ScrollExposure ScrollRegion(BufferGrid WindowBuffer, RectU32 Rect, int32_t Dx, int32_t Dy, backgroundFill_t ExposedFill) {
+        ScrollExposure exposure;
+        if (!details::ClipRect(WindowBuffer, Rect)) return exposure;
+
+        uint32_t shiftX = Dx < 0 ? 0u - (uint32_t)Dx : (uint32_t)Dx;
+        uint32_t shiftY = Dy < 0 ? 0u - (uint32_t)Dy : (uint32_t)Dy;
+        if (shiftX >= Rect.width || shiftY >= Rect.height) {
+            exposure.rects[exposure.count++] = Rect;
+        }
+        else if (shiftX || shiftY) {
+            uint32_t rowCells = Rect.width - shiftX;
+            uint32_t rowCount = Rect.height - shiftY;
+            uint32_t srcX = Dx < 0 ? Rect.x + shiftX : Rect.x;
+            uint32_t dstX = Dx < 0 ? Rect.x : Rect.x + shiftX;
+            uint32_t srcY = Dy < 0 ? Rect.y + shiftY : Rect.y;
+            uint32_t dstY = Dy < 0 ? Rect.y : Rect.y + shiftY;
+
+            BufferGridCell* src = WindowBuffer.buffer + (size_t)srcY * WindowBuffer.width + srcX;
+            BufferGridCell* dst = WindowBuffer.buffer + (size_t)dstY * WindowBuffer.width + dstX;
+            if (!shiftX && Rect.width == WindowBuffer.width) {
+                memmove(dst, src, sizeof(BufferGridCell) * rowCells * rowCount);
+            }
+            else if (Dy > 0) {
+                // Moving down; go bottom-up so no row is
+                // overwritten before it is moved.
+                for (uint32_t j = rowCount; j-- > 0;)
+                    memmove(dst + (size_t)j * WindowBuffer.width, src + (size_t)j * WindowBuffer.width, sizeof(BufferGridCell) * rowCells);
+            }
+            else {
+                for (uint32_t j = 0; j < rowCount; ++j)
+                    memmove(dst + (size_t)j * WindowBuffer.width, src + (size_t)j * WindowBuffer.width, sizeof(BufferGridCell) * rowCells);
+            }
+
+            if (shiftY)
+                exposure.rects[exposure.count++] = RectU32(Rect.x, Dy < 0 ? Rect.y + rowCount : Rect.y, Rect.width, shiftY);
+            if (shiftX)
+                exposure.rects[exposure.count++] = RectU32(Dx < 0 ? Rect.x + rowCells : Rect.x, Dy < 0 ? Rect.y : Rect.y + shiftY, shiftX, rowCount);
+        }
+
+        for (uint32_t k = 0; k < exposure.count; ++k) {
+            const RectU32& r = exposure.rects[k];
+            switch (ExposedFill.index()) {
+            case 1:
+                FillRect(WindowBuffer, r, std::get<BufferGridCell>(ExposedFill));
+                break;
+            case 2:
+                for (uint32_t j = r.y; j < r.y + r.height; ++j)
+                for (uint32_t i = r.x; i < r.x + r.width; ++i)
+                    OverwriteWithBackgroundFill(WindowBuffer.buffer[(size_t)j * WindowBuffer.width + i], ExposedFill);
+                break;
+            }
+        }
+        return exposure;
+    }
+
+    void DrawBox(BufferGrid WindowBuffer, RectU32 Rect, BoxStyle Style, uint32_t BorderBackcolor, uint32_t BorderForecolor, backgroundFill_t InteriorFill) {
+        if (!Rect.width || !Rect.height) return;
+
+        const details::BoxGlyphs& glyphs = details::boxGlyphs[(uint32_t)Style < 4 ? Style : BoxStyleSingle];
+        auto cell = [&](wchar_t C) {
+            return BufferGridCell(C, BorderForecolor, BorderBackcolor);
+        };
+
+        // Edges go through FillRect, which clips them;
+        // corners are set only when they are on screen.
+        uint32_t right = Rect.x + Rect.width - 1;
+        uint32_t bottom = Rect.y + Rect.height - 1;
+        auto put = [&](uint32_t X, uint32_t Y, wchar_t C) {
+            if (X < WindowBuffer.width && Y < WindowBuffer.height) WindowBuffer.buffer[(size_t)Y * WindowBuffer.width + X] = cell(C);
+        };
+
+        if (Rect.height == 1) {
+            FillRect(WindowBuffer, Rect, cell(glyphs.horizontal));
+            return;
+        }
+        if (Rect.width == 1) {
+            FillRect(WindowBuffer, Rect, cell(glyphs.vertical));
+            return;
+        }
+
+        put(Rect.x, Rect.y, glyphs.topLeft);
+        put(right, Rect.y, glyphs.topRight);
+        put(Rect.x, bottom, glyphs.bottomLeft);
+        put(right, bottom, glyphs.bottomRight);
+        FillRect(WindowBuffer, RectU32(Rect.x + 1, Rect.y, Rect.width - 2, 1), cell(glyphs.horizontal));
+        FillRect(WindowBuffer, RectU32(Rect.x + 1, bottom, Rect.width - 2, 1), cell(glyphs.horizontal));
+        FillRect(WindowBuffer, RectU32(Rect.x, Rect.y + 1, 1, Rect.height - 2), cell(glyphs.vertical));
+        FillRect(WindowBuffer, RectU32(right, Rect.y + 1, 1, Rect.height - 2), cell(glyphs.vertical));
+
+        RectU32 interior(Rect.x + 1, Rect.y + 1, Rect.width - 2, Rect.height - 2);
+        switch (InteriorFill.index()) {
+        case 1:
+            FillRect(WindowBuffer, interior, std::get<BufferGridCell>(InteriorFill));
+            break;
+        case 2:
+            if (!details::ClipRect(WindowBuffer, interior)) break;
+            for (uint32_t j = interior.y; j < interior.y + interior.height; ++j)
+            for (uint32_t i = interior.x; i < interior.x + interior.width; ++i)
+                OverwriteWithBackgroundFill(WindowBuffer.buffer[(size_t)j * WindowBuffer.width + i], InteriorFill);
+            break;
+        }
+    }
 }
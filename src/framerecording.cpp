@@ -0,0 +1,485 @@
+#include <brendantui/framerecording.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <brendantui/perfstats.h>
+
+namespace btui {
+    namespace details {
+        static constexpr char recordingMagic[8] = { 'B', 'T', 'U', 'I', 'R', 'E', 'C', '1' };
+        static constexpr char indexMagic[8] = { 'B', 'T', 'U', 'I', 'I', 'D', 'X', '1' };
+        static constexpr uint64_t footerSize = 16;
+        static constexpr size_t flushThreshold = 1 << 16;
+        static constexpr uint64_t minRepeatRun = 4;
+
+        static inline void WriteVarint(std::vector<uint8_t>& Out, uint64_t Value) {
+            while (Value >= 0x80) {
+                Out.push_back((uint8_t)(Value | 0x80));
+                Value >>= 7;
+            }
+            Out.push_back((uint8_t)Value);
+        }
+        static inline void WriteU32(std::vector<uint8_t>& Out, uint32_t Value) {
+            for (uint32_t i = 0; i < 4; ++i) Out.push_back((uint8_t)(Value >> (i * 8)));
+        }
+        static inline void WriteU64(std::vector<uint8_t>& Out, uint64_t Value) {
+            for (uint32_t i = 0; i < 8; ++i) Out.push_back((uint8_t)(Value >> (i * 8)));
+        }
+
+        // Bounds-checked reader over a mapped region; any
+        // read past the end sets failed and yields 0.
+
+        struct ByteReader {
+            const uint8_t* data;
+            uint64_t position;
+            uint64_t end;
+            bool failed;
+
+            constexpr inline ByteReader(const uint8_t* Data, uint64_t Position, uint64_t End)
+                : data(Data), position(Position), end(End), failed(false) { }
+
+            inline bool AtEnd() const {
+                return position >= end;
+            }
+            inline uint8_t ReadU8() {
+                if (position >= end) {
+                    failed = true;
+                    return 0;
+                }
+                return data[position++];
+            }
+            inline uint32_t ReadU32() {
+                if (position > end || end - position < 4) {
+                    failed = true;
+                    position = end;
+                    return 0;
+                }
+                uint32_t value = 0;
+                for (uint32_t i = 0; i < 4; ++i) value |= (uint32_t)data[position++] << (i * 8);
+                return value;
+            }
+            inline uint64_t ReadVarint() {
+                uint64_t value = 0;
+                for (uint32_t shift = 0; shift < 64; shift += 7) {
+                    if (position >= end) {
+                        failed = true;
+                        return 0;
+                    }
+                    uint8_t byte = data[position++];
+                    value |= (uint64_t)(byte & 0x7F) << shift;
+                    if (!(byte & 0x80)) return value;
+                }
+                failed = true;
+                return 0;
+            }
+        };
+
+        static inline bool CellsEqual(const BufferGridCell& A, const BufferGridCell& B) {
+            return A.character == B.character && A.forecolor == B.forecolor && A.backcolor == B.backcolor;
+        }
+    }
+
+    FrameRecorder::FrameRecorder()
+        : fileOffset(0), previousSize(), frameCount(0), startNs(0), lastFrameUs(0), keyframeInterval(600), framesSinceKeyframe(0) { }
+    FrameRecorder::~FrameRecorder() {
+        Close();
+    }
+
+    bool FrameRecorder::Open(const std::filesystem::path& Path, uint32_t KeyframeInterval) {
+        Close();
+
+        file.open(Path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return false;
+
+        pending.assign(details::recordingMagic, details::recordingMagic + sizeof(details::recordingMagic));
+        fileOffset = pending.size();
+        previous.clear();
+        previousSize = SizeU32();
+        colorIndices.clear();
+        keyframes.clear();
+        frameCount = 0;
+        startNs = details::NowNs();
+        lastFrameUs = 0;
+        keyframeInterval = KeyframeInterval ? KeyframeInterval : 1;
+        framesSinceKeyframe = 0;
+        return true;
+    }
+    void FrameRecorder::Close() {
+        if (!file.is_open()) return;
+
+        uint64_t indexOffset = fileOffset;
+        payload.clear();
+        details::WriteVarint(payload, frameCount);
+        details::WriteVarint(payload, keyframes.size());
+        for (const RecordingKeyframe& keyframe : keyframes) {
+            details::WriteVarint(payload, keyframe.frameIndex);
+            details::WriteVarint(payload, keyframe.offset);
+            details::WriteVarint(payload, keyframe.timeUs);
+        }
+        WriteRecord(RecordTypeIndex, payload);
+        details::WriteU64(pending, indexOffset);
+        pending.insert(pending.end(), details::indexMagic, details::indexMagic + sizeof(details::indexMagic));
+        fileOffset += details::footerSize;
+
+        Flush();
+        file.close();
+        previous.clear();
+        previous.shrink_to_fit();
+        keyframes.clear();
+    }
+    bool FrameRecorder::IsOpen() const {
+        return file.is_open();
+    }
+
+    uint32_t FrameRecorder::InternColor(uint32_t Color) {
+        auto [it, inserted] = colorIndices.try_emplace(Color, (uint32_t)colorIndices.size());
+        if (inserted) newColors.push_back(Color);
+        return it->second;
+    }
+    void FrameRecorder::EncodeCells(const BufferGridCell* Cells, const BufferGridCell* Basis, uint64_t Count, std::vector<uint8_t>& Out) {
+        const BufferGridCell defaultCell;
+        auto changed = [&](uint64_t I) {
+            return !details::CellsEqual(Cells[I], Basis ? Basis[I] : defaultCell);
+        };
+        auto repeatLength = [&](uint64_t I) {
+            uint64_t j = I + 1;
+            while (j < Count && changed(j) && details::CellsEqual(Cells[j], Cells[I])) ++j;
+            return j - I;
+        };
+
+        // Color indices are relative to the running state,
+        // so runs of one color cost nothing after the first
+        // cell.
+
+        uint32_t currentFore = 0xFFFFFFFF;
+        uint32_t currentBack = 0xFFFFFFFF;
+        auto encodeCell = [&](const BufferGridCell& Cell) {
+            uint32_t fore = InternColor(Cell.forecolor);
+            uint32_t back = InternColor(Cell.backcolor);
+            uint64_t flags = (fore != currentFore ? 2 : 0) | (back != currentBack ? 1 : 0);
+            details::WriteVarint(Out, (uint64_t)(uint32_t)Cell.character << 2 | flags);
+            if (fore != currentFore) details::WriteVarint(Out, fore);
+            if (back != currentBack) details::WriteVarint(Out, back);
+            currentFore = fore;
+            currentBack = back;
+        };
+
+        uint64_t skip = 0;
+        uint64_t i = 0;
+        while (i < Count) {
+            if (!changed(i)) {
+                ++skip;
+                ++i;
+                continue;
+            }
+
+            uint64_t repeat = repeatLength(i);
+            if (repeat >= details::minRepeatRun) {
+                details::WriteVarint(Out, skip);
+                details::WriteVarint(Out, repeat << 1 | 1);
+                encodeCell(Cells[i]);
+                skip = 0;
+                i += repeat;
+                continue;
+            }
+
+            uint64_t runEnd = i + 1;
+            while (runEnd < Count && changed(runEnd) && repeatLength(runEnd) < details::minRepeatRun) ++runEnd;
+            details::WriteVarint(Out, skip);
+            details::WriteVarint(Out, (runEnd - i) << 1);
+            for (; i < runEnd; ++i) encodeCell(Cells[i]);
+            skip = 0;
+        }
+    }
+    void FrameRecorder::WriteRecord(RecordType Type, const std::vector<uint8_t>& Payload) {
+        size_t before = pending.size();
+        pending.push_back((uint8_t)Type);
+        details::WriteVarint(pending, Payload.size());
+        pending.insert(pending.end(), Payload.begin(), Payload.end());
+        fileOffset += pending.size() - before;
+
+        if (pending.size() >= details::flushThreshold) Flush();
+    }
+    void FrameRecorder::Flush() {
+        if (pending.empty()) return;
+        file.write((const char*)pending.data(), (std::streamsize)pending.size());
+        file.flush();
+        pending.clear();
+    }
+
+    void FrameRecorder::AddFrame(BufferGrid Frame) {
+        AddFrame(Frame, details::NowNs());
+    }
+    void FrameRecorder::AddFrame(BufferGrid Frame, uint64_t TimeNs) {
+        if (!file.is_open()) return;
+
+        uint64_t timeUs = TimeNs > startNs ? (TimeNs - startNs) / 1000 : 0;
+        if (timeUs < lastFrameUs) timeUs = lastFrameUs;
+        uint64_t cellCount = (uint64_t)Frame.width * Frame.height;
+
+        bool keyframe = !frameCount || Frame.size != previousSize || framesSinceKeyframe >= keyframeInterval;
+
+        cells.clear();
+        newColors.clear();
+        if (keyframe) {
+            colorIndices.clear();
+            EncodeCells(Frame.buffer, 0, cellCount, cells);
+        }
+        else EncodeCells(Frame.buffer, previous.data(), cellCount, cells);
+
+        payload.clear();
+        details::WriteVarint(payload, keyframe ? timeUs : timeUs - lastFrameUs);
+        if (keyframe) {
+            details::WriteVarint(payload, Frame.width);
+            details::WriteVarint(payload, Frame.height);
+        }
+        details::WriteVarint(payload, newColors.size());
+        for (uint32_t color : newColors) details::WriteU32(payload, color);
+        payload.insert(payload.end(), cells.begin(), cells.end());
+
+        if (keyframe) {
+            keyframes.emplace_back(frameCount, fileOffset, timeUs);
+            framesSinceKeyframe = 0;
+        }
+        WriteRecord(keyframe ? RecordTypeKeyframe : RecordTypeDelta, payload);
+
+        previous.assign(Frame.buffer, Frame.buffer + cellCount);
+        previousSize = Frame.size;
+        lastFrameUs = timeUs;
+        ++frameCount;
+        ++framesSinceKeyframe;
+    }
+
+    uint64_t FrameRecorder::FrameCount() const {
+        return frameCount;
+    }
+    uint64_t FrameRecorder::BytesWritten() const {
+        return fileOffset;
+    }
+
+    FramePlayer::FramePlayer()
+        : frameCount(0), frameSize(), nextOffset(0), currentFrame(0), currentTimeUs(0) { }
+
+    bool FramePlayer::Open(const std::filesystem::path& Path) {
+        Close();
+
+        if (!file.Open(Path)) return false;
+        if (file.Size() < sizeof(details::recordingMagic) || memcmp(file.Data(), details::recordingMagic, sizeof(details::recordingMagic))) {
+            Close();
+            return false;
+        }
+
+        if (!ReadIndex()) ScanRecords();
+        if (!frameCount || keyframes.empty()) return true;
+        return SeekToFrame(0);
+    }
+    void FramePlayer::Close() {
+        file.Close();
+        keyframes.clear();
+        frameCount = 0;
+        frame.clear();
+        frameSize = SizeU32();
+        palette.clear();
+        nextOffset = 0;
+        currentFrame = 0;
+        currentTimeUs = 0;
+    }
+    bool FramePlayer::IsOpen() const {
+        return file.IsOpen();
+    }
+
+    bool FramePlayer::ReadIndex() {
+        uint64_t size = file.Size();
+        const uint8_t* data = file.Data();
+        if (size < sizeof(details::recordingMagic) + details::footerSize) return false;
+        if (memcmp(data + size - sizeof(details::indexMagic), details::indexMagic, sizeof(details::indexMagic))) return false;
+
+        uint64_t indexOffset = 0;
+        for (uint32_t i = 0; i < 8; ++i) indexOffset |= (uint64_t)data[size - details::footerSize + i] << (i * 8);
+        uint64_t end = size - details::footerSize;
+        if (indexOffset < sizeof(details::recordingMagic) || indexOffset >= end) return false;
+
+        details::ByteReader reader(data, indexOffset, end);
+        if (reader.ReadU8() != RecordTypeIndex) return false;
+        uint64_t payloadLength = reader.ReadVarint();
+        if (reader.failed || payloadLength > end - reader.position) return false;
+        reader.end = reader.position + payloadLength;
+
+        uint64_t frames = reader.ReadVarint();
+        uint64_t count = reader.ReadVarint();
+        if (reader.failed || count > payloadLength) return false;
+        std::vector<RecordingKeyframe> index;
+        index.reserve((size_t)count);
+        for (uint64_t i = 0; i < count; ++i) {
+            uint64_t frameIndex = reader.ReadVarint();
+            uint64_t offset = reader.ReadVarint();
+            uint64_t timeUs = reader.ReadVarint();
+            if (reader.failed || offset >= indexOffset || frameIndex >= frames) return false;
+            index.emplace_back(frameIndex, offset, timeUs);
+        }
+
+        keyframes = std::move(index);
+        frameCount = frames;
+        return true;
+    }
+    void FramePlayer::ScanRecords() {
+        keyframes.clear();
+        frameCount = 0;
+
+        // Only the record headers and keyframe times are
+        // read; a truncated trailing record ends the scan.
+
+        details::ByteReader reader(file.Data(), sizeof(details::recordingMagic), file.Size());
+        uint64_t timeUs = 0;
+        while (!reader.AtEnd()) {
+            uint64_t offset = reader.position;
+            uint8_t type = reader.ReadU8();
+            uint64_t payloadLength = reader.ReadVarint();
+            if (reader.failed || payloadLength > reader.end - reader.position) break;
+            if (type != RecordTypeKeyframe && type != RecordTypeDelta) break;
+
+            details::ByteReader payloadReader(file.Data(), reader.position, reader.position + payloadLength);
+            uint64_t time = payloadReader.ReadVarint();
+            if (payloadReader.failed) break;
+            timeUs = type == RecordTypeKeyframe ? time : timeUs + time;
+            if (type == RecordTypeKeyframe) keyframes.emplace_back(frameCount, offset, timeUs);
+            else if (keyframes.empty()) break;
+
+            reader.position += payloadLength;
+            ++frameCount;
+        }
+    }
+    bool FramePlayer::DecodeRecord(uint64_t Offset, uint64_t& NextOffset) {
+        details::ByteReader reader(file.Data(), Offset, file.Size());
+        uint8_t type = reader.ReadU8();
+        uint64_t payloadLength = reader.ReadVarint();
+        if (reader.failed || payloadLength > reader.end - reader.position) return false;
+        if (type != RecordTypeKeyframe && type != RecordTypeDelta) return false;
+        reader.end = reader.position + payloadLength;
+        NextOffset = reader.end;
+
+        uint64_t time = reader.ReadVarint();
+        if (type == RecordTypeKeyframe) {
+            uint64_t width = reader.ReadVarint();
+            uint64_t height = reader.ReadVarint();
+            if (reader.failed || width > 0xFFFFFFFF || height > 0xFFFFFFFF) return false;
+            frameSize = SizeU32((uint32_t)width, (uint32_t)height);
+            frame.assign((size_t)width * height, BufferGridCell());
+            palette.clear();
+            currentTimeUs = time;
+        }
+        else currentTimeUs += time;
+
+        uint64_t newColorCount = reader.ReadVarint();
+        if (reader.failed || newColorCount > payloadLength / 4) return false;
+        for (uint64_t i = 0; i < newColorCount; ++i) palette.push_back(reader.ReadU32());
+
+        uint32_t currentFore = 0;
+        uint32_t currentBack = 0;
+        auto decodeCell = [&](BufferGridCell& Cell) {
+            uint64_t head = reader.ReadVarint();
+            if (head & 2) currentFore = (uint32_t)reader.ReadVarint();
+            if (head & 1) currentBack = (uint32_t)reader.ReadVarint();
+            if (currentFore >= palette.size() || currentBack >= palette.size()) {
+                reader.failed = true;
+                return;
+            }
+            Cell = BufferGridCell((wchar_t)(head >> 2), palette[currentFore], palette[currentBack]);
+        };
+
+        uint64_t position = 0;
+        uint64_t cellCount = frame.size();
+        while (!reader.AtEnd() && !reader.failed) {
+            uint64_t skip = reader.ReadVarint();
+            uint64_t run = reader.ReadVarint();
+            uint64_t count = run >> 1;
+            if (reader.failed || skip > cellCount - position || count > cellCount - position - skip) return false;
+            position += skip;
+
+            if (run & 1) {
+                BufferGridCell cell;
+                decodeCell(cell);
+                std::fill_n(frame.begin() + position, count, cell);
+                position += count;
+            }
+            else for (uint64_t i = 0; i < count && !reader.failed; ++i) decodeCell(frame[position++]);
+        }
+        return !reader.failed;
+    }
+
+    uint64_t FramePlayer::FrameCount() const {
+        return frameCount;
+    }
+    const std::vector<RecordingKeyframe>& FramePlayer::Keyframes() const {
+        return keyframes;
+    }
+
+    bool FramePlayer::SeekToFrame(uint64_t FrameIndex) {
+        if (FrameIndex >= frameCount || keyframes.empty()) return false;
+
+        // Stepping forward from the current frame is cheaper
+        // than going back to a keyframe, unless a keyframe
+        // lies in between.
+
+        auto keyframe = std::upper_bound(keyframes.begin(), keyframes.end(), FrameIndex, [](uint64_t Index, const RecordingKeyframe& Keyframe) {
+            return Index < Keyframe.frameIndex;
+        });
+        if (keyframe == keyframes.begin()) return false;
+        --keyframe;
+
+        bool continueForward = !frame.empty() && FrameIndex >= currentFrame && currentFrame >= keyframe->frameIndex;
+        if (!continueForward) {
+            uint64_t next;
+            if (!DecodeRecord(keyframe->offset, next)) return false;
+            nextOffset = next;
+            currentFrame = keyframe->frameIndex;
+        }
+        while (currentFrame < FrameIndex)
+            if (!NextFrame()) return false;
+        return true;
+    }
+    bool FramePlayer::SeekToTime(uint64_t TimeUs) {
+        if (keyframes.empty()) return false;
+
+        auto keyframe = std::upper_bound(keyframes.begin(), keyframes.end(), TimeUs, [](uint64_t Time, const RecordingKeyframe& Keyframe) {
+            return Time < Keyframe.timeUs;
+        });
+        if (keyframe != keyframes.begin()) --keyframe;
+        if (!SeekToFrame(keyframe->frameIndex)) return false;
+
+        // Stop on the last frame shown at or before TimeUs.
+
+        while (currentFrame + 1 < frameCount) {
+            uint64_t savedOffset = nextOffset;
+            details::ByteReader reader(file.Data(), nextOffset, file.Size());
+            reader.ReadU8();
+            uint64_t payloadLength = reader.ReadVarint();
+            if (reader.failed || payloadLength > reader.end - reader.position) break;
+            details::ByteReader payloadReader(file.Data(), reader.position, reader.position + payloadLength);
+            uint64_t time = payloadReader.ReadVarint();
+            uint64_t nextTime = file.Data()[savedOffset] == RecordTypeKeyframe ? time : currentTimeUs + time;
+            if (payloadReader.failed || nextTime > TimeUs) break;
+            if (!NextFrame()) return false;
+        }
+        return true;
+    }
+    bool FramePlayer::NextFrame() {
+        if (currentFrame + 1 >= frameCount) return false;
+        uint64_t next;
+        if (!DecodeRecord(nextOffset, next)) return false;
+        nextOffset = next;
+        ++currentFrame;
+        return true;
+    }
+
+    BufferGrid FramePlayer::CurrentFrame() {
+        return BufferGrid(frameSize, frame.data());
+    }
+    uint64_t FramePlayer::CurrentFrameIndex() const {
+        return currentFrame;
+    }
+    uint64_t FramePlayer::CurrentTimeUs() const {
+        return currentTimeUs;
+    }
+}
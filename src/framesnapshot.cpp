@@ -0,0 +1,80 @@
+#include <brendantui/framesnapshot.h>
+
+namespace btui {
+    FrameSnapshot::FrameSnapshot()
+        : size(), sequence(0), timeNs(0), cells(), capacity(0) { }
+
+    SizeU32 FrameSnapshot::Size() const {
+        return size;
+    }
+    uint64_t FrameSnapshot::Sequence() const {
+        return sequence;
+    }
+    uint64_t FrameSnapshot::TimeNs() const {
+        return timeNs;
+    }
+
+    const BufferGridCell* FrameSnapshot::Cells() const {
+        return cells.get();
+    }
+    BufferGridCell* FrameSnapshot::Cells() {
+        return cells.get();
+    }
+    const BufferGridCell& FrameSnapshot::At(uint32_t X, uint32_t Y) const {
+        return cells[(size_t)Y * size.width + X];
+    }
+
+    BufferGrid FrameSnapshot::Grid() const {
+        return BufferGrid(size, cells.get());
+    }
+
+    namespace details {
+        FrameSnapshotPool::FrameSnapshotPool(uint32_t MaxFree)
+            : shared(std::make_shared<Shared>(MaxFree)) { }
+
+        std::shared_ptr<FrameSnapshot> FrameSnapshotPool::Acquire(SizeU32 Size, uint64_t Sequence, uint64_t TimeNs) {
+            size_t cellCount = (size_t)Size.width * Size.height;
+
+            // Prefer a free snapshot that is already big
+            // enough; otherwise grow the most recently
+            // released one.
+
+            std::unique_ptr<FrameSnapshot> snapshot;
+            {
+                std::lock_guard<std::mutex> lock(shared->mtx);
+                for (size_t i = shared->free.size(); i-- > 0;) {
+                    if (shared->free[i]->capacity >= cellCount) {
+                        snapshot = std::move(shared->free[i]);
+                        shared->free.erase(shared->free.begin() + i);
+                        break;
+                    }
+                }
+                if (!snapshot && !shared->free.empty()) {
+                    snapshot = std::move(shared->free.back());
+                    shared->free.pop_back();
+                }
+            }
+            if (!snapshot) snapshot = std::make_unique<FrameSnapshot>();
+            if (snapshot->capacity < cellCount) {
+                snapshot->cells = std::make_unique<BufferGridCell[]>(cellCount);
+                snapshot->capacity = cellCount;
+                shared->allocations.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            snapshot->size = Size;
+            snapshot->sequence = Sequence;
+            snapshot->timeNs = TimeNs;
+
+            std::shared_ptr<Shared> owner = shared;
+            return std::shared_ptr<FrameSnapshot>(snapshot.release(), [owner](FrameSnapshot* Snapshot) {
+                std::unique_ptr<FrameSnapshot> released(Snapshot);
+                std::lock_guard<std::mutex> lock(owner->mtx);
+                if (owner->free.size() < owner->maxFree) owner->free.push_back(std::move(released));
+            });
+        }
+
+        uint64_t FrameSnapshotPool::Allocations() const {
+            return shared->allocations.load(std::memory_order_relaxed);
+        }
+    }
+}
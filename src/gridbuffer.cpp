@@ -0,0 +1,101 @@
+#include <brendantui/gridbuffer.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace btui {
+    GridBuffer::GridBuffer()
+        : cells(), capacity(0), size() { }
+    GridBuffer::GridBuffer(SizeU32 Size, BufferGridCell Fill)
+        : cells(), capacity(0), size() {
+        Resize(Size, false, Fill);
+    }
+
+    GridBuffer::GridBuffer(GridBuffer&& Other) noexcept
+        : cells(std::move(Other.cells)), capacity(Other.capacity), size(Other.size) {
+        Other.capacity = 0;
+        Other.size = SizeU32();
+    }
+    GridBuffer& GridBuffer::operator=(GridBuffer&& Other) noexcept {
+        if (this == &Other) return *this;
+        cells = std::move(Other.cells);
+        capacity = Other.capacity;
+        size = Other.size;
+        Other.capacity = 0;
+        Other.size = SizeU32();
+        return *this;
+    }
+
+    bool GridBuffer::Resize(SizeU32 NewSize, bool PreserveContent, BufferGridCell Fill) {
+        size_t newCount = (size_t)NewSize.width * NewSize.height;
+        SizeU32 oldSize = size;
+        uint32_t copyWidth = PreserveContent ? std::min(oldSize.width, NewSize.width) : 0;
+        uint32_t copyHeight = PreserveContent && copyWidth ? std::min(oldSize.height, NewSize.height) : 0;
+
+        bool reallocated = newCount > capacity;
+        if (reallocated) {
+            size_t newCapacity = std::max(newCount, capacity + capacity / 2);
+            std::unique_ptr<BufferGridCell[]> newCells(new BufferGridCell[newCapacity]);
+            for (uint32_t y = 0; y < copyHeight; ++y)
+                memcpy(newCells.get() + (size_t)y * NewSize.width, cells.get() + (size_t)y * oldSize.width, sizeof(BufferGridCell) * copyWidth);
+            cells = std::move(newCells);
+            capacity = newCapacity;
+        }
+        else if (copyHeight && NewSize.width > oldSize.width) {
+            // Rows move towards the end, so go bottom-up.
+            for (uint32_t y = copyHeight; y-- > 0;)
+                memmove(cells.get() + (size_t)y * NewSize.width, cells.get() + (size_t)y * oldSize.width, sizeof(BufferGridCell) * copyWidth);
+        }
+        else if (copyHeight && NewSize.width < oldSize.width) {
+            for (uint32_t y = 1; y < copyHeight; ++y)
+                memmove(cells.get() + (size_t)y * NewSize.width, cells.get() + (size_t)y * oldSize.width, sizeof(BufferGridCell) * copyWidth);
+        }
+
+        size = NewSize;
+
+        BufferGridCell* data = cells.get();
+        if (copyWidth < NewSize.width)
+            for (uint32_t y = 0; y < copyHeight; ++y)
+                std::fill(data + (size_t)y * NewSize.width + copyWidth, data + (size_t)(y + 1) * NewSize.width, Fill);
+        std::fill(data + (size_t)copyHeight * NewSize.width, data + newCount, Fill);
+
+        return reallocated;
+    }
+    void GridBuffer::ShrinkToFit() {
+        size_t count = (size_t)size.width * size.height;
+        if (capacity == count) return;
+        if (!count) {
+            Release();
+            return;
+        }
+        std::unique_ptr<BufferGridCell[]> newCells(new BufferGridCell[count]);
+        memcpy(newCells.get(), cells.get(), sizeof(BufferGridCell) * count);
+        cells = std::move(newCells);
+        capacity = count;
+    }
+    void GridBuffer::Release() {
+        cells.reset();
+        capacity = 0;
+        size = SizeU32();
+    }
+
+    SizeU32 GridBuffer::Size() const {
+        return size;
+    }
+    size_t GridBuffer::Capacity() const {
+        return capacity;
+    }
+    BufferGridCell* GridBuffer::Data() {
+        return cells.get();
+    }
+    const BufferGridCell* GridBuffer::Data() const {
+        return cells.get();
+    }
+    BufferGrid GridBuffer::Grid() {
+        return BufferGrid(size, cells.get());
+    }
+
+    GridBuffer::operator bool() const {
+        return (bool)cells;
+    }
+}
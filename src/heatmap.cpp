@@ -0,0 +1,275 @@
+﻿#include <brendantui/heatmap.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <brendantui/simd.h>
+
+namespace btui {
+    ColorLut MakeColorLut(std::initializer_list<uint32_t> Stops) {
+        ColorLut lut;
+        if (!Stops.size()) return lut;
+        const uint32_t* stops = Stops.begin();
+        if (Stops.size() == 1) {
+            lut.colors.fill(stops[0]);
+            return lut;
+        }
+
+        uint32_t segments = (uint32_t)Stops.size() - 1;
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t position = i * segments;
+            uint32_t segment = std::min(position / 255, segments - 1);
+            uint32_t t = position - segment * 255; //0 to 255 within the segment
+            uint32_t a = stops[segment];
+            uint32_t b = stops[segment + 1];
+            uint32_t color = 0;
+            for (uint32_t shift = 0; shift < 32; shift += 8) {
+                uint32_t ca = (a >> shift) & 0xFF;
+                uint32_t cb = (b >> shift) & 0xFF;
+                color |= ((ca * (255 - t) + cb * t + 127) / 255) << shift;
+            }
+            lut.colors[i] = color;
+        }
+        return lut;
+    }
+
+    namespace details {
+        template <HeatmapReduce _Reduce>
+        static inline float Combine(float A, float B) {
+            if constexpr (_Reduce == HeatmapReduceMean) return A + B;
+            else if constexpr (_Reduce == HeatmapReduceMax) return std::max(A, B);
+            else return std::min(A, B);
+        }
+        template <HeatmapReduce _Reduce>
+        static constexpr float Identity() {
+            if constexpr (_Reduce == HeatmapReduceMean) return 0.0f;
+            else if constexpr (_Reduce == HeatmapReduceMax) return -std::numeric_limits<float>::infinity();
+            else return std::numeric_limits<float>::infinity();
+        }
+#ifdef BTUI_SSE2
+        template <HeatmapReduce _Reduce>
+        static inline __m128 Combine(__m128 A, __m128 B) {
+            if constexpr (_Reduce == HeatmapReduceMean) return _mm_add_ps(A, B);
+            else if constexpr (_Reduce == HeatmapReduceMax) return _mm_max_ps(A, B);
+            else return _mm_min_ps(A, B);
+        }
+#endif
+
+        template <HeatmapReduce _Reduce>
+        static inline float ReduceRow(const float* Row, uint32_t Count, float Accumulator) {
+            uint32_t i = 0;
+#ifdef BTUI_SSE2
+            if (Count >= 8) {
+                __m128 v = _mm_loadu_ps(Row);
+                for (i = 4; i + 4 <= Count; i += 4) v = Combine<_Reduce>(v, _mm_loadu_ps(Row + i));
+                float lanes[4];
+                _mm_storeu_ps(lanes, v);
+                Accumulator = Combine<_Reduce>(Accumulator, Combine<_Reduce>(Combine<_Reduce>(lanes[0], lanes[1]), Combine<_Reduce>(lanes[2], lanes[3])));
+            }
+#endif
+            for (; i < Count; ++i) Accumulator = Combine<_Reduce>(Accumulator, Row[i]);
+            return Accumulator;
+        }
+
+        template <HeatmapReduce _Reduce>
+        static inline float ReduceBlock(const HeatmapLevel& Level, uint32_t X0, uint32_t X1, uint32_t Y0, uint32_t Y1) {
+            float accumulator = Identity<_Reduce>();
+            const float* row = Level.data + (size_t)Y0 * Level.stride + X0;
+            for (uint32_t y = Y0; y < Y1; ++y, row += Level.stride) accumulator = ReduceRow<_Reduce>(row, X1 - X0, accumulator);
+            if constexpr (_Reduce == HeatmapReduceMean) accumulator /= (float)((size_t)(X1 - X0) * (Y1 - Y0));
+            return accumulator;
+        }
+
+        // Halves Source on both axes into Dest, for rows
+        // [Y0, Y1) and columns [X0, X1) of Dest. An odd
+        // last row or column is paired with itself.
+
+        template <HeatmapReduce _Reduce>
+        static void ReduceLevel(const HeatmapLevel& Source, float* Dest, size_t DestStride, uint32_t X0, uint32_t Y0, uint32_t X1, uint32_t Y1) {
+            for (uint32_t y = Y0; y < Y1; ++y) {
+                const float* a = Source.data + (size_t)(2 * y) * Source.stride;
+                const float* b = 2 * y + 1 < Source.height ? a + Source.stride : a;
+                float* out = Dest + (size_t)y * DestStride;
+
+                uint32_t x = X0;
+#ifdef BTUI_SSE2
+                for (; 2 * (x + 4) <= Source.width && x + 4 <= X1; x += 4) {
+                    __m128 lo = Combine<_Reduce>(_mm_loadu_ps(a + 2 * x), _mm_loadu_ps(b + 2 * x));
+                    __m128 hi = Combine<_Reduce>(_mm_loadu_ps(a + 2 * x + 4), _mm_loadu_ps(b + 2 * x + 4));
+                    __m128 v = Combine<_Reduce>(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+                    if constexpr (_Reduce == HeatmapReduceMean) v = _mm_mul_ps(v, _mm_set1_ps(0.25f));
+                    _mm_storeu_ps(out + x, v);
+                }
+#endif
+                for (; x < X1; ++x) {
+                    uint32_t x0 = 2 * x;
+                    uint32_t x1 = x0 + 1 < Source.width ? x0 + 1 : x0;
+                    float v = Combine<_Reduce>(Combine<_Reduce>(a[x0], a[x1]), Combine<_Reduce>(b[x0], b[x1]));
+                    if constexpr (_Reduce == HeatmapReduceMean) v *= 0.25f;
+                    out[x] = v;
+                }
+            }
+        }
+
+        // The level cells [Start, End) a block of pixels
+        // covers along one axis. Start == End when the
+        // block is outside the matrix.
+
+        struct HeatmapSpan {
+            uint32_t start;
+            uint32_t end;
+        };
+
+        static void MapSpans(HeatmapSpan* Spans, uint32_t Count, uint32_t PixelsPerView, double View, double ViewLength, uint32_t Shift, uint32_t LevelLength) {
+            double step = ViewLength / PixelsPerView;
+            double scale = 1.0 / (double)(1ull << Shift);
+            for (uint32_t i = 0; i < Count; ++i) {
+                double p0 = std::floor((View + i * step) * scale);
+                double p1 = std::floor((View + (i + 1) * step) * scale);
+                if (p0 >= LevelLength || (p0 < 0 && p1 <= 0)) {
+                    Spans[i] = { 0, 0 };
+                    continue;
+                }
+                uint32_t start = p0 < 0 ? 0 : (uint32_t)p0;
+                uint32_t end = p1 > LevelLength ? LevelLength : (uint32_t)p1;
+                Spans[i] = { start, std::max(end, start + 1) };
+            }
+        }
+
+        template <HeatmapReduce _Reduce>
+        static void DrawLevel(BufferGrid Buffer, RectU32 Rect, uint32_t Width, uint32_t Height, const HeatmapLevel& Level, const HeatmapSpan* Columns, const HeatmapSpan* Rows, float Low, float Scale, const ColorLut& Lut, uint32_t Backcolor) {
+            for (uint32_t row = 0; row < Height; ++row) {
+                BufferGridCell* cells = Buffer.buffer + (size_t)(Rect.y + row) * Buffer.width + Rect.x;
+                HeatmapSpan top = Rows[2 * row];
+                HeatmapSpan bottom = Rows[2 * row + 1];
+                for (uint32_t column = 0; column < Width; ++column) {
+                    HeatmapSpan span = Columns[column];
+                    uint32_t topColor = Backcolor;
+                    uint32_t bottomColor = Backcolor;
+                    if (span.start != span.end) {
+                        if (top.start != top.end) topColor = Lut.Map(ReduceBlock<_Reduce>(Level, span.start, span.end, top.start, top.end), Low, Scale);
+                        if (bottom.start != bottom.end) bottomColor = Lut.Map(ReduceBlock<_Reduce>(Level, span.start, span.end, bottom.start, bottom.end), Low, Scale);
+                    }
+                    cells[column] = BufferGridCell(L'▀', topColor, bottomColor);
+                }
+            }
+        }
+
+        void DrawHeatmapLevels(BufferGrid Buffer, RectU32 Rect, const HeatmapLevel* Levels, size_t LevelCount, HeatmapReduce Reduce, float ViewX, float ViewY, float ViewWidth, float ViewHeight, float Low, float High, const ColorLut& Lut, uint32_t Backcolor) {
+            if (Rect.x >= Buffer.width || Rect.y >= Buffer.height || !LevelCount) return;
+            uint32_t width = std::min(Rect.width, Buffer.width - Rect.x);
+            uint32_t height = std::min(Rect.height, Buffer.height - Rect.y);
+            if (!width || !height || !(ViewWidth > 0) || !(ViewHeight > 0)) return;
+
+            // Use the coarsest level that still gives every
+            // pixel at least two cells along both axes; with
+            // just one, a block that straddles level cells
+            // picks up too much of its neighbours.
+            double blockWidth = (double)ViewWidth / Rect.width;
+            double blockHeight = (double)ViewHeight / (2.0 * Rect.height);
+            double smallest = std::min(blockWidth, blockHeight);
+            size_t level = 0;
+            while (level + 1 < LevelCount && (double)(4ull << level) <= smallest) ++level;
+            const HeatmapLevel& source = Levels[level];
+
+            thread_local std::vector<HeatmapSpan> spans;
+            spans.resize((size_t)width + 2 * height);
+            HeatmapSpan* columns = spans.data();
+            HeatmapSpan* rows = columns + width;
+            MapSpans(columns, width, Rect.width, ViewX, ViewWidth, source.shift, source.width);
+            MapSpans(rows, 2 * height, 2 * Rect.height, ViewY, ViewHeight, source.shift, source.height);
+
+            float scale = High > Low ? 255.0f / (High - Low) : 0.0f;
+            switch (Reduce) {
+            case HeatmapReduceMean:
+                DrawLevel<HeatmapReduceMean>(Buffer, Rect, width, height, source, columns, rows, Low, scale, Lut, Backcolor);
+                break;
+            case HeatmapReduceMax:
+                DrawLevel<HeatmapReduceMax>(Buffer, Rect, width, height, source, columns, rows, Low, scale, Lut, Backcolor);
+                break;
+            case HeatmapReduceMin:
+                DrawLevel<HeatmapReduceMin>(Buffer, Rect, width, height, source, columns, rows, Low, scale, Lut, Backcolor);
+                break;
+            }
+        }
+    }
+
+    void DrawHeatmap(BufferGrid Buffer, RectU32 Rect, const float* Data, uint32_t Width, uint32_t Height, size_t Stride, HeatmapReduce Reduce, float Low, float High, const ColorLut& Lut) {
+        details::HeatmapLevel level(Data, Width, Height, Stride, 0);
+        details::DrawHeatmapLevels(Buffer, Rect, &level, 1, Reduce, 0.0f, 0.0f, (float)Width, (float)Height, Low, High, Lut, 0xFF000000);
+    }
+
+    HeatmapPyramid::HeatmapPyramid()
+        : source(0), width(0), height(0), stride(0), reduce(HeatmapReduceMean) { }
+
+    void HeatmapPyramid::ReduceInto(size_t Level, uint32_t X0, uint32_t Y0, uint32_t X1, uint32_t Y1) {
+        const details::HeatmapLevel& from = levels[Level - 1];
+        const details::HeatmapLevel& to = levels[Level];
+        float* dest = storage[Level - 1].data();
+        switch (reduce) {
+        case HeatmapReduceMean:
+            details::ReduceLevel<HeatmapReduceMean>(from, dest, to.stride, X0, Y0, X1, Y1);
+            break;
+        case HeatmapReduceMax:
+            details::ReduceLevel<HeatmapReduceMax>(from, dest, to.stride, X0, Y0, X1, Y1);
+            break;
+        case HeatmapReduceMin:
+            details::ReduceLevel<HeatmapReduceMin>(from, dest, to.stride, X0, Y0, X1, Y1);
+            break;
+        }
+    }
+
+    void HeatmapPyramid::Build(const float* Data, uint32_t Width, uint32_t Height, size_t Stride, HeatmapReduce Reduce) {
+        source = Data;
+        width = Width;
+        height = Height;
+        stride = Stride;
+        reduce = Reduce;
+        levels.clear();
+        if (!Data || !Width || !Height) {
+            storage.clear();
+            return;
+        }
+
+        levels.emplace_back(Data, Width, Height, Stride, 0);
+        size_t count = 0;
+        while (levels.back().width > 1 || levels.back().height > 1) {
+            const details::HeatmapLevel& previous = levels.back();
+            uint32_t levelWidth = (previous.width + 1) / 2;
+            uint32_t levelHeight = (previous.height + 1) / 2;
+            if (storage.size() <= count) storage.emplace_back();
+            storage[count].resize((size_t)levelWidth * levelHeight);
+            levels.emplace_back(storage[count].data(), levelWidth, levelHeight, levelWidth, previous.shift + 1);
+            ++count;
+            ReduceInto(count, 0, 0, levelWidth, levelHeight);
+        }
+        storage.resize(count);
+    }
+
+    void HeatmapPyramid::Update(RectU32 Region) {
+        if (levels.empty() || Region.x >= width || Region.y >= height) return;
+        uint32_t x0 = Region.x;
+        uint32_t y0 = Region.y;
+        uint32_t x1 = x0 + std::min(Region.width, width - x0);
+        uint32_t y1 = y0 + std::min(Region.height, height - y0);
+        for (size_t level = 1; level < levels.size() && x0 < x1 && y0 < y1; ++level) {
+            x0 /= 2;
+            y0 /= 2;
+            x1 = std::min((x1 + 1) / 2, levels[level].width);
+            y1 = std::min((y1 + 1) / 2, levels[level].height);
+            ReduceInto(level, x0, y0, x1, y1);
+        }
+    }
+
+    size_t HeatmapPyramid::LevelCount() const {
+        return levels.size();
+    }
+    SizeU32 HeatmapPyramid::Size() const {
+        return SizeU32(width, height);
+    }
+
+    void HeatmapPyramid::Draw(BufferGrid Buffer, RectU32 Rect, float ViewX, float ViewY, float ViewWidth, float ViewHeight, float Low, float High, const ColorLut& Lut, uint32_t Backcolor) const {
+        details::DrawHeatmapLevels(Buffer, Rect, levels.data(), levels.size(), reduce, ViewX, ViewY, ViewWidth, ViewHeight, Low, High, Lut, Backcolor);
+    }
+}
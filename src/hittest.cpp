@@ -0,0 +1,79 @@
+#include <brendantui/hittest.h>
+
+#include <algorithm>
+
+namespace btui {
+    HitTestMap::HitTestMap()
+        : ids(), capacity(0), size(), mousePoint(), mouseInside(false), hovered(0) { }
+    HitTestMap::HitTestMap(SizeU32 Size)
+        : ids(), capacity(0), size(), mousePoint(), mouseInside(false), hovered(0) {
+        Resize(Size);
+    }
+
+    void HitTestMap::Resize(SizeU32 NewSize) {
+        size_t count = (size_t)NewSize.width * NewSize.height;
+        if (count > capacity) {
+            capacity = std::max(count, capacity + capacity / 2);
+            ids.reset(new uint32_t[capacity]);
+        }
+        size = NewSize;
+        Clear();
+    }
+    void HitTestMap::Clear() {
+        std::fill_n(ids.get(), (size_t)size.width * size.height, 0u);
+    }
+    SizeU32 HitTestMap::Size() const {
+        return size;
+    }
+
+    void HitTestMap::SetRegion(RectU32 Rect, uint32_t Region) {
+        if (Rect.x >= size.width || Rect.y >= size.height) return;
+        uint32_t width = std::min(Rect.width, size.width - Rect.x);
+        uint32_t height = std::min(Rect.height, size.height - Rect.y);
+        if (!width) return;
+
+        uint32_t* row = ids.get() + (size_t)Rect.y * size.width + Rect.x;
+        if (width == size.width) {
+            std::fill_n(row, (size_t)width * height, Region);
+            return;
+        }
+        for (uint32_t j = 0; j < height; ++j, row += size.width)
+            std::fill_n(row, width, Region);
+    }
+    void HitTestMap::ClearRegion(RectU32 Rect) {
+        SetRegion(Rect, 0);
+    }
+
+    uint32_t HitTestMap::At(uint32_t X, uint32_t Y) const {
+        if (X >= size.width || Y >= size.height) return 0;
+        return ids[(size_t)Y * size.width + X];
+    }
+    uint32_t HitTestMap::At(PointU32 Point) const {
+        return At(Point.x, Point.y);
+    }
+
+    bool HitTestMap::MouseMove(PointU32 Point, uint32_t& Exited, uint32_t& Entered) {
+        mousePoint = Point;
+        mouseInside = true;
+        return Recheck(Exited, Entered);
+    }
+    bool HitTestMap::MouseExit(uint32_t& Exited) {
+        mouseInside = false;
+        Exited = hovered;
+        hovered = 0;
+        return Exited != 0;
+    }
+    bool HitTestMap::Recheck(uint32_t& Exited, uint32_t& Entered) {
+        uint32_t region = mouseInside ? At(mousePoint) : 0;
+        Exited = 0;
+        Entered = 0;
+        if (region == hovered) return false;
+        Exited = hovered;
+        Entered = region;
+        hovered = region;
+        return true;
+    }
+    uint32_t HitTestMap::Hovered() const {
+        return hovered;
+    }
+}
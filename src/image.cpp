@@ -0,0 +1,226 @@
+﻿#include <brendantui/image.h>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+#include <brendantui/simd.h>
+
+namespace btui {
+    namespace details {
+        void ImageAxis::Map(uint32_t SourceLength, uint32_t OutputLength) {
+            taps.resize(OutputLength);
+            weights.clear();
+            double step = (double)SourceLength / OutputLength;
+            for (uint32_t i = 0; i < OutputLength; ++i) {
+                double a = i * step;
+                double b = i + 1 == OutputLength ? SourceLength : (i + 1) * step;
+                uint32_t first = std::min((uint32_t)a, SourceLength - 1);
+                uint32_t end = std::min((uint32_t)std::ceil(b), SourceLength);
+                if (end <= first) end = first + 1;
+
+                taps[i] = ImageTap(first, end - first, (uint32_t)weights.size());
+                for (uint32_t j = first; j < end; ++j)
+                    weights.push_back((float)((std::min(b, (double)j + 1) - std::max(a, (double)j)) / (b - a)));
+            }
+        }
+
+        ImagePlacement PlaceImage(SizeU32 ImageSize, SizeU32 FrameSize, Align HorizontalAlign, Align VerticalAlign) {
+            ImagePlacement placement;
+            if (!ImageSize.width || !ImageSize.height || !FrameSize.width || !FrameSize.height) return placement;
+
+            double scale = std::min((double)FrameSize.width / ImageSize.width, 2.0 * FrameSize.height / ImageSize.height);
+            uint32_t width = (uint32_t)std::clamp(std::round(ImageSize.width * scale), 1.0, (double)FrameSize.width);
+            uint32_t height = (uint32_t)std::clamp(std::round(ImageSize.height * scale), 1.0, 2.0 * FrameSize.height);
+            placement.pixels = SizeU32(width, height);
+            placement.mapping = MakeCanvasIntoFrameMappingInfo(SizeU32(width, (height + 1) / 2), FrameSize, HorizontalAlign, VerticalAlign);
+            return placement;
+        }
+
+        // Area average of the block one output pixel
+        // covers, as ARGB.
+
+        static inline uint32_t SamplePixel(const ImageView& Image, const ImageTap& Column, const float* ColumnWeights, const ImageTap& Row, const float* RowWeights) {
+            const uint8_t* row = Image.pixels + (size_t)Row.first * Image.stride + (size_t)Column.first * 4;
+            uint32_t rgba;
+#ifdef BTUI_SSE2
+            __m128i zero = _mm_setzero_si128();
+            __m128 sum = _mm_setzero_ps();
+            for (uint32_t y = 0; y < Row.count; ++y, row += Image.stride) {
+                __m128 rowSum = _mm_setzero_ps();
+                for (uint32_t x = 0; x < Column.count; ++x) {
+                    int32_t bytes;
+                    memcpy(&bytes, row + 4 * x, 4);
+                    __m128i channels = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+                    rowSum = _mm_add_ps(rowSum, _mm_mul_ps(_mm_cvtepi32_ps(channels), _mm_set1_ps(ColumnWeights[x])));
+                }
+                sum = _mm_add_ps(sum, _mm_mul_ps(rowSum, _mm_set1_ps(RowWeights[y])));
+            }
+            __m128i packed = _mm_cvtps_epi32(sum);
+            packed = _mm_packs_epi32(packed, packed);
+            packed = _mm_packus_epi16(packed, packed);
+            rgba = (uint32_t)_mm_cvtsi128_si32(packed);
+#else
+            float sum[4] = { };
+            for (uint32_t y = 0; y < Row.count; ++y, row += Image.stride) {
+                float rowSum[4] = { };
+                for (uint32_t x = 0; x < Column.count; ++x)
+                    for (int c = 0; c < 4; ++c) rowSum[c] += (float)row[4 * x + c] * ColumnWeights[x];
+                for (int c = 0; c < 4; ++c) sum[c] += rowSum[c] * RowWeights[y];
+            }
+            rgba = 0;
+            for (int c = 0; c < 4; ++c) rgba |= (uint32_t)std::clamp(std::nearbyint(sum[c]), 0.0f, 255.0f) << (8 * c);
+#endif
+            return (rgba & 0xFF00FF00) | (rgba & 0xFF) << 16 | (rgba >> 16 & 0xFF);
+        }
+
+        // Draws canvas columns [X0, X1) of canvas row Row
+        // and returns how many cells were written.
+
+        static uint32_t DrawImageRow(BufferGrid Buffer, RectU32 Rect, const ImageView& Image, const ImagePlacement& Placement, const ImageAxis& Columns, const ImageAxis& Rows, uint32_t Row, uint32_t X0, uint32_t X1, uint32_t Backcolor) {
+            uint32_t left = Rect.x + Placement.mapping.outX;
+            uint32_t y = Rect.y + Placement.mapping.outY + Row;
+            if (y >= Buffer.height || left >= Buffer.width) return 0;
+            X1 = std::min(X1, Buffer.width - left);
+            if (X0 >= X1) return 0;
+
+            const ImageTap& top = Rows.taps[2 * Row];
+            const float* topWeights = Rows.weights.data() + top.weightIndex;
+            bool haveBottom = 2 * Row + 1 < Placement.pixels.height;
+            const ImageTap& bottom = haveBottom ? Rows.taps[2 * Row + 1] : top;
+            const float* bottomWeights = Rows.weights.data() + bottom.weightIndex;
+
+            BufferGridCell* cells = Buffer.buffer + (size_t)y * Buffer.width + left;
+            for (uint32_t x = X0; x < X1; ++x) {
+                const ImageTap& column = Columns.taps[x];
+                const float* columnWeights = Columns.weights.data() + column.weightIndex;
+                uint32_t topColor = SamplePixel(Image, column, columnWeights, top, topWeights);
+                uint32_t bottomColor = haveBottom ? SamplePixel(Image, column, columnWeights, bottom, bottomWeights) : Backcolor;
+                cells[x] = BufferGridCell(L'▀', topColor, bottomColor);
+            }
+            return X1 - X0;
+        }
+
+        // Finds the first and one-past-last pixels that
+        // differ between A and B; Low == High if none do.
+
+        static void DiffRange(const uint8_t* A, const uint8_t* B, uint32_t Pixels, uint32_t& Low, uint32_t& High) {
+            uint32_t low = 0;
+            uint32_t high = Pixels;
+#ifdef BTUI_SSE2
+            for (; low + 4 <= Pixels; low += 4) {
+                int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(A + 4 * low)), _mm_loadu_si128((const __m128i*)(B + 4 * low))));
+                if (mask != 0xFFFF) {
+                    low += std::countr_zero((unsigned)~mask) / 4;
+                    break;
+                }
+            }
+#endif
+            while (low < Pixels && memcmp(A + 4 * low, B + 4 * low, 4) == 0) ++low;
+            if (low == Pixels) {
+                Low = High = 0;
+                return;
+            }
+#ifdef BTUI_SSE2
+            for (; high >= low + 4; high -= 4) {
+                int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(A + 4 * (high - 4))), _mm_loadu_si128((const __m128i*)(B + 4 * (high - 4)))));
+                if (mask != 0xFFFF) {
+                    high -= (std::countl_zero((unsigned)~mask & 0xFFFF) - 16) / 4;
+                    break;
+                }
+            }
+#endif
+            while (memcmp(A + 4 * (high - 1), B + 4 * (high - 1), 4) == 0) --high;
+            Low = low;
+            High = high;
+        }
+    }
+
+    void DrawImage(BufferGrid Buffer, RectU32 Rect, ImageView Image, Align HorizontalAlign, Align VerticalAlign, uint32_t Backcolor) {
+        FillRect(Buffer, Rect, BufferGridCell(L' ', Backcolor, Backcolor));
+        if (!Image.pixels) return;
+        details::ImagePlacement placement = details::PlaceImage(SizeU32(Image.width, Image.height), Rect.size, HorizontalAlign, VerticalAlign);
+        if (!placement.pixels.width) return;
+
+        thread_local details::ImageAxis columns;
+        thread_local details::ImageAxis rows;
+        columns.Map(Image.width, placement.pixels.width);
+        rows.Map(Image.height, placement.pixels.height);
+        for (uint32_t row = 0; row < placement.mapping.ioHeight; ++row)
+            details::DrawImageRow(Buffer, Rect, Image, placement, columns, rows, row, 0, placement.mapping.ioWidth, Backcolor);
+    }
+
+    ImageRenderer::ImageRenderer()
+        : previous(), previousSize(), previousRect(), previousBufferSize(), horizontalAlign(AlignMiddle), verticalAlign(AlignMiddle), backcolor(0), valid(false) { }
+
+    void ImageRenderer::Invalidate() {
+        valid = false;
+    }
+
+    size_t ImageRenderer::Draw(BufferGrid Buffer, RectU32 Rect, ImageView Image, Align HorizontalAlign, Align VerticalAlign, uint32_t Backcolor) {
+        SizeU32 imageSize(Image.width, Image.height);
+        size_t rowBytes = (size_t)Image.width * 4;
+        bool full = !valid || !Image.pixels || imageSize != previousSize || Rect != previousRect || Buffer.size != previousBufferSize
+            || HorizontalAlign != horizontalAlign || VerticalAlign != verticalAlign || Backcolor != backcolor;
+
+        if (full) {
+            FillRect(Buffer, Rect, BufferGridCell(L' ', Backcolor, Backcolor));
+            valid = false;
+            if (!Image.pixels) return 0;
+            placement = details::PlaceImage(imageSize, Rect.size, HorizontalAlign, VerticalAlign);
+            if (!placement.pixels.width) return 0;
+
+            columns.Map(Image.width, placement.pixels.width);
+            rows.Map(Image.height, placement.pixels.height);
+            previous.resize(rowBytes * Image.height);
+            for (uint32_t y = 0; y < Image.height; ++y)
+                memcpy(previous.data() + y * rowBytes, Image.pixels + y * Image.stride, rowBytes);
+            dirtyLow.resize(Image.height);
+            dirtyHigh.resize(Image.height);
+
+            previousSize = imageSize;
+            previousRect = Rect;
+            previousBufferSize = Buffer.size;
+            horizontalAlign = HorizontalAlign;
+            verticalAlign = VerticalAlign;
+            backcolor = Backcolor;
+            valid = true;
+
+            size_t written = 0;
+            for (uint32_t row = 0; row < placement.mapping.ioHeight; ++row)
+                written += details::DrawImageRow(Buffer, Rect, Image, placement, columns, rows, row, 0, placement.mapping.ioWidth, Backcolor);
+            return written;
+        }
+
+        for (uint32_t y = 0; y < Image.height; ++y) {
+            uint8_t* last = previous.data() + y * rowBytes;
+            const uint8_t* current = Image.pixels + y * Image.stride;
+            details::DiffRange(current, last, Image.width, dirtyLow[y], dirtyHigh[y]);
+            if (dirtyLow[y] != dirtyHigh[y])
+                memcpy(last + (size_t)dirtyLow[y] * 4, current + (size_t)dirtyLow[y] * 4, (size_t)(dirtyHigh[y] - dirtyLow[y]) * 4);
+        }
+
+        // A cell is redrawn if its block overlaps the
+        // span of changed pixels in any of its rows.
+        size_t written = 0;
+        const std::vector<details::ImageTap>& columnTaps = columns.taps;
+        for (uint32_t row = 0; row < placement.mapping.ioHeight; ++row) {
+            const details::ImageTap& top = rows.taps[2 * row];
+            const details::ImageTap& bottom = 2 * row + 1 < placement.pixels.height ? rows.taps[2 * row + 1] : top;
+            uint32_t low = Image.width;
+            uint32_t high = 0;
+            for (uint32_t y = top.first; y < bottom.first + bottom.count; ++y) {
+                if (dirtyLow[y] == dirtyHigh[y]) continue;
+                low = std::min(low, dirtyLow[y]);
+                high = std::max(high, dirtyHigh[y]);
+            }
+            if (low >= high) continue;
+
+            uint32_t x0 = (uint32_t)(std::partition_point(columnTaps.begin(), columnTaps.end(), [low](const details::ImageTap& Tap) { return Tap.first + Tap.count <= low; }) - columnTaps.begin());
+            uint32_t x1 = (uint32_t)(std::partition_point(columnTaps.begin(), columnTaps.end(), [high](const details::ImageTap& Tap) { return Tap.first < high; }) - columnTaps.begin());
+            written += details::DrawImageRow(Buffer, Rect, Image, placement, columns, rows, row, x0, x1, Backcolor);
+        }
+        return written;
+    }
+}
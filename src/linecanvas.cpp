@@ -0,0 +1,119 @@
+#include <brendantui/linecanvas.h>
+
+#include <algorithm>
+
+namespace btui {
+    LineCanvas::LineCanvas()
+        : cells(), size(), touched() { }
+    LineCanvas::LineCanvas(SizeU32 Size)
+        : cells((size_t)Size.width * Size.height), size(Size), touched() { }
+
+    void LineCanvas::Resize(SizeU32 NewSize) {
+        cells.assign((size_t)NewSize.width * NewSize.height, Cell());
+        size = NewSize;
+        touched = RectU32();
+    }
+    void LineCanvas::Clear() {
+        for (uint32_t y = touched.y; y < touched.y + touched.height; ++y)
+            std::fill_n(cells.begin() + (size_t)y * size.width + touched.x, touched.width, Cell());
+        touched = RectU32();
+    }
+    SizeU32 LineCanvas::Size() const {
+        return size;
+    }
+
+    void LineCanvas::Connect(uint32_t X, uint32_t Y, uint8_t Connections, LineWeight Weight, uint32_t Backcolor, uint32_t Forecolor) {
+        if (X >= size.width || Y >= size.height) return;
+
+        Cell& cell = cells[(size_t)Y * size.width + X];
+        cell.connections |= Connections;
+        cell.weight = std::max(cell.weight, Weight);
+        cell.backcolor = Backcolor;
+        cell.forecolor = Forecolor;
+
+        if (!touched.width) {
+            touched = RectU32(X, Y, 1, 1);
+            return;
+        }
+        uint32_t endX = std::max(touched.x + touched.width, X + 1);
+        uint32_t endY = std::max(touched.y + touched.height, Y + 1);
+        touched.x = std::min(touched.x, X);
+        touched.y = std::min(touched.y, Y);
+        touched.width = endX - touched.x;
+        touched.height = endY - touched.y;
+    }
+
+    void LineCanvas::HorizontalLine(uint32_t X, uint32_t Y, uint32_t Length, LineWeight Weight, uint32_t Backcolor, uint32_t Forecolor) {
+        if (!Length || X >= size.width || Y >= size.height) return;
+        if (Length == 1) {
+            Connect(X, Y, LineConnectionLeft | LineConnectionRight, Weight, Backcolor, Forecolor);
+            return;
+        }
+
+        uint32_t last = X + Length - 1;
+        uint32_t end = std::min(last, size.width - 1);
+        Connect(X, Y, LineConnectionRight, Weight, Backcolor, Forecolor);
+        for (uint32_t x = X + 1; x <= end; ++x)
+            Connect(x, Y, x == last ? LineConnectionLeft : LineConnectionLeft | LineConnectionRight, Weight, Backcolor, Forecolor);
+    }
+    void LineCanvas::VerticalLine(uint32_t X, uint32_t Y, uint32_t Length, LineWeight Weight, uint32_t Backcolor, uint32_t Forecolor) {
+        if (!Length || X >= size.width || Y >= size.height) return;
+        if (Length == 1) {
+            Connect(X, Y, LineConnectionTop | LineConnectionBottom, Weight, Backcolor, Forecolor);
+            return;
+        }
+
+        uint32_t last = Y + Length - 1;
+        uint32_t end = std::min(last, size.height - 1);
+        Connect(X, Y, LineConnectionBottom, Weight, Backcolor, Forecolor);
+        for (uint32_t y = Y + 1; y <= end; ++y)
+            Connect(X, y, y == last ? LineConnectionTop : LineConnectionTop | LineConnectionBottom, Weight, Backcolor, Forecolor);
+    }
+    void LineCanvas::Box(RectU32 Rect, LineWeight Weight, uint32_t Backcolor, uint32_t Forecolor) {
+        if (!Rect.width || !Rect.height) return;
+        if (Rect.height == 1) {
+            HorizontalLine(Rect.x, Rect.y, Rect.width, Weight, Backcolor, Forecolor);
+            return;
+        }
+        if (Rect.width == 1) {
+            VerticalLine(Rect.x, Rect.y, Rect.height, Weight, Backcolor, Forecolor);
+            return;
+        }
+
+        HorizontalLine(Rect.x, Rect.y, Rect.width, Weight, Backcolor, Forecolor);
+        HorizontalLine(Rect.x, Rect.y + Rect.height - 1, Rect.width, Weight, Backcolor, Forecolor);
+        VerticalLine(Rect.x, Rect.y, Rect.height, Weight, Backcolor, Forecolor);
+        VerticalLine(Rect.x + Rect.width - 1, Rect.y, Rect.height, Weight, Backcolor, Forecolor);
+    }
+    void LineCanvas::Grid(PointU32 Origin, const uint32_t* ColumnWidths, uint32_t ColumnCount, const uint32_t* RowHeights, uint32_t RowCount, LineWeight Weight, uint32_t Backcolor, uint32_t Forecolor) {
+        uint32_t width = 1;
+        for (uint32_t i = 0; i < ColumnCount; ++i) width += ColumnWidths[i] + 1;
+        uint32_t height = 1;
+        for (uint32_t i = 0; i < RowCount; ++i) height += RowHeights[i] + 1;
+
+        uint32_t y = Origin.y;
+        for (uint32_t i = 0; i <= RowCount; ++i) {
+            HorizontalLine(Origin.x, y, width, Weight, Backcolor, Forecolor);
+            if (i < RowCount) y += RowHeights[i] + 1;
+        }
+        uint32_t x = Origin.x;
+        for (uint32_t i = 0; i <= ColumnCount; ++i) {
+            VerticalLine(x, Origin.y, height, Weight, Backcolor, Forecolor);
+            if (i < ColumnCount) x += ColumnWidths[i] + 1;
+        }
+    }
+
+    void LineCanvas::Resolve(BufferGrid Buffer) const {
+        uint32_t endX = std::min(touched.x + touched.width, Buffer.width);
+        uint32_t endY = std::min(touched.y + touched.height, Buffer.height);
+        for (uint32_t y = touched.y; y < endY; ++y) {
+            const Cell* row = cells.data() + (size_t)y * size.width;
+            BufferGridCell* out = Buffer.buffer + (size_t)y * Buffer.width;
+            for (uint32_t x = touched.x; x < endX; ++x) {
+                const Cell& cell = row[x];
+                if (cell.connections)
+                    out[x] = BufferGridCell(LineGlyph(cell.connections, cell.weight), cell.forecolor, cell.backcolor);
+            }
+        }
+    }
+}
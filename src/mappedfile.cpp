@@ -0,0 +1,137 @@
+#include <brendantui/mappedfile.h>
+
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace btui {
+#ifdef _WIN32
+    MappedFile::MappedFile()
+        : data(0), size(0), fileHandle(INVALID_HANDLE_VALUE), mappingHandle(0) { }
+
+    MappedFile::MappedFile(MappedFile&& Other) noexcept
+        : data(Other.data), size(Other.size), fileHandle(Other.fileHandle), mappingHandle(Other.mappingHandle) {
+        Other.data = 0;
+        Other.size = 0;
+        Other.fileHandle = INVALID_HANDLE_VALUE;
+        Other.mappingHandle = 0;
+    }
+    MappedFile& MappedFile::operator=(MappedFile&& Other) noexcept {
+        if (this == &Other) return *this;
+        Close();
+        std::swap(data, Other.data);
+        std::swap(size, Other.size);
+        std::swap(fileHandle, Other.fileHandle);
+        std::swap(mappingHandle, Other.mappingHandle);
+        return *this;
+    }
+
+    bool MappedFile::Open(const std::filesystem::path& Path) {
+        Close();
+
+        fileHandle = CreateFileW(Path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+        if (fileHandle == INVALID_HANDLE_VALUE) return false;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(fileHandle, &fileSize)) {
+            Close();
+            return false;
+        }
+        size = (uint64_t)fileSize.QuadPart;
+        if (!size) return true;
+
+        mappingHandle = CreateFileMappingW(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+        if (!mappingHandle) {
+            Close();
+            return false;
+        }
+        data = (const uint8_t*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+        if (!data) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+    void MappedFile::Close() {
+        if (data) UnmapViewOfFile(data);
+        if (mappingHandle) CloseHandle(mappingHandle);
+        if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+        data = 0;
+        size = 0;
+        fileHandle = INVALID_HANDLE_VALUE;
+        mappingHandle = 0;
+    }
+    bool MappedFile::IsOpen() const {
+        return fileHandle != INVALID_HANDLE_VALUE;
+    }
+#else
+    MappedFile::MappedFile()
+        : data(0), size(0), fileDescriptor(-1) { }
+
+    MappedFile::MappedFile(MappedFile&& Other) noexcept
+        : data(Other.data), size(Other.size), fileDescriptor(Other.fileDescriptor) {
+        Other.data = 0;
+        Other.size = 0;
+        Other.fileDescriptor = -1;
+    }
+    MappedFile& MappedFile::operator=(MappedFile&& Other) noexcept {
+        if (this == &Other) return *this;
+        Close();
+        std::swap(data, Other.data);
+        std::swap(size, Other.size);
+        std::swap(fileDescriptor, Other.fileDescriptor);
+        return *this;
+    }
+
+    bool MappedFile::Open(const std::filesystem::path& Path) {
+        Close();
+
+        fileDescriptor = open(Path.c_str(), O_RDONLY);
+        if (fileDescriptor < 0) return false;
+
+        struct stat fileStat;
+        if (fstat(fileDescriptor, &fileStat)) {
+            Close();
+            return false;
+        }
+        size = (uint64_t)fileStat.st_size;
+        if (!size) return true;
+
+        void* mapping = mmap(0, size, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+        if (mapping == MAP_FAILED) {
+            Close();
+            return false;
+        }
+        data = (const uint8_t*)mapping;
+        return true;
+    }
+    void MappedFile::Close() {
+        if (data) munmap((void*)data, size);
+        if (fileDescriptor >= 0) close(fileDescriptor);
+        data = 0;
+        size = 0;
+        fileDescriptor = -1;
+    }
+    bool MappedFile::IsOpen() const {
+        return fileDescriptor >= 0;
+    }
+#endif
+
+    MappedFile::~MappedFile() {
+        Close();
+    }
+
+    const uint8_t* MappedFile::Data() const {
+        return data;
+    }
+    uint64_t MappedFile::Size() const {
+        return size;
+    }
+}
@@ -0,0 +1,162 @@
+#include <brendantui/perfstats.h>
+
+#include <bit>
+
+namespace btui {
+    namespace details {
+        RollingHistogram::RollingHistogram()
+            : windowEpoch(0), count(0), totalNs(0), maxNs(0) {
+            ClearWindow(0);
+            ClearWindow(1);
+        }
+
+        uint32_t RollingHistogram::BucketIndex(uint64_t Ns) {
+            if (Ns < 4) return (uint32_t)Ns;
+
+            uint32_t msb = (uint32_t)std::bit_width(Ns) - 1;
+            uint32_t sub = (uint32_t)(Ns >> (msb - 2)) & 3;
+            return 4 + (msb - 2) * 4 + sub;
+        }
+        uint64_t RollingHistogram::BucketUpperBound(uint32_t Index) {
+            if (Index < 4) return Index;
+
+            uint32_t msb = (Index - 4) / 4 + 2;
+            uint64_t sub = (Index - 4) % 4;
+            uint64_t lower = (4 + sub) << (msb - 2);
+            return lower + (1ull << (msb - 2)) - 1;
+        }
+        void RollingHistogram::ClearWindow(uint32_t Window) {
+            for (uint32_t i = 0; i < bucketCount; ++i)
+                buckets[Window][i].store(0, std::memory_order_relaxed);
+        }
+
+        void RollingHistogram::Record(uint64_t DurationNs, uint64_t EndNs) {
+            uint64_t epoch = EndNs / windowNs;
+            uint64_t seenEpoch = windowEpoch.load(std::memory_order_relaxed);
+            if (epoch > seenEpoch && windowEpoch.compare_exchange_strong(seenEpoch, epoch, std::memory_order_relaxed)) {
+                ClearWindow(epoch & 1);
+                if (epoch - seenEpoch > 1) ClearWindow((epoch + 1) & 1);
+            }
+
+            buckets[epoch & 1][BucketIndex(DurationNs)].fetch_add(1, std::memory_order_relaxed);
+
+            count.fetch_add(1, std::memory_order_relaxed);
+            totalNs.fetch_add(DurationNs, std::memory_order_relaxed);
+            uint64_t oldMax = maxNs.load(std::memory_order_relaxed);
+            while (DurationNs > oldMax && !maxNs.compare_exchange_weak(oldMax, DurationNs, std::memory_order_relaxed));
+        }
+        DurationSummary RollingHistogram::Summarize(uint64_t NowNs) const {
+            DurationSummary summary;
+            summary.count = count.load(std::memory_order_relaxed);
+            summary.totalNs = totalNs.load(std::memory_order_relaxed);
+            summary.maxNs = maxNs.load(std::memory_order_relaxed);
+
+            // Windows older than the previous one hold stale
+            // samples and are skipped.
+
+            uint64_t epoch = windowEpoch.load(std::memory_order_relaxed);
+            uint64_t nowEpoch = NowNs / windowNs;
+            bool useCurrent = nowEpoch <= epoch + 1;
+            bool usePrevious = nowEpoch <= epoch;
+
+            uint64_t merged[bucketCount];
+            uint64_t total = 0;
+            for (uint32_t i = 0; i < bucketCount; ++i) {
+                merged[i] = 0;
+                if (useCurrent) merged[i] += buckets[epoch & 1][i].load(std::memory_order_relaxed);
+                if (usePrevious) merged[i] += buckets[(epoch + 1) & 1][i].load(std::memory_order_relaxed);
+                total += merged[i];
+            }
+            if (!total) return summary;
+
+            uint64_t p50Rank = (total * 50 + 99) / 100;
+            uint64_t p99Rank = (total * 99 + 99) / 100;
+            uint64_t seen = 0;
+            for (uint32_t i = 0; i < bucketCount; ++i) {
+                if (!merged[i]) continue;
+                seen += merged[i];
+                if (!summary.p50Ns && seen >= p50Rank) summary.p50Ns = BucketUpperBound(i);
+                if (seen >= p99Rank) {
+                    summary.p99Ns = BucketUpperBound(i);
+                    break;
+                }
+            }
+            return summary;
+        }
+        void RollingHistogram::Reset() {
+            ClearWindow(0);
+            ClearWindow(1);
+            count.store(0, std::memory_order_relaxed);
+            totalNs.store(0, std::memory_order_relaxed);
+            maxNs.store(0, std::memory_order_relaxed);
+        }
+
+        WindowCounters::WindowCounters()
+            : paintCount(0), cellsChanged(0), lastPaintCellsChanged(0), bufferReallocations(0), taskQueueDepth(0), taskQueueMaxDepth(0), eventQueueDepth(0), eventQueueMaxDepth(0), eventBacklogs(0) {
+            for (auto& eventCount : eventCounts)
+                eventCount.store(0, std::memory_order_relaxed);
+        }
+
+        void WindowCounters::TaskQueued() {
+            uint64_t depth = taskQueueDepth.fetch_add(1, std::memory_order_relaxed) + 1;
+            uint64_t oldMax = taskQueueMaxDepth.load(std::memory_order_relaxed);
+            while (depth > oldMax && !taskQueueMaxDepth.compare_exchange_weak(oldMax, depth, std::memory_order_relaxed));
+        }
+        void WindowCounters::TaskDequeued() {
+            taskQueueDepth.fetch_sub(1, std::memory_order_relaxed);
+        }
+        void WindowCounters::EventQueued(uint64_t BacklogThreshold) {
+            uint64_t depth = eventQueueDepth.fetch_add(1, std::memory_order_relaxed) + 1;
+            uint64_t oldMax = eventQueueMaxDepth.load(std::memory_order_relaxed);
+            while (depth > oldMax && !eventQueueMaxDepth.compare_exchange_weak(oldMax, depth, std::memory_order_relaxed));
+            if (depth == BacklogThreshold + 1) eventBacklogs.fetch_add(1, std::memory_order_relaxed);
+        }
+        void WindowCounters::EventDequeued() {
+            eventQueueDepth.fetch_sub(1, std::memory_order_relaxed);
+        }
+        void WindowCounters::PaintFinished(uint64_t ChangedCells) {
+            paintCount.fetch_add(1, std::memory_order_relaxed);
+            cellsChanged.fetch_add(ChangedCells, std::memory_order_relaxed);
+            lastPaintCellsChanged.store(ChangedCells, std::memory_order_relaxed);
+        }
+
+        WindowStats WindowCounters::Snapshot() const {
+            uint64_t now = NowNs();
+
+            WindowStats stats;
+            stats.paintCount = paintCount.load(std::memory_order_relaxed);
+            stats.paintTime = paintTime.Summarize(now);
+            stats.paintBufferTime = paintBufferTime.Summarize(now);
+            stats.rasterizeTime = rasterizeTime.Summarize(now);
+            stats.cellsChanged = cellsChanged.load(std::memory_order_relaxed);
+            stats.lastPaintCellsChanged = lastPaintCellsChanged.load(std::memory_order_relaxed);
+            stats.bufferReallocations = bufferReallocations.load(std::memory_order_relaxed);
+            stats.taskQueueDepth = taskQueueDepth.load(std::memory_order_relaxed);
+            stats.taskQueueMaxDepth = taskQueueMaxDepth.load(std::memory_order_relaxed);
+            stats.taskWaitTime = taskWaitTime.Summarize(now);
+            stats.eventQueueDepth = eventQueueDepth.load(std::memory_order_relaxed);
+            stats.eventQueueMaxDepth = eventQueueMaxDepth.load(std::memory_order_relaxed);
+            stats.eventBacklogs = eventBacklogs.load(std::memory_order_relaxed);
+            stats.eventWaitTime = eventWaitTime.Summarize(now);
+            for (uint32_t i = 0; i < EventTypeCount; ++i)
+                stats.eventCounts[i] = eventCounts[i].load(std::memory_order_relaxed);
+            return stats;
+        }
+        void WindowCounters::Reset() {
+            paintCount.store(0, std::memory_order_relaxed);
+            paintTime.Reset();
+            paintBufferTime.Reset();
+            rasterizeTime.Reset();
+            cellsChanged.store(0, std::memory_order_relaxed);
+            lastPaintCellsChanged.store(0, std::memory_order_relaxed);
+            bufferReallocations.store(0, std::memory_order_relaxed);
+            taskQueueMaxDepth.store(taskQueueDepth.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            taskWaitTime.Reset();
+            eventQueueMaxDepth.store(eventQueueDepth.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            eventBacklogs.store(0, std::memory_order_relaxed);
+            eventWaitTime.Reset();
+            for (auto& eventCount : eventCounts)
+                eventCount.store(0, std::memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,257 @@
+#include <brendantui/quantize.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#include <brendantui/simd.h>
+
+namespace btui {
+    const std::array<uint32_t, 16>& Ansi16Palette() {
+        static const std::array<uint32_t, 16> palette = {
+            0xFF000000, 0xFFCD0000, 0xFF00CD00, 0xFFCDCD00, 0xFF0000EE, 0xFFCD00CD, 0xFF00CDCD, 0xFFE5E5E5,
+            0xFF7F7F7F, 0xFFFF0000, 0xFF00FF00, 0xFFFFFF00, 0xFF5C5CFF, 0xFFFF00FF, 0xFF00FFFF, 0xFFFFFFFF
+        };
+        return palette;
+    }
+    const std::array<uint32_t, 256>& Xterm256Palette() {
+        static const std::array<uint32_t, 256> palette = []() {
+            std::array<uint32_t, 256> colors;
+            std::copy(Ansi16Palette().begin(), Ansi16Palette().end(), colors.begin());
+            static const uint32_t levels[6] = { 0, 95, 135, 175, 215, 255 };
+            for (uint32_t i = 0; i < 216; ++i)
+                colors[16 + i] = 0xFF000000 | levels[i / 36] << 16 | levels[i / 6 % 6] << 8 | levels[i % 6];
+            for (uint32_t i = 0; i < 24; ++i) {
+                uint32_t gray = 8 + 10 * i;
+                colors[232 + i] = 0xFF000000 | gray << 16 | gray << 8 | gray;
+            }
+            return colors;
+        }();
+        return palette;
+    }
+
+    ColorQuantizer::ColorQuantizer(ColorTarget Target)
+        : cube(), palette(), paletteSize(0), ditherOffsets() {
+        if (Target == ColorTarget16) Build(Ansi16Palette().data(), 16, 0);
+        else Build(Xterm256Palette().data(), 256, 16);
+    }
+    ColorQuantizer::ColorQuantizer(const uint32_t* Palette, uint32_t Count)
+        : cube(), palette(), paletteSize(0), ditherOffsets() {
+        Build(Palette, std::min(Count, 256u), 0);
+    }
+
+    void ColorQuantizer::Build(const uint32_t* Palette, uint32_t Count, uint32_t FirstMatched) {
+        paletteSize = Count;
+        std::copy(Palette, Palette + Count, palette.begin());
+        cube = std::make_unique<uint8_t[]>(32 * 32 * 32);
+        if (FirstMatched >= Count) return;
+
+        // Nearest by squared distance, with green weighted
+        // most and blue least, roughly as the eye does.
+        for (uint32_t i = 0; i < 32 * 32 * 32; ++i) {
+            int32_t r = (int32_t)(i >> 10) * 8 + 4;
+            int32_t g = (int32_t)(i >> 5 & 31) * 8 + 4;
+            int32_t b = (int32_t)(i & 31) * 8 + 4;
+            uint32_t best = FirstMatched;
+            int32_t bestDistance = INT32_MAX;
+            for (uint32_t j = FirstMatched; j < Count; ++j) {
+                int32_t dr = r - (int32_t)(Palette[j] >> 16 & 0xFF);
+                int32_t dg = g - (int32_t)(Palette[j] >> 8 & 0xFF);
+                int32_t db = b - (int32_t)(Palette[j] & 0xFF);
+                int32_t distance = 3 * dr * dr + 4 * dg * dg + 2 * db * db;
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    best = j;
+                }
+            }
+            cube[i] = (uint8_t)best;
+        }
+
+        // A palette of n colors spread evenly over the
+        // RGB cube is about 256 / cbrt(n) apart per
+        // channel.
+        static const uint8_t bayer[16] = { 0, 8, 2, 10, 12, 4, 14, 6, 3, 11, 1, 9, 15, 7, 13, 5 };
+        double step = 256.0 / std::cbrt((double)(Count - FirstMatched));
+        for (uint32_t i = 0; i < 16; ++i)
+            ditherOffsets[i] = (int32_t)std::lround(((bayer[i] + 0.5) / 16.0 - 0.5) * step);
+    }
+
+    uint32_t ColorQuantizer::PaletteSize() const {
+        return paletteSize;
+    }
+    const uint32_t* ColorQuantizer::Palette() const {
+        return palette.data();
+    }
+
+    uint8_t ColorQuantizer::IndexDithered(uint32_t Color, uint32_t X, uint32_t Y) const {
+        int32_t offset = ditherOffsets[(Y & 3) * 4 + (X & 3)];
+        uint32_t r = (uint32_t)std::clamp((int32_t)(Color >> 16 & 0xFF) + offset, 0, 255);
+        uint32_t g = (uint32_t)std::clamp((int32_t)(Color >> 8 & 0xFF) + offset, 0, 255);
+        uint32_t b = (uint32_t)std::clamp((int32_t)(Color & 0xFF) + offset, 0, 255);
+        return cube[details::QuantizeCubeIndex(r << 16 | g << 8 | b)];
+    }
+
+    void ColorQuantizer::Map(const BufferGridCell* Cells, size_t Count, uint8_t* Forecolors, uint8_t* Backcolors) const {
+        if (!Count) return;
+        const uint8_t* lookup = cube.get();
+        uint32_t lastFore = Cells[0].forecolor;
+        uint32_t lastBack = Cells[0].backcolor;
+        uint8_t foreIndex = lookup[details::QuantizeCubeIndex(lastFore)];
+        uint8_t backIndex = lookup[details::QuantizeCubeIndex(lastBack)];
+        size_t i = 0;
+#ifdef BTUI_SSE2
+        static_assert(sizeof(BufferGridCell) == 12 && offsetof(BufferGridCell, forecolor) == 4 && offsetof(BufferGridCell, backcolor) == 8);
+
+        // Four cells are three vectors of (character,
+        // forecolor, backcolor) triples. A block whose
+        // colors all match the last cell looked up, the
+        // usual case in a UI, costs one compare; others
+        // compute all eight cube indices at once.
+        const __m128i ignore0 = _mm_setr_epi32(-1, 0, 0, -1);
+        const __m128i ignore1 = _mm_setr_epi32(0, 0, -1, 0);
+        const __m128i ignore2 = _mm_setr_epi32(0, -1, 0, 0);
+        const __m128i redMask = _mm_set1_epi32(0x7C00);
+        const __m128i greenMask = _mm_set1_epi32(0x3E0);
+        const __m128i blueMask = _mm_set1_epi32(0x1F);
+        auto cubeIndices = [&](__m128i Colors) {
+            return _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_srli_epi32(Colors, 9), redMask), _mm_and_si128(_mm_srli_epi32(Colors, 6), greenMask)), _mm_and_si128(_mm_srli_epi32(Colors, 3), blueMask));
+        };
+
+        __m128i last0 = _mm_setr_epi32(0, (int)lastFore, (int)lastBack, 0);
+        __m128i last1 = _mm_setr_epi32((int)lastFore, (int)lastBack, 0, (int)lastFore);
+        __m128i last2 = _mm_setr_epi32((int)lastBack, 0, (int)lastFore, (int)lastBack);
+        uint32_t foreRun = foreIndex * 0x01010101u;
+        uint32_t backRun = backIndex * 0x01010101u;
+        for (; i + 4 <= Count; i += 4) {
+            const __m128i* block = reinterpret_cast<const __m128i*>(Cells + i);
+            __m128i v0 = _mm_loadu_si128(block);
+            __m128i v1 = _mm_loadu_si128(block + 1);
+            __m128i v2 = _mm_loadu_si128(block + 2);
+            __m128i same = _mm_and_si128(_mm_and_si128(
+                _mm_or_si128(_mm_cmpeq_epi32(v0, last0), ignore0),
+                _mm_or_si128(_mm_cmpeq_epi32(v1, last1), ignore1)),
+                _mm_or_si128(_mm_cmpeq_epi32(v2, last2), ignore2));
+            if (_mm_movemask_epi8(same) == 0xFFFF) {
+                memcpy(Forecolors + i, &foreRun, 4);
+                memcpy(Backcolors + i, &backRun, 4);
+                continue;
+            }
+
+            __m128i indices01 = _mm_packs_epi32(cubeIndices(v0), cubeIndices(v1));
+            __m128i indices2 = cubeIndices(v2);
+            indices2 = _mm_packs_epi32(indices2, indices2);
+            uint32_t fore =
+                lookup[_mm_extract_epi16(indices01, 1)] |
+                lookup[_mm_extract_epi16(indices01, 4)] << 8 |
+                lookup[_mm_extract_epi16(indices01, 7)] << 16 |
+                (uint32_t)lookup[_mm_extract_epi16(indices2, 2)] << 24;
+            uint32_t back =
+                lookup[_mm_extract_epi16(indices01, 2)] |
+                lookup[_mm_extract_epi16(indices01, 5)] << 8 |
+                lookup[_mm_extract_epi16(indices2, 0)] << 16 |
+                (uint32_t)lookup[_mm_extract_epi16(indices2, 3)] << 24;
+            memcpy(Forecolors + i, &fore, 4);
+            memcpy(Backcolors + i, &back, 4);
+
+            lastFore = Cells[i + 3].forecolor;
+            lastBack = Cells[i + 3].backcolor;
+            last0 = _mm_setr_epi32(0, (int)lastFore, (int)lastBack, 0);
+            last1 = _mm_setr_epi32((int)lastFore, (int)lastBack, 0, (int)lastFore);
+            last2 = _mm_setr_epi32((int)lastBack, 0, (int)lastFore, (int)lastBack);
+            foreRun = (fore >> 24) * 0x01010101u;
+            backRun = (back >> 24) * 0x01010101u;
+        }
+        foreIndex = (uint8_t)foreRun;
+        backIndex = (uint8_t)backRun;
+#endif
+        for (; i < Count; ++i) {
+            uint32_t fore = Cells[i].forecolor;
+            uint32_t back = Cells[i].backcolor;
+            if (fore != lastFore) {
+                lastFore = fore;
+                foreIndex = lookup[details::QuantizeCubeIndex(fore)];
+            }
+            if (back != lastBack) {
+                lastBack = back;
+                backIndex = lookup[details::QuantizeCubeIndex(back)];
+            }
+            Forecolors[i] = foreIndex;
+            Backcolors[i] = backIndex;
+        }
+    }
+    void ColorQuantizer::MapDithered(BufferGrid Buffer, uint8_t* Forecolors, uint8_t* Backcolors) const {
+#ifdef BTUI_SSE2
+        const uint8_t* lookup = cube.get();
+#endif
+        for (uint32_t y = 0; y < Buffer.height; ++y) {
+            size_t row = (size_t)y * Buffer.width;
+            const BufferGridCell* cells = Buffer.buffer + row;
+            uint32_t x = 0;
+#ifdef BTUI_SSE2
+            // Four cells are three vectors of (character,
+            // forecolor, backcolor) triples, as in Map().
+            // Each color lane gets its cell's offset, split
+            // into what to add and what to subtract so both
+            // saturate.
+            uint32_t add[12] = { };
+            uint32_t subtract[12] = { };
+            for (uint32_t i = 0; i < 4; ++i) {
+                int32_t offset = ditherOffsets[(y & 3) * 4 + i];
+                uint32_t up = offset > 0 ? (uint32_t)offset * 0x010101u : 0;
+                uint32_t down = offset < 0 ? (uint32_t)-offset * 0x010101u : 0;
+                add[3 * i + 1] = add[3 * i + 2] = up;
+                subtract[3 * i + 1] = subtract[3 * i + 2] = down;
+            }
+            __m128i add0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(add));
+            __m128i add1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(add + 4));
+            __m128i add2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(add + 8));
+            __m128i subtract0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(subtract));
+            __m128i subtract1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(subtract + 4));
+            __m128i subtract2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(subtract + 8));
+            const __m128i redMask = _mm_set1_epi32(0x7C00);
+            const __m128i greenMask = _mm_set1_epi32(0x3E0);
+            const __m128i blueMask = _mm_set1_epi32(0x1F);
+            auto cubeIndices = [&](__m128i Colors, __m128i Add, __m128i Subtract) {
+                Colors = _mm_subs_epu8(_mm_adds_epu8(Colors, Add), Subtract);
+                return _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_srli_epi32(Colors, 9), redMask), _mm_and_si128(_mm_srli_epi32(Colors, 6), greenMask)), _mm_and_si128(_mm_srli_epi32(Colors, 3), blueMask));
+            };
+            for (; x + 4 <= Buffer.width; x += 4) {
+                const __m128i* block = reinterpret_cast<const __m128i*>(cells + x);
+                __m128i indices01 = _mm_packs_epi32(cubeIndices(_mm_loadu_si128(block), add0, subtract0), cubeIndices(_mm_loadu_si128(block + 1), add1, subtract1));
+                __m128i indices2 = cubeIndices(_mm_loadu_si128(block + 2), add2, subtract2);
+                indices2 = _mm_packs_epi32(indices2, indices2);
+                uint32_t foreIndices =
+                    lookup[_mm_extract_epi16(indices01, 1)] |
+                    lookup[_mm_extract_epi16(indices01, 4)] << 8 |
+                    lookup[_mm_extract_epi16(indices01, 7)] << 16 |
+                    (uint32_t)lookup[_mm_extract_epi16(indices2, 2)] << 24;
+                uint32_t backIndices =
+                    lookup[_mm_extract_epi16(indices01, 2)] |
+                    lookup[_mm_extract_epi16(indices01, 5)] << 8 |
+                    lookup[_mm_extract_epi16(indices2, 0)] << 16 |
+                    (uint32_t)lookup[_mm_extract_epi16(indices2, 3)] << 24;
+                memcpy(Forecolors + row + x, &foreIndices, 4);
+                memcpy(Backcolors + row + x, &backIndices, 4);
+            }
+#endif
+            for (; x < Buffer.width; ++x) {
+                Forecolors[row + x] = IndexDithered(cells[x].forecolor, x, y);
+                Backcolors[row + x] = IndexDithered(cells[x].backcolor, x, y);
+            }
+        }
+    }
+
+    void ColorQuantizer::Apply(BufferGrid Buffer, bool Dither) const {
+        for (uint32_t y = 0; y < Buffer.height; ++y) {
+            BufferGridCell* cells = Buffer.buffer + (size_t)y * Buffer.width;
+            for (uint32_t x = 0; x < Buffer.width; ++x) {
+                BufferGridCell& cell = cells[x];
+                uint8_t fore = Dither ? IndexDithered(cell.forecolor, x, y) : Index(cell.forecolor);
+                uint8_t back = Dither ? IndexDithered(cell.backcolor, x, y) : Index(cell.backcolor);
+                cell.forecolor = (palette[fore] & 0x00FFFFFF) | (cell.forecolor & 0xFF000000);
+                cell.backcolor = (palette[back] & 0x00FFFFFF) | (cell.backcolor & 0xFF000000);
+            }
+        }
+    }
+}
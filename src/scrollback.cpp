@@ -0,0 +1,238 @@
+#include <brendantui/scrollback.h>
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace btui {
+    namespace details {
+        ScrollbackChunk::ScrollbackChunk(uint32_t Capacity, uint32_t LineCapacity)
+            : text(new wchar_t[Capacity]), capacity(Capacity), used(0), rows(0) {
+            lines.reserve(LineCapacity);
+        }
+
+        size_t ScrollbackChunk::Bytes() const {
+            return sizeof(wchar_t) * capacity + sizeof(ScrollbackLine) * lines.capacity();
+        }
+
+        static inline void FreePendingLine(PendingLine* Line) {
+            ::operator delete(Line);
+        }
+    }
+
+    Scrollback::Scrollback(size_t ByteCap, uint32_t TextBackcolor, uint32_t TextForecolor)
+        : pending(0), pendingBytes(0), byteCap(ByteCap), ringBytes(0), totalRows(0), droppedLines(0), lineCount(0), wrapWidth(0), scrollRows(0), textBackcolor(TextBackcolor), textForecolor(TextForecolor) {
+        // Small chunks for small caps, so dropping whole
+        // chunks can always get back under the cap.
+        chunkTextCapacity = (uint32_t)std::clamp<size_t>(byteCap / 8 / sizeof(wchar_t), 64, chunkChars);
+        chunkLineCapacity = (uint32_t)std::clamp<size_t>(byteCap / 8 / sizeof(details::ScrollbackLine), 16, chunkLines);
+        maxLineLength = (uint32_t)std::clamp<size_t>(byteCap / 2 / sizeof(wchar_t), 1, 0xFFFFFFFF);
+    }
+    Scrollback::~Scrollback() {
+        details::PendingLine* line = pending.exchange(0);
+        while (line) {
+            details::PendingLine* next = line->next;
+            details::FreePendingLine(line);
+            line = next;
+        }
+    }
+
+    void Scrollback::Append(std::wstring_view Line) {
+        Append(Line, textForecolor);
+    }
+    void Scrollback::Append(std::wstring_view Line, uint32_t Forecolor) {
+        if (Line.size() > maxLineLength) Line = Line.substr(0, maxLineLength);
+
+        size_t bytes = sizeof(details::PendingLine) + sizeof(wchar_t) * Line.size();
+        details::PendingLine* node = static_cast<details::PendingLine*>(::operator new(bytes));
+        node->length = (uint32_t)Line.size();
+        node->forecolor = Forecolor;
+        if (!Line.empty()) memcpy(node->Text(), Line.data(), sizeof(wchar_t) * Line.size());
+
+        node->next = pending.load(std::memory_order_relaxed);
+        while (!pending.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed));
+
+        // Nobody is drawing (e.g. the window is
+        // minimized); keep the backlog bounded anyway.
+        if (pendingBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes > byteCap) {
+            std::unique_lock<std::mutex> lock(ringMtx, std::try_to_lock);
+            if (lock.owns_lock()) DrainLocked();
+        }
+    }
+
+    void Scrollback::Ingest(details::PendingLine* Line) {
+        uint32_t length = Line->length;
+        if (chunks.empty() || chunks.back().capacity - chunks.back().used < length || chunks.back().lines.size() >= chunkLineCapacity) {
+            chunks.emplace_back(std::max(chunkTextCapacity, length), chunkLineCapacity);
+            ringBytes += chunks.back().Bytes();
+        }
+
+        details::ScrollbackChunk& chunk = chunks.back();
+        if (length) memcpy(chunk.text.get() + chunk.used, Line->Text(), sizeof(wchar_t) * length);
+        size_t oldBytes = chunk.Bytes();
+        chunk.lines.emplace_back(chunk.used, length, Line->forecolor);
+        ringBytes += chunk.Bytes() - oldBytes;
+        chunk.used += length;
+        ++lineCount;
+
+        if (wrapWidth) {
+            uint64_t rows = RowsFor(length, wrapWidth);
+            chunk.rows += rows;
+            totalRows += rows;
+            if (scrollRows) scrollRows += rows;
+        }
+    }
+    void Scrollback::DrainLocked() {
+        details::PendingLine* list = pending.exchange(0, std::memory_order_acquire);
+        if (!list) return;
+
+        // The stack holds the newest line first.
+        details::PendingLine* ordered = 0;
+        while (list) {
+            details::PendingLine* next = list->next;
+            list->next = ordered;
+            ordered = list;
+            list = next;
+        }
+
+        uint64_t drainedBytes = 0;
+        while (ordered) {
+            details::PendingLine* next = ordered->next;
+            Ingest(ordered);
+            drainedBytes += sizeof(details::PendingLine) + sizeof(wchar_t) * ordered->length;
+            details::FreePendingLine(ordered);
+            ordered = next;
+        }
+        pendingBytes.fetch_sub(drainedBytes, std::memory_order_relaxed);
+        Trim();
+    }
+    void Scrollback::Trim() {
+        while (ringBytes > byteCap && chunks.size() > 1) {
+            details::ScrollbackChunk& oldest = chunks.front();
+            ringBytes -= oldest.Bytes();
+            totalRows -= oldest.rows;
+            lineCount -= oldest.lines.size();
+            droppedLines += oldest.lines.size();
+            chunks.pop_front();
+        }
+        scrollRows = std::min(scrollRows, totalRows);
+    }
+    void Scrollback::Rewrap(uint32_t Width) {
+        // Keep the row at the bottom of the view roughly
+        // in place by preserving its fraction of the
+        // total.
+        double position = totalRows ? (double)scrollRows / totalRows : 0;
+
+        wrapWidth = Width;
+        totalRows = 0;
+        for (details::ScrollbackChunk& chunk : chunks) {
+            chunk.rows = 0;
+            for (const details::ScrollbackLine& line : chunk.lines) chunk.rows += RowsFor(line.length, Width);
+            totalRows += chunk.rows;
+        }
+        scrollRows = std::min(totalRows, (uint64_t)(position * totalRows));
+    }
+
+    void Scrollback::Drain() {
+        std::lock_guard<std::mutex> lock(ringMtx);
+        DrainLocked();
+    }
+    void Scrollback::Clear() {
+        std::lock_guard<std::mutex> lock(ringMtx);
+        DrainLocked();
+        droppedLines += lineCount;
+        chunks.clear();
+        ringBytes = 0;
+        totalRows = 0;
+        lineCount = 0;
+        scrollRows = 0;
+    }
+
+    uint64_t Scrollback::LineCount() {
+        std::lock_guard<std::mutex> lock(ringMtx);
+        return lineCount;
+    }
+    uint64_t Scrollback::DroppedLines() {
+        std::lock_guard<std::mutex> lock(ringMtx);
+        return droppedLines;
+    }
+    size_t Scrollback::MemoryBytes() {
+        std::lock_guard<std::mutex> lock(ringMtx);
+        return ringBytes + pendingBytes.load(std::memory_order_relaxed);
+    }
+
+    void Scrollback::ScrollBy(int64_t Rows) {
+        std::lock_guard<std::mutex> lock(ringMtx);
+        if (Rows < 0) scrollRows = (uint64_t)-Rows > scrollRows ? 0 : scrollRows + Rows;
+        else scrollRows = std::min(totalRows, scrollRows + Rows);
+    }
+    void Scrollback::ScrollToBottom() {
+        std::lock_guard<std::mutex> lock(ringMtx);
+        scrollRows = 0;
+    }
+    bool Scrollback::AtBottom() {
+        std::lock_guard<std::mutex> lock(ringMtx);
+        return !scrollRows;
+    }
+
+    void Scrollback::Draw(BufferGrid Buffer, RectU32 Rect) {
+        if (Rect.x >= Buffer.width || Rect.y >= Buffer.height) return;
+        uint32_t width = std::min(Rect.width, Buffer.width - Rect.x);
+        uint32_t height = std::min(Rect.height, Buffer.height - Rect.y);
+        if (!width || !height) return;
+
+        std::lock_guard<std::mutex> lock(ringMtx);
+        DrainLocked();
+        if (width != wrapWidth) Rewrap(width);
+
+        // Rows are counted from the newest one upwards;
+        // find the line holding the top row of the view,
+        // walking back from the end since the view is
+        // usually near it.
+        uint64_t bottom = totalRows - scrollRows;
+        uint64_t top = bottom > height ? bottom - height : 0;
+        uint32_t emptyRows = (uint32_t)(height - (bottom - top));
+
+        size_t chunkIndex = chunks.size();
+        uint64_t chunkStartRow = totalRows;
+        while (chunkIndex && chunkStartRow > top) chunkStartRow -= chunks[--chunkIndex].rows;
+
+        size_t lineIndex = 0;
+        uint64_t lineStartRow = chunkStartRow;
+        uint32_t subRow = 0;
+        if (chunkIndex < chunks.size()) {
+            const details::ScrollbackChunk& chunk = chunks[chunkIndex];
+            while (lineIndex < chunk.lines.size()) {
+                uint64_t rows = RowsFor(chunk.lines[lineIndex].length, width);
+                if (lineStartRow + rows > top) break;
+                lineStartRow += rows;
+                ++lineIndex;
+            }
+            subRow = (uint32_t)(top - lineStartRow);
+        }
+
+        BufferGridCell blank(L' ', textForecolor, textBackcolor);
+        for (uint32_t row = 0; row < height; ++row) {
+            BufferGridCell* cells = Buffer.buffer + (size_t)(Rect.y + row) * Buffer.width + Rect.x;
+            if (row < emptyRows || chunkIndex >= chunks.size()) {
+                std::fill_n(cells, width, blank);
+                continue;
+            }
+
+            const details::ScrollbackChunk& chunk = chunks[chunkIndex];
+            const details::ScrollbackLine& line = chunk.lines[lineIndex];
+            const wchar_t* text = chunk.text.get() + line.offset + (size_t)subRow * width;
+            uint32_t count = line.length > subRow * width ? std::min(width, line.length - subRow * width) : 0;
+            for (uint32_t i = 0; i < width; ++i)
+                cells[i] = i < count ? BufferGridCell(text[i] < L' ' ? L' ' : text[i], line.forecolor, textBackcolor) : blank;
+
+            if (++subRow >= RowsFor(line.length, width)) {
+                subRow = 0;
+                if (++lineIndex >= chunk.lines.size()) {
+                    lineIndex = 0;
+                    ++chunkIndex;
+                }
+            }
+        }
+    }
+}
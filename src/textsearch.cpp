@@ -0,0 +1,199 @@
+#include <brendantui/textsearch.h>
+
+#include <algorithm>
+#include <bit>
+#include <cwctype>
+
+#include <brendantui/simd.h>
+
+namespace btui {
+    TextSearch::TextSearch()
+        : caseSensitive(false), scanPosition(0) { }
+
+    wchar_t TextSearch::FoldCase(wchar_t C) {
+        if (C < 0x80) return C >= L'A' && C <= L'Z' ? C + (L'a' - L'A') : C;
+        return (wchar_t)std::towlower((wint_t)C);
+    }
+    bool TextSearch::Verify(size_t Position, size_t From) const {
+        const wchar_t* candidate = text.data() + Position;
+        if (caseSensitive) {
+            for (size_t i = From; i < query.size(); ++i)
+                if (candidate[i] != query[i]) return false;
+        }
+        else {
+            for (size_t i = From; i < foldedQuery.size(); ++i)
+                if (FoldCase(candidate[i]) != foldedQuery[i]) return false;
+        }
+        return true;
+    }
+    void TextSearch::Scan(size_t Begin, size_t End) {
+        const std::wstring& pattern = caseSensitive ? query : foldedQuery;
+        size_t last = pattern.size() - 1;
+
+        wchar_t first = pattern[0];
+        wchar_t lastChar = pattern[last];
+
+        const wchar_t* data = text.data();
+        size_t i = Begin;
+
+#ifdef BTUI_SSE2
+        // Compares a block of start positions and the block
+        // `last` characters further on in one go; only
+        // positions passing both get verified. Ignoring
+        // case, ASCII is folded in the register and any
+        // other character passes, since several of them
+        // can fold to the same one (U+212A KELVIN SIGN is
+        // a k); Verify() sorts those out.
+        constexpr size_t lanes = 16 / sizeof(wchar_t);
+        constexpr int laneMask = (1 << sizeof(wchar_t)) - 1;
+        auto broadcast = [](wchar_t C) {
+            if constexpr (sizeof(wchar_t) == 2) return _mm_set1_epi16((short)C);
+            else return _mm_set1_epi32((int)C);
+        };
+        auto equal = [](__m128i A, __m128i B) {
+            if constexpr (sizeof(wchar_t) == 2) return _mm_cmpeq_epi16(A, B);
+            else return _mm_cmpeq_epi32(A, B);
+        };
+        auto greater = [](__m128i A, __m128i B) {
+            if constexpr (sizeof(wchar_t) == 2) return _mm_cmpgt_epi16(A, B);
+            else return _mm_cmpgt_epi32(A, B);
+        };
+        __m128i vBeforeA = broadcast(L'A' - 1);
+        __m128i vAfterZ = broadcast(L'Z' + 1);
+        __m128i vCaseBit = broadcast(L'a' - L'A');
+        __m128i vNonAscii = broadcast((wchar_t)~0x7F);
+        __m128i zero = _mm_setzero_si128();
+        auto matchFolded = [&](__m128i Block, __m128i Char) {
+            __m128i upper = _mm_and_si128(greater(Block, vBeforeA), greater(vAfterZ, Block));
+            __m128i folded = _mm_or_si128(Block, _mm_and_si128(upper, vCaseBit));
+            __m128i ascii = equal(_mm_and_si128(Block, vNonAscii), zero);
+            return _mm_or_si128(equal(folded, Char), _mm_andnot_si128(ascii, _mm_cmpeq_epi8(zero, zero)));
+        };
+        __m128i vFirst = broadcast(first);
+        __m128i vLast = broadcast(lastChar);
+        for (; i + lanes <= End; i += lanes) {
+            __m128i head = _mm_loadu_si128((const __m128i*)(data + i));
+            __m128i tail = _mm_loadu_si128((const __m128i*)(data + i + last));
+            __m128i hit = caseSensitive
+                ? _mm_and_si128(equal(head, vFirst), equal(tail, vLast))
+                : _mm_and_si128(matchFolded(head, vFirst), matchFolded(tail, vLast));
+            int mask = _mm_movemask_epi8(hit);
+            while (mask) {
+                int bit = std::countr_zero((unsigned)mask);
+                size_t position = i + bit / sizeof(wchar_t);
+                if (Verify(position, 0)) matches.push_back(position);
+                mask &= ~(laneMask << bit);
+            }
+        }
+#endif
+
+        for (; i < End; ++i) {
+            wchar_t head = caseSensitive ? data[i] : FoldCase(data[i]);
+            wchar_t tail = caseSensitive ? data[i + last] : FoldCase(data[i + last]);
+            if (head == first && tail == lastChar && Verify(i, 0)) matches.push_back(i);
+        }
+    }
+    void TextSearch::Restart() {
+        matches.clear();
+        scanPosition = 0;
+    }
+
+    void TextSearch::SetText(std::wstring_view Text) {
+        text = Text;
+        history.clear();
+        Restart();
+    }
+    void TextSearch::SetQuery(std::wstring_view Query, bool CaseSensitive) {
+        std::wstring_view previous = query;
+        bool sameMode = CaseSensitive == caseSensitive;
+
+        if (sameMode && !previous.empty() && Query.size() > previous.size() && Query.substr(0, previous.size()) == previous) {
+            // Typed more: only the old matches can still
+            // match, and their first characters are known
+            // to be good.
+            history.push_back({ previous.size(), scanPosition, matches });
+
+            size_t oldLength = previous.size();
+            query.assign(Query);
+            foldedQuery.resize(query.size());
+            std::transform(query.begin(), query.end(), foldedQuery.begin(), FoldCase);
+
+            size_t kept = 0;
+            for (size_t position : matches)
+                if (position + query.size() <= text.size() && Verify(position, oldLength)) matches[kept++] = position;
+            matches.resize(kept);
+            return;
+        }
+
+        if (sameMode && Query.size() < previous.size() && previous.substr(0, Query.size()) == Query) {
+            while (!history.empty() && history.back().queryLength > Query.size()) history.pop_back();
+            query.assign(Query);
+            foldedQuery.resize(query.size());
+            std::transform(query.begin(), query.end(), foldedQuery.begin(), FoldCase);
+            if (!history.empty() && history.back().queryLength == Query.size()) {
+                matches = std::move(history.back().matches);
+                scanPosition = history.back().scanPosition;
+                history.pop_back();
+            }
+            else Restart();
+            return;
+        }
+
+        history.clear();
+        caseSensitive = CaseSensitive;
+        query.assign(Query);
+        foldedQuery.resize(query.size());
+        std::transform(query.begin(), query.end(), foldedQuery.begin(), FoldCase);
+        Restart();
+    }
+    std::wstring_view TextSearch::Query() const {
+        return query;
+    }
+
+    bool TextSearch::Continue(size_t MaxChars) {
+        if (Complete()) return true;
+
+        size_t lastStart = text.size() - query.size() + 1;
+        size_t end = MaxChars < lastStart - scanPosition ? scanPosition + MaxChars : lastStart;
+        Scan(scanPosition, end);
+        scanPosition = end;
+        return Complete();
+    }
+    bool TextSearch::Complete() const {
+        return query.empty() || query.size() > text.size() || scanPosition >= text.size() - query.size() + 1;
+    }
+
+    const std::vector<size_t>& TextSearch::Matches() const {
+        return matches;
+    }
+    size_t TextSearch::MatchLength() const {
+        return query.size();
+    }
+
+    std::pair<size_t, size_t> TextSearch::MatchesInRange(size_t Begin, size_t End) const {
+        if (query.empty() || Begin >= End) return { 0, 0 };
+        size_t firstStart = Begin >= query.size() ? Begin - query.size() + 1 : 0;
+        size_t first = std::lower_bound(matches.begin(), matches.end(), firstStart) - matches.begin();
+        size_t second = std::lower_bound(matches.begin() + first, matches.end(), End) - matches.begin();
+        return { first, second };
+    }
+    void TextSearch::AppendHighlightSpans(size_t Begin, size_t End, uint32_t Forecolor, uint32_t Backcolor, uint32_t Flags, std::vector<TextSpan>& Spans) const {
+        std::pair<size_t, size_t> range = MatchesInRange(Begin, End);
+        size_t spanStart = 0;
+        size_t spanEnd = 0;
+        bool open = false;
+        for (size_t i = range.first; i < range.second; ++i) {
+            size_t start = std::max(matches[i], Begin) - Begin;
+            size_t end = std::min(matches[i] + query.size(), End) - Begin;
+            if (open && start <= spanEnd) {
+                spanEnd = std::max(spanEnd, end);
+                continue;
+            }
+            if (open) Spans.emplace_back((uint32_t)spanStart, (uint32_t)(spanEnd - spanStart), Forecolor, Backcolor, Flags);
+            spanStart = start;
+            spanEnd = end;
+            open = true;
+        }
+        if (open) Spans.emplace_back((uint32_t)spanStart, (uint32_t)(spanEnd - spanStart), Forecolor, Backcolor, Flags);
+    }
+}
@@ -0,0 +1,227 @@
+#include <brendantui/trace.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace btui {
+    namespace details {
+        std::atomic<bool> tracingEnabled(false);
+
+        // Buffers of live threads. When a thread exits,
+        // its spans are folded into retiredSpans, so they
+        // still get dumped, and its ring is kept for the
+        // next thread (up to a few) or freed. Trace memory
+        // then stays bounded however many threads come
+        // and go.
+
+        static constexpr size_t maxRetiredSpans = 65536;
+        static constexpr size_t maxFreeRings = 4;
+
+        struct RetiredThread {
+            uint32_t threadId;
+            std::string threadName;
+            size_t spanCount; //of its spans still in retiredSpans
+        };
+
+        static std::mutex registryMutex;
+        static std::vector<TraceBuffer*> registry;
+        static uint32_t nextThreadId = 1;
+        static std::deque<TraceSpan> retiredSpans;
+        static std::deque<RetiredThread> retiredThreads;
+        static std::vector<std::unique_ptr<TraceEvent[]>> freeRings;
+
+        static void WriteSpan(std::ostream& Stream, bool& First, const char* Name, uint32_t ThreadId, uint64_t StartNs, uint64_t DurationNs) {
+            char line[256];
+            std::snprintf(line, sizeof(line), "%s{\"name\":\"%s\",\"cat\":\"btui\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                First ? "\n" : ",\n", Name, ThreadId, StartNs / 1000.0, DurationNs / 1000.0);
+            Stream << line;
+            First = false;
+        }
+        static void WriteThreadName(std::ostream& Stream, bool& First, uint32_t ThreadId, const std::string& Name) {
+            if (Name.empty()) return;
+            Stream << (First ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ThreadId << ",\"args\":{\"name\":\"";
+            for (char c : Name)
+                if (c != '"' && c != '\\') Stream << c;
+            Stream << "\"}}";
+            First = false;
+        }
+
+        TraceBuffer::TraceBuffer(uint32_t ThreadId)
+            : events(0), head(0), clearedAt(0), threadId(ThreadId) { }
+        TraceBuffer::~TraceBuffer() {
+            delete[] events.load(std::memory_order_relaxed);
+        }
+
+        void TraceBuffer::Record(const char* Name, uint64_t StartNs, uint64_t EndNs) {
+            // The ring is allocated on the first span, so
+            // threads that only set a name cost nothing.
+
+            TraceEvent* ring = events.load(std::memory_order_relaxed);
+            if (!ring) {
+                // A reused ring may hold stale events, but
+                // only slots below head are ever read.
+                {
+                    std::lock_guard<std::mutex> lock(registryMutex);
+                    if (!freeRings.empty()) {
+                        ring = freeRings.back().release();
+                        freeRings.pop_back();
+                    }
+                }
+                if (!ring) ring = new TraceEvent[capacity]();
+                events.store(ring, std::memory_order_release);
+            }
+
+            uint64_t index = head.load(std::memory_order_relaxed);
+            TraceEvent& event = ring[index % capacity];
+            event.name.store(Name, std::memory_order_relaxed);
+            event.startNs.store(StartNs, std::memory_order_relaxed);
+            event.durationNs.store(EndNs - StartNs, std::memory_order_relaxed);
+            head.store(index + 1, std::memory_order_release);
+        }
+        void TraceBuffer::Clear() {
+            clearedAt.store(head.load(std::memory_order_acquire), std::memory_order_relaxed);
+        }
+        void TraceBuffer::WriteEvents(std::ostream& Stream, bool& First) const {
+            WriteThreadName(Stream, First, threadId, threadName);
+
+            uint64_t end = head.load(std::memory_order_acquire);
+            const TraceEvent* ring = events.load(std::memory_order_acquire);
+            if (!ring || !end) return;
+
+            // Skip a few of the oldest slots as well, since the
+            // writer may be overwriting them as we read.
+
+            uint64_t begin = clearedAt.load(std::memory_order_relaxed);
+            if (end - begin > capacity - 16) begin = end - (capacity - 16);
+
+            for (uint64_t i = begin; i < end; ++i) {
+                const TraceEvent& event = ring[i % capacity];
+                const char* name = event.name.load(std::memory_order_relaxed);
+                if (!name) continue;
+
+                WriteSpan(Stream, First, name, threadId,
+                    event.startNs.load(std::memory_order_relaxed),
+                    event.durationNs.load(std::memory_order_relaxed));
+            }
+        }
+        TraceEvent* TraceBuffer::TakeEvents(std::deque<TraceSpan>& Spans) {
+            TraceEvent* ring = events.exchange(0, std::memory_order_relaxed);
+            if (!ring) return 0;
+
+            // Only the owning thread writes, and it is the
+            // one calling, so the whole ring is stable.
+            uint64_t end = head.load(std::memory_order_relaxed);
+            uint64_t begin = clearedAt.load(std::memory_order_relaxed);
+            if (end - begin > capacity) begin = end - capacity;
+
+            for (uint64_t i = begin; i < end; ++i) {
+                const TraceEvent& event = ring[i % capacity];
+                const char* name = event.name.load(std::memory_order_relaxed);
+                if (!name) continue;
+                Spans.emplace_back(name, threadId, event.startNs.load(std::memory_order_relaxed), event.durationNs.load(std::memory_order_relaxed));
+            }
+            return ring;
+        }
+
+        // Registers the thread's buffer on first use and
+        // retires it when the thread exits.
+
+        struct ThreadTraceSlot {
+            TraceBuffer* buffer;
+            bool exited;
+
+            ThreadTraceSlot()
+                : buffer(0), exited(false) { }
+            ~ThreadTraceSlot() {
+                exited = true;
+                if (!buffer) return;
+
+                std::lock_guard<std::mutex> lock(registryMutex);
+                registry.erase(std::find(registry.begin(), registry.end(), buffer));
+
+                size_t before = retiredSpans.size();
+                TraceEvent* ring = buffer->TakeEvents(retiredSpans);
+                size_t added = retiredSpans.size() - before;
+                if (added) retiredThreads.push_back(RetiredThread{ buffer->threadId, std::move(buffer->threadName), added });
+
+                // Spans were appended a thread at a time,
+                // so the oldest ones belong to the front
+                // thread.
+                while (retiredSpans.size() > maxRetiredSpans) {
+                    retiredSpans.pop_front();
+                    if (!--retiredThreads.front().spanCount) retiredThreads.pop_front();
+                }
+
+                if (ring) {
+                    if (freeRings.size() < maxFreeRings) freeRings.emplace_back(ring);
+                    else delete[] ring;
+                }
+                delete buffer;
+                buffer = 0;
+            }
+
+            TraceBuffer* Get() {
+                if (!buffer && !exited) {
+                    std::lock_guard<std::mutex> lock(registryMutex);
+                    buffer = new TraceBuffer(nextThreadId++);
+                    registry.push_back(buffer);
+                }
+                return buffer;
+            }
+        };
+
+        static thread_local ThreadTraceSlot threadSlot;
+
+        void RecordTraceSpan(const char* Name, uint64_t StartNs, uint64_t EndNs) {
+            // Spans from thread_local destructors that run
+            // after the slot's are dropped.
+            if (TraceBuffer* buffer = threadSlot.Get()) buffer->Record(Name, StartNs, EndNs);
+        }
+    }
+
+    void SetTracingEnabled(bool Enabled) {
+        details::tracingEnabled.store(Enabled, std::memory_order_relaxed);
+    }
+    bool TracingEnabled() {
+        return details::tracingEnabled.load(std::memory_order_relaxed);
+    }
+
+    void SetTraceThreadName(std::string Name) {
+        details::TraceBuffer* buffer = details::threadSlot.Get();
+        if (!buffer) return;
+        std::lock_guard<std::mutex> lock(details::registryMutex);
+        buffer->threadName = std::move(Name);
+    }
+
+    void DumpTrace(std::ostream& Stream) {
+        std::lock_guard<std::mutex> lock(details::registryMutex);
+
+        bool first = true;
+        Stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        for (const details::RetiredThread& thread : details::retiredThreads)
+            details::WriteThreadName(Stream, first, thread.threadId, thread.threadName);
+        for (const details::TraceSpan& span : details::retiredSpans)
+            details::WriteSpan(Stream, first, span.name, span.threadId, span.startNs, span.durationNs);
+        for (const details::TraceBuffer* buffer : details::registry)
+            buffer->WriteEvents(Stream, first);
+        Stream << "\n]}\n";
+    }
+    bool DumpTrace(const std::filesystem::path& Path) {
+        std::ofstream file(Path, std::ios::out | std::ios::trunc);
+        if (!file) return false;
+
+        DumpTrace(file);
+        return (bool)file;
+    }
+    void ClearTrace() {
+        std::lock_guard<std::mutex> lock(details::registryMutex);
+        details::retiredSpans.clear();
+        details::retiredThreads.clear();
+        for (details::TraceBuffer* buffer : details::registry)
+            buffer->Clear();
+    }
+}
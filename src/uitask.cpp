@@ -0,0 +1,70 @@
+#include <brendantui/uitask.h>
+
+#include <new>
+
+namespace btui {
+    namespace details {
+        static constexpr size_t frameGranularity = 64;
+        static constexpr size_t frameClassCount = 64; //up to 4 KiB
+        static constexpr size_t maxFreeFrames = 32; //per size class
+
+        struct FreeFrame {
+            FreeFrame* next;
+        };
+
+        struct FrameFreeLists {
+            FreeFrame* heads[frameClassCount];
+            size_t counts[frameClassCount];
+
+            FrameFreeLists()
+                : heads(), counts() { }
+            ~FrameFreeLists() {
+                for (size_t i = 0; i < frameClassCount; ++i) {
+                    while (heads[i]) {
+                        FreeFrame* next = heads[i]->next;
+                        ::operator delete(heads[i]);
+                        heads[i] = next;
+                    }
+                }
+            }
+        };
+
+        static thread_local FrameFreeLists frameFreeLists;
+
+        static inline size_t FrameClass(size_t Size) {
+            return (Size + frameGranularity - 1) / frameGranularity - 1;
+        }
+
+        void* AllocateCoroutineFrame(size_t Size) {
+            size_t sizeClass = FrameClass(Size);
+            if (sizeClass >= frameClassCount) return ::operator new(Size);
+
+            FrameFreeLists& lists = frameFreeLists;
+            if (FreeFrame* frame = lists.heads[sizeClass]) {
+                lists.heads[sizeClass] = frame->next;
+                --lists.counts[sizeClass];
+                return frame;
+            }
+            return ::operator new((sizeClass + 1) * frameGranularity);
+        }
+        void FreeCoroutineFrame(void* Frame, size_t Size) {
+            size_t sizeClass = FrameClass(Size);
+            if (sizeClass >= frameClassCount) {
+                ::operator delete(Frame);
+                return;
+            }
+
+            // A frame freed on another thread than the one
+            // that made it simply joins this thread's list.
+            FrameFreeLists& lists = frameFreeLists;
+            if (lists.counts[sizeClass] >= maxFreeFrames) {
+                ::operator delete(Frame);
+                return;
+            }
+            FreeFrame* frame = static_cast<FreeFrame*>(Frame);
+            frame->next = lists.heads[sizeClass];
+            lists.heads[sizeClass] = frame;
+            ++lists.counts[sizeClass];
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#include <brendantui/utf8.h>
+
+#include <algorithm>
+#include <bit>
+
+#include <brendantui/simd.h>
+
+namespace btui {
+    namespace details {
+        // Length of the ASCII run at the start of
+        // [P, End), found a vector at a time.
+
+        static inline size_t AsciiRunLength(const uint8_t* P, const uint8_t* End) {
+            const uint8_t* start = P;
+#ifdef BTUI_SSE2
+            for (; End - P >= 16; P += 16) {
+                int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)P));
+                if (mask) return (P - start) + std::countr_zero((unsigned)mask);
+            }
+#endif
+            while (P < End && *P < 0x80) ++P;
+            return P - start;
+        }
+
+        static inline void WidenAscii(const uint8_t* In, wchar_t* Out, size_t Count) {
+            size_t i = 0;
+#ifdef BTUI_SSE2
+            __m128i zero = _mm_setzero_si128();
+            for (; i + 16 <= Count; i += 16) {
+                __m128i bytes = _mm_loadu_si128((const __m128i*)(In + i));
+                __m128i low = _mm_unpacklo_epi8(bytes, zero);
+                __m128i high = _mm_unpackhi_epi8(bytes, zero);
+                __m128i* out = (__m128i*)(Out + i);
+                if constexpr (sizeof(wchar_t) == 2) {
+                    _mm_storeu_si128(out, low);
+                    _mm_storeu_si128(out + 1, high);
+                }
+                else {
+                    _mm_storeu_si128(out, _mm_unpacklo_epi16(low, zero));
+                    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(low, zero));
+                    _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(high, zero));
+                    _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(high, zero));
+                }
+            }
+#endif
+            for (; i < Count; ++i) Out[i] = (wchar_t)In[i];
+        }
+
+        size_t DecodeUtf8(const uint8_t*& P, const uint8_t* End, wchar_t* Out, size_t OutCapacity) {
+            size_t written = 0;
+            while (P < End && written < OutCapacity) {
+                if (*P < 0x80) {
+                    size_t run = std::min(AsciiRunLength(P, End), OutCapacity - written);
+                    WidenAscii(P, Out + written, run);
+                    P += run;
+                    written += run;
+                }
+                else Out[written++] = DecodeUtf8Char(P, End);
+            }
+            return written;
+        }
+
+        static uint32_t DrawUtf8Line(BufferGrid Buffer, PointU32 Point, const uint8_t* P, const uint8_t* End, uint32_t Backcolor, uint32_t Forecolor, uint32_t MaxColumns) {
+            if (Point.x >= Buffer.width || Point.y >= Buffer.height) return 0;
+            uint32_t columns = std::min(MaxColumns, Buffer.width - Point.x);
+
+            BufferGridCell* cells = Buffer.buffer + (size_t)Point.y * Buffer.width + Point.x;
+            uint32_t written = 0;
+            while (P < End && written < columns) {
+                if (*P < 0x80) {
+                    size_t run = std::min(AsciiRunLength(P, End), (size_t)(columns - written));
+                    for (size_t i = 0; i < run; ++i) {
+                        uint8_t c = P[i];
+                        cells[written++] = BufferGridCell(c < 0x20 || c == 0x7F ? L' ' : (wchar_t)c, Forecolor, Backcolor);
+                    }
+                    P += run;
+                }
+                else {
+                    wchar_t c = DecodeUtf8Char(P, End);
+                    cells[written++] = BufferGridCell(c >= 0x80 && c < 0xA0 ? L' ' : c, Forecolor, Backcolor);
+                }
+            }
+            return written;
+        }
+    }
+
+    size_t DecodeUtf8(std::string_view Text, wchar_t* Out, size_t OutCapacity) {
+        const uint8_t* p = (const uint8_t*)Text.data();
+        return details::DecodeUtf8(p, p + Text.size(), Out, OutCapacity);
+    }
+    size_t DecodeUtf8(std::u8string_view Text, wchar_t* Out, size_t OutCapacity) {
+        const uint8_t* p = (const uint8_t*)Text.data();
+        return details::DecodeUtf8(p, p + Text.size(), Out, OutCapacity);
+    }
+
+    void AppendUtf8(std::wstring& Out, std::string_view Text) {
+        // A character takes at least one byte, so the
+        // byte count bounds the decoded length.
+        size_t offset = Out.size();
+        Out.resize(offset + Text.size());
+        Out.resize(offset + DecodeUtf8(Text, Out.data() + offset, Text.size()));
+    }
+    void AppendUtf8(std::wstring& Out, std::u8string_view Text) {
+        AppendUtf8(Out, std::string_view((const char*)Text.data(), Text.size()));
+    }
+
+    uint32_t DrawUtf8Line(BufferGrid Buffer, PointU32 Point, std::string_view Text, uint32_t Backcolor, uint32_t Forecolor, uint32_t MaxColumns) {
+        const uint8_t* p = (const uint8_t*)Text.data();
+        return details::DrawUtf8Line(Buffer, Point, p, p + Text.size(), Backcolor, Forecolor, MaxColumns);
+    }
+    uint32_t DrawUtf8Line(BufferGrid Buffer, PointU32 Point, std::u8string_view Text, uint32_t Backcolor, uint32_t Forecolor, uint32_t MaxColumns) {
+        const uint8_t* p = (const uint8_t*)Text.data();
+        return details::DrawUtf8Line(Buffer, Point, p, p + Text.size(), Backcolor, Forecolor, MaxColumns);
+    }
+}
@@ -0,0 +1,518 @@
+#include <brendantui/widgets.h>
+
+#include <algorithm>
+
+namespace btui {
+    static inline SizeU32 ClampSize(SizeU32 Size, SizeU32 Max) {
+        return SizeU32(std::min(Size.width, Max.width), std::min(Size.height, Max.height));
+    }
+
+    static inline RectU32 ClampRect(RectU32 Rect, SizeU32 BufferSize) {
+        return RectU32::Intersection(Rect, RectU32(PointU32(0, 0), BufferSize));
+    }
+
+    Widget::Widget()
+        : parent(0), tree(0), lastAvailable(), desiredSize(), bounds(), measureValid(false), arrangeValid(false), paintDirty(true), childPaintDirty(false), flexGrow(0) { }
+
+    void Widget::AttachToTree(WidgetTree* Tree) {
+        if (tree && tree != Tree) tree->Forget(this);
+        tree = Tree;
+        ForEachChild([Tree](Widget* Child) {
+            Child->AttachToTree(Tree);
+        });
+    }
+
+    void Widget::InvalidateMeasure() {
+        arrangeValid = false;
+        InvalidatePaint();
+
+        if (!measureValid) return;
+        measureValid = false;
+
+        if (tree) tree->Enqueue(this);
+    }
+    void Widget::InvalidatePaint() {
+        paintDirty = true;
+        for (Widget* p = parent; p && !p->childPaintDirty; p = p->parent)
+            p->childPaintDirty = true;
+    }
+
+    SizeU32 Widget::Measure(SizeU32 Available) {
+        if (measureValid && Available == lastAvailable) return desiredSize;
+
+        lastAvailable = Available;
+        desiredSize = ClampSize(MeasureOverride(Available), Available);
+        measureValid = true;
+
+        return desiredSize;
+    }
+    void Widget::Arrange(RectU32 Bounds) {
+        if (arrangeValid && Bounds == bounds) return;
+
+        bool moved = Bounds != bounds;
+        bounds = Bounds;
+        arrangeValid = true;
+
+        ArrangeOverride(Bounds);
+
+        // A widget that moved leaves stale cells behind,
+        // so its parent repaints; one that was only
+        // re-arranged in place repaints nothing extra.
+
+        if (moved) {
+            InvalidatePaint();
+            if (parent) parent->InvalidatePaint();
+        }
+    }
+    void Widget::Paint(BufferGrid Buffer, bool Force) {
+        if (Force || paintDirty) {
+            PaintOverride(Buffer);
+            PaintChildren(Buffer, true);
+        }
+        else if (childPaintDirty)
+            PaintChildren(Buffer, false);
+
+        paintDirty = false;
+        childPaintDirty = false;
+    }
+
+    Widget* Widget::Parent() const {
+        return parent;
+    }
+    WidgetTree* Widget::Tree() const {
+        return tree;
+    }
+    SizeU32 Widget::DesiredSize() const {
+        return desiredSize;
+    }
+    RectU32 Widget::Bounds() const {
+        return bounds;
+    }
+    bool Widget::NeedsPaint() const {
+        return paintDirty || childPaintDirty;
+    }
+
+    uint32_t Widget::GetFlexGrow() const {
+        return flexGrow;
+    }
+    void Widget::SetFlexGrow(uint32_t FlexGrow) {
+        if (flexGrow == FlexGrow) return;
+        flexGrow = FlexGrow;
+        if (parent) {
+            parent->arrangeValid = false;
+            parent->InvalidateMeasure();
+        }
+    }
+
+    PanelWidget::PanelWidget()
+        : backgroundFill(BufferGridCell()) { }
+
+    void PanelWidget::PaintOverride(BufferGrid Buffer) {
+        if (!backgroundFill.index()) return;
+
+        DrawCanvasInFrame(Buffer, ClampRect(Bounds(), Buffer.size), BufferGrid(), AlignStart, AlignStart, backgroundFill);
+    }
+    void PanelWidget::PaintChildren(BufferGrid Buffer, bool Force) {
+        for (auto& child : children)
+            if (Force || child->NeedsPaint())
+                child->Paint(Buffer, Force);
+    }
+    void PanelWidget::ForEachChild(const std::function<void(Widget*)>& Func) {
+        for (auto& child : children)
+            Func(child.get());
+    }
+
+    Widget* PanelWidget::AddChild(std::unique_ptr<Widget> Child) {
+        Widget* child = Child.get();
+        child->parent = this;
+        child->AttachToTree(Tree());
+        children.push_back(std::move(Child));
+        OnChildAdded(children.size() - 1);
+
+        InvalidateMeasure();
+
+        return child;
+    }
+    std::unique_ptr<Widget> PanelWidget::RemoveChild(Widget* Child) {
+        auto it = std::find_if(children.begin(), children.end(), [Child](const std::unique_ptr<Widget>& Entry) {
+            return Entry.get() == Child;
+        });
+        if (it == children.end()) return nullptr;
+
+        size_t index = it - children.begin();
+        std::unique_ptr<Widget> child = std::move(*it);
+        children.erase(it);
+        OnChildRemoved(index);
+
+        child->AttachToTree(0);
+        child->parent = 0;
+
+        InvalidateMeasure();
+
+        return child;
+    }
+    size_t PanelWidget::ChildCount() const {
+        return children.size();
+    }
+    Widget* PanelWidget::GetChild(size_t Index) const {
+        return Index < children.size() ? children[Index].get() : 0;
+    }
+
+    const backgroundFill_t& PanelWidget::GetBackgroundFill() const {
+        return backgroundFill;
+    }
+    void PanelWidget::SetBackgroundFill(backgroundFill_t BackgroundFill) {
+        backgroundFill = BackgroundFill;
+        InvalidatePaint();
+    }
+
+    FlexPanel::FlexPanel(FlexDirection Direction, uint32_t Gap)
+        : direction(Direction), gap(Gap) { }
+
+    SizeU32 FlexPanel::MeasureOverride(SizeU32 Available) {
+        // Every child is measured against the full
+        // available size, so one child changing size
+        // never invalidates the cached sizes of its
+        // siblings.
+
+        bool isRow = direction == FlexDirectionRow;
+        uint32_t main = 0;
+        uint32_t cross = 0;
+        for (size_t i = 0; i < children.size(); ++i) {
+            SizeU32 childSize = children[i]->Measure(Available);
+            if (i) main += gap;
+            main += isRow ? childSize.width : childSize.height;
+            cross = std::max(cross, isRow ? childSize.height : childSize.width);
+        }
+
+        return isRow ? SizeU32(main, cross) : SizeU32(cross, main);
+    }
+    void FlexPanel::ArrangeOverride(RectU32 Bounds) {
+        bool isRow = direction == FlexDirectionRow;
+        uint32_t mainStart = isRow ? Bounds.x : Bounds.y;
+        uint32_t mainLength = isRow ? Bounds.width : Bounds.height;
+        uint32_t mainEnd = mainStart + mainLength;
+
+        uint32_t used = 0;
+        uint32_t totalGrow = 0;
+        for (size_t i = 0; i < children.size(); ++i) {
+            SizeU32 childSize = children[i]->DesiredSize();
+            if (i) used += gap;
+            used += isRow ? childSize.width : childSize.height;
+            totalGrow += children[i]->GetFlexGrow();
+        }
+        uint32_t leftover = mainLength > used ? mainLength - used : 0;
+        uint32_t leftoverRem = totalGrow ? leftover % totalGrow : 0;
+
+        uint32_t pos = mainStart;
+        for (size_t i = 0; i < children.size(); ++i) {
+            Widget* child = children[i].get();
+            if (i) pos = std::min(pos + gap, mainEnd);
+
+            SizeU32 childSize = child->DesiredSize();
+            uint32_t length = isRow ? childSize.width : childSize.height;
+            if (uint32_t grow = child->GetFlexGrow()) {
+                length += (uint32_t)((uint64_t)leftover * grow / totalGrow);
+                uint32_t extra = std::min(leftoverRem, grow);
+                length += extra;
+                leftoverRem -= extra;
+            }
+            length = std::min(length, mainEnd - pos);
+
+            child->Arrange(isRow ? RectU32(pos, Bounds.y, length, Bounds.height) : RectU32(Bounds.x, pos, Bounds.width, length));
+            pos += length;
+        }
+    }
+
+    FlexDirection FlexPanel::GetDirection() const {
+        return direction;
+    }
+    void FlexPanel::SetDirection(FlexDirection Direction) {
+        if (direction == Direction) return;
+        direction = Direction;
+        InvalidateMeasure();
+    }
+    uint32_t FlexPanel::GetGap() const {
+        return gap;
+    }
+    void FlexPanel::SetGap(uint32_t Gap) {
+        if (gap == Gap) return;
+        gap = Gap;
+        InvalidateMeasure();
+    }
+
+    GridPanel::GridPanel(std::vector<GridTrack> Columns, std::vector<GridTrack> Rows, uint32_t Gap)
+        : columns(std::move(Columns)), rows(std::move(Rows)), gap(Gap) { }
+
+    static void ResolveGridAxis(const std::vector<GridTrack>& Tracks, std::vector<uint32_t>& Sizes, uint32_t Available, uint32_t Gap, bool DistributeLeftover) {
+        uint32_t used = Tracks.empty() ? 0 : Gap * (uint32_t)(Tracks.size() - 1);
+        uint32_t totalGrow = 0;
+        for (size_t i = 0; i < Tracks.size(); ++i) {
+            if (Tracks[i].size) Sizes[i] = Tracks[i].size;
+            used += Sizes[i];
+            totalGrow += Tracks[i].grow;
+        }
+        if (!DistributeLeftover || !totalGrow || used >= Available) return;
+
+        uint32_t leftover = Available - used;
+        uint32_t leftoverRem = leftover % totalGrow;
+        for (size_t i = 0; i < Tracks.size(); ++i) {
+            if (!Tracks[i].grow) continue;
+            Sizes[i] += (uint32_t)((uint64_t)leftover * Tracks[i].grow / totalGrow);
+            uint32_t extra = std::min(leftoverRem, Tracks[i].grow);
+            Sizes[i] += extra;
+            leftoverRem -= extra;
+        }
+    }
+
+    void GridPanel::ResolveAutoTracks() {
+        columnSizes.assign(columns.size(), 0);
+        rowSizes.assign(rows.size(), 0);
+
+        for (size_t i = 0; i < children.size(); ++i) {
+            const GridPlacement& placement = placements[i];
+            SizeU32 childSize = children[i]->DesiredSize();
+            if (placement.columnSpan == 1 && placement.column < columns.size() && !columns[placement.column].size && !columns[placement.column].grow)
+                columnSizes[placement.column] = std::max(columnSizes[placement.column], childSize.width);
+            if (placement.rowSpan == 1 && placement.row < rows.size() && !rows[placement.row].size && !rows[placement.row].grow)
+                rowSizes[placement.row] = std::max(rowSizes[placement.row], childSize.height);
+        }
+    }
+    SizeU32 GridPanel::MeasureOverride(SizeU32 Available) {
+        for (auto& child : children)
+            child->Measure(Available);
+
+        ResolveAutoTracks();
+        ResolveGridAxis(columns, columnSizes, Available.width, gap, false);
+        ResolveGridAxis(rows, rowSizes, Available.height, gap, false);
+
+        SizeU32 size;
+        for (uint32_t columnSize : columnSizes) size.width += columnSize;
+        for (uint32_t rowSize : rowSizes) size.height += rowSize;
+        if (!columnSizes.empty()) size.width += gap * (uint32_t)(columnSizes.size() - 1);
+        if (!rowSizes.empty()) size.height += gap * (uint32_t)(rowSizes.size() - 1);
+        return size;
+    }
+    void GridPanel::ArrangeOverride(RectU32 Bounds) {
+        ResolveAutoTracks();
+        ResolveGridAxis(columns, columnSizes, Bounds.width, gap, true);
+        ResolveGridAxis(rows, rowSizes, Bounds.height, gap, true);
+
+        auto spanRange = [this](const std::vector<uint32_t>& Sizes, uint32_t Start, uint32_t Span, uint32_t Origin, uint32_t Limit, uint32_t& OutStart, uint32_t& OutLength) {
+            uint32_t pos = Origin;
+            for (uint32_t i = 0; i < Start && i < Sizes.size(); ++i)
+                pos += Sizes[i] + gap;
+            uint32_t length = 0;
+            for (uint32_t i = Start; i < Start + Span && i < Sizes.size(); ++i)
+                length += (i > Start ? gap : 0) + Sizes[i];
+            OutStart = std::min(pos, Limit);
+            OutLength = std::min(length, Limit - OutStart);
+        };
+
+        for (size_t i = 0; i < children.size(); ++i) {
+            const GridPlacement& placement = placements[i];
+            RectU32 rect;
+            spanRange(columnSizes, placement.column, placement.columnSpan, Bounds.x, Bounds.x + Bounds.width, rect.x, rect.width);
+            spanRange(rowSizes, placement.row, placement.rowSpan, Bounds.y, Bounds.y + Bounds.height, rect.y, rect.height);
+            children[i]->Arrange(rect);
+        }
+    }
+    void GridPanel::OnChildAdded(size_t Index) {
+        uint32_t columnCount = columns.empty() ? 1 : (uint32_t)columns.size();
+        placements.insert(placements.begin() + Index, GridPlacement((uint32_t)Index % columnCount, (uint32_t)Index / columnCount));
+    }
+    void GridPanel::OnChildRemoved(size_t Index) {
+        placements.erase(placements.begin() + Index);
+    }
+
+    void GridPanel::SetColumns(std::vector<GridTrack> Columns) {
+        columns = std::move(Columns);
+        InvalidateMeasure();
+    }
+    void GridPanel::SetRows(std::vector<GridTrack> Rows) {
+        rows = std::move(Rows);
+        InvalidateMeasure();
+    }
+    GridPlacement GridPanel::GetPlacement(Widget* Child) const {
+        for (size_t i = 0; i < children.size(); ++i)
+            if (children[i].get() == Child) return placements[i];
+        return GridPlacement();
+    }
+    void GridPanel::SetPlacement(Widget* Child, GridPlacement Placement) {
+        for (size_t i = 0; i < children.size(); ++i) {
+            if (children[i].get() != Child) continue;
+            placements[i] = Placement;
+            InvalidateMeasure();
+            return;
+        }
+    }
+
+    Label::Label(std::wstring Text, uint32_t Forecolor, uint32_t Backcolor)
+        : text(std::move(Text)), forecolor(Forecolor), backcolor(Backcolor), horizontalAlign(AlignStart), verticalAlign(AlignStart), wrapStyle(WrapStyleNoWrap) { }
+
+    SizeU32 Label::MeasureOverride(SizeU32 Available) {
+        return MeasureTextInFrame(text, Available.width, wrapStyle);
+    }
+    void Label::PaintOverride(BufferGrid Buffer) {
+        RectU32 rect = ClampRect(Bounds(), Buffer.size);
+        if (!rect.width || !rect.height) return;
+
+        DrawTextInFrame(Buffer, rect, text, backcolor, forecolor, horizontalAlign, verticalAlign, wrapStyle, BufferGridCell(L' ', forecolor, backcolor));
+    }
+
+    const std::wstring& Label::GetText() const {
+        return text;
+    }
+    void Label::SetText(std::wstring Text) {
+        if (text == Text) return;
+        text = std::move(Text);
+        InvalidateMeasure();
+    }
+    void Label::SetColors(uint32_t Forecolor, uint32_t Backcolor) {
+        forecolor = Forecolor;
+        backcolor = Backcolor;
+        InvalidatePaint();
+    }
+    void Label::SetAlign(Align HorizontalAlign, Align VerticalAlign) {
+        horizontalAlign = HorizontalAlign;
+        verticalAlign = VerticalAlign;
+        InvalidatePaint();
+    }
+    void Label::SetWrapStyle(WrapStyle Style) {
+        if (wrapStyle == Style) return;
+        wrapStyle = Style;
+        InvalidateMeasure();
+    }
+
+    Table::Table(std::vector<uint32_t> ColumnWidths, std::vector<uint32_t> RowHeights, uint32_t BorderForecolor, uint32_t BorderBackcolor)
+        : borderForecolor(BorderForecolor), borderBackcolor(BorderBackcolor), backgroundFill(BufferGridCell()) {
+        SetTracks(std::move(ColumnWidths), std::move(RowHeights));
+    }
+
+    SizeU32 Table::MeasureOverride(SizeU32 Available) {
+        SizeU32 size((uint32_t)columnWidths.size() + 1, (uint32_t)rowHeights.size() + 1);
+        for (uint32_t width : columnWidths) size.width += width;
+        for (uint32_t height : rowHeights) size.height += height;
+        return size;
+    }
+    void Table::PaintOverride(BufferGrid Buffer) {
+        RectU32 rect = ClampRect(Bounds(), Buffer.size);
+        if (!rect.width || !rect.height) return;
+
+        DrawTableInFrame(Buffer, rect, (uint32_t)columnWidths.size(), (uint32_t)rowHeights.size(), columnWidths.data(), rowHeights.data(), horizontalBorders.get(), verticalBorders.get(), borderBackcolor, borderForecolor, backgroundFill);
+    }
+
+    void Table::SetTracks(std::vector<uint32_t> ColumnWidths, std::vector<uint32_t> RowHeights) {
+        columnWidths = std::move(ColumnWidths);
+        rowHeights = std::move(RowHeights);
+
+        size_t horizontalCount = (rowHeights.size() + 1) * columnWidths.size();
+        size_t verticalCount = rowHeights.size() * (columnWidths.size() + 1);
+        horizontalBorders = std::make_unique<bool[]>(horizontalCount);
+        verticalBorders = std::make_unique<bool[]>(verticalCount);
+        std::fill_n(horizontalBorders.get(), horizontalCount, true);
+        std::fill_n(verticalBorders.get(), verticalCount, true);
+
+        InvalidateMeasure();
+    }
+    void Table::SetBorders(const bool* HorizontalBorders, const bool* VerticalBorders) {
+        std::copy_n(HorizontalBorders, (rowHeights.size() + 1) * columnWidths.size(), horizontalBorders.get());
+        std::copy_n(VerticalBorders, rowHeights.size() * (columnWidths.size() + 1), verticalBorders.get());
+        InvalidatePaint();
+    }
+    void Table::SetColors(uint32_t BorderForecolor, uint32_t BorderBackcolor) {
+        borderForecolor = BorderForecolor;
+        borderBackcolor = BorderBackcolor;
+        InvalidatePaint();
+    }
+    void Table::SetBackgroundFill(backgroundFill_t BackgroundFill) {
+        backgroundFill = BackgroundFill;
+        InvalidatePaint();
+    }
+
+    RectU32 Table::CellRect(uint32_t Column, uint32_t Row) const {
+        if (Column >= columnWidths.size() || Row >= rowHeights.size()) return RectU32();
+
+        RectU32 bounds = Bounds();
+        RectU32 rect(bounds.x + 1 + Column, bounds.y + 1 + Row, columnWidths[Column], rowHeights[Row]);
+        for (uint32_t i = 0; i < Column; ++i) rect.x += columnWidths[i];
+        for (uint32_t i = 0; i < Row; ++i) rect.y += rowHeights[i];
+        return RectU32::Intersection(rect, bounds);
+    }
+
+    WidgetTree::WidgetTree()
+        : lastSize(), fullRepaint(true) { }
+    WidgetTree::~WidgetTree() {
+        if (root) root->AttachToTree(0);
+    }
+
+    void WidgetTree::Enqueue(Widget* Target) {
+        layoutQueue.push_back(Target);
+    }
+    void WidgetTree::Forget(Widget* Target) {
+        layoutQueue.erase(std::remove(layoutQueue.begin(), layoutQueue.end(), Target), layoutQueue.end());
+    }
+    void WidgetTree::Relayout(Widget* Target) {
+        if (Target->measureValid) return;
+
+        // Re-measure against the same constraint and walk
+        // up only while the measured size keeps changing;
+        // the first ancestor whose size holds still is the
+        // root of the subtree that needs arranging.
+
+        Widget* current = Target;
+        while (true) {
+            SizeU32 oldSize = current->desiredSize;
+            current->measureValid = false;
+            current->Measure(current->lastAvailable);
+            current->arrangeValid = false;
+
+            if (current->desiredSize == oldSize || !current->parent) break;
+            current = current->parent;
+        }
+
+        current->Arrange(current->bounds);
+    }
+
+    Widget* WidgetTree::SetRoot(std::unique_ptr<Widget> Root) {
+        if (root) root->AttachToTree(0);
+        root = std::move(Root);
+        layoutQueue.clear();
+        fullRepaint = true;
+        if (!root) return 0;
+
+        root->parent = 0;
+        root->AttachToTree(this);
+        root->measureValid = false;
+        root->arrangeValid = false;
+        return root.get();
+    }
+    Widget* WidgetTree::Root() const {
+        return root.get();
+    }
+
+    bool WidgetTree::NeedsPaint() const {
+        return fullRepaint || !layoutQueue.empty() || (root && root->NeedsPaint());
+    }
+    void WidgetTree::InvalidateAll() {
+        fullRepaint = true;
+    }
+    void WidgetTree::Paint(BufferGrid Buffer) {
+        if (!root) return;
+
+        for (size_t i = 0; i < layoutQueue.size(); ++i)
+            Relayout(layoutQueue[i]);
+        layoutQueue.clear();
+
+        if (fullRepaint || Buffer.size != lastSize) {
+            lastSize = Buffer.size;
+            fullRepaint = false;
+
+            root->Measure(Buffer.size);
+            root->Arrange(RectU32(PointU32(0, 0), Buffer.size));
+            root->Paint(Buffer, true);
+        }
+        else
+            root->Paint(Buffer, false);
+    }
+}
@@ -1,4 +1,12 @@
 #include <brendantui/windowbase.h>
+#include <brendantui/drawing.h>
+#include <brendantui/framerecording.h>
+#include <brendantui/framesnapshot.h>
+#include <brendantui/gridbuffer.h>
+#include <brendantui/trace.h>
+#include <brendantui/workerpool.h>
+
+#include <algorithm>
 
 #include <combaseapi.h>
 #include <shellapi.h>
@@ -36,66 +44,221 @@ inline COLORREF ConvertToColorref(uint32_t Color) {
 }
 
 namespace btui {
-    void WindowBase::UpdateFunction(bool* Initialized) {
+    static thread_local EventLoop* currentLoop = 0;
+
+    namespace details {
+        // Copies the current frame into a new snapshot and
+        // counts the cells that differ from the previous
+        // one in the same pass.
+        static uint64_t CopyChangedCells(const BufferGridCell* Current, const BufferGridCell* Previous, BufferGridCell* Snapshot, size_t Count) {
+            uint64_t changed = 0;
+            for (size_t i = 0; i < Count; ++i) {
+                const BufferGridCell& cur = Current[i];
+                const BufferGridCell& prev = Previous[i];
+                if (cur.character != prev.character || cur.forecolor != prev.forecolor || cur.backcolor != prev.backcolor) ++changed;
+                Snapshot[i] = cur;
+            }
+            return changed;
+        }
+
+        // The window's back buffer, kept between paints,
+        // together with the cells it currently shows, so
+        // a paint only has to draw the cells that changed.
+
+        struct RasterTarget {
+            HDC dc;
+            HBITMAP bitmap;
+            HBITMAP oldBitmap;
+            HFONT oldFont; //the font itself belongs to the EventLoop
+            int pixelWidth;
+            int pixelHeight;
+            uint32_t background;
+            GridBuffer cells;
+            bool valid; //false until the bitmap matches cells
+
+            RasterTarget()
+                : dc(0), bitmap(0), oldBitmap(0), oldFont(0), pixelWidth(0), pixelHeight(0), background(0), cells(), valid(false) { }
+            ~RasterTarget() {
+                Release();
+            }
+
+            void Release() {
+                if (dc) {
+                    SelectObject(dc, oldFont);
+                    SelectObject(dc, oldBitmap);
+                    DeleteDC(dc);
+                }
+                if (bitmap) DeleteObject(bitmap);
+                dc = 0;
+                bitmap = 0;
+                pixelWidth = 0;
+                pixelHeight = 0;
+                cells.Release();
+                valid = false;
+            }
+
+            void Prepare(HDC WindowDC, int PixelWidth, int PixelHeight, SizeU32 CellSize, uint32_t Background, HFONT Font) {
+                if (!dc || pixelWidth != PixelWidth || pixelHeight != PixelHeight) {
+                    Release();
+                    dc = CreateCompatibleDC(WindowDC);
+                    bitmap = CreateCompatibleBitmap(WindowDC, PixelWidth, PixelHeight);
+                    oldBitmap = (HBITMAP)SelectObject(dc, bitmap);
+                    oldFont = (HFONT)SelectObject(dc, Font);
+
+                    pixelWidth = PixelWidth;
+                    pixelHeight = PixelHeight;
+                }
+                if (background != Background) valid = false;
+
+                if (!valid) {
+                    RECT rect = { 0, 0, PixelWidth, PixelHeight };
+                    HBRUSH brush = CreateSolidBrush(ConvertToColorref(Background));
+                    ::FillRect(dc, &rect, brush);
+                    DeleteObject(brush);
+                    background = Background;
+                    cells.Resize(CellSize, false);
+                }
+            }
+
+            // Moves the pixels and the remembered cells
+            // alike; what the scroll exposes keeps its old
+            // pixels and cells, so the two stay in step.
+
+            void Scroll(const ScrollOp& Op) {
+                if (!valid) return;
+                RectU32 rect = RectU32::Intersection(Op.rect, RectU32(PointU32(0, 0), cells.Size()));
+                if (!rect.width || !rect.height) return;
+
+                ScrollRegion(cells.Grid(), rect, Op.dx, Op.dy);
+                RECT pixels = {
+                    (int)(rect.x * charWidth),
+                    (int)(rect.y * charHeight),
+                    (int)((rect.x + rect.width) * charWidth),
+                    (int)((rect.y + rect.height) * charHeight)
+                };
+                ScrollDC(dc, Op.dx * (int)charWidth, Op.dy * (int)charHeight, &pixels, &pixels, NULL, NULL);
+            }
+
+            // Draws every cell of Frame that the bitmap
+            // doesn't already show and returns how many
+            // that was.
+
+            uint64_t Draw(const BufferGridCell* Frame) {
+                SizeU32 size = cells.Size();
+                BufferGridCell* shown = cells.Data();
+                uint64_t drawn = 0;
+                for (uint32_t y = 0; y < size.height; ++y) {
+                    for (uint32_t x = 0; x < size.width; ++x) {
+                        size_t i = (size_t)y * size.width + x;
+                        const BufferGridCell& cell = Frame[i];
+                        if (valid && cell.character == shown[i].character && cell.forecolor == shown[i].forecolor && cell.backcolor == shown[i].backcolor) continue;
+
+                        SetTextColor(dc, ConvertToColorref(cell.forecolor));
+                        SetBkColor(dc, ConvertToColorref(cell.backcolor));
+
+                        wchar_t charBuffer[2] = { cell.character, L'\0' };
+                        TextOutW(dc, x * charWidth, y * charHeight, charBuffer, 1);
+                        shown[i] = cell;
+                        ++drawn;
+                    }
+                }
+                valid = true;
+                return drawn;
+            }
+        };
+    }
+
+    EventLoop::EventLoop(HINSTANCE HInstance)
+        : hInstance(HInstance), font(0), wakeEvent(0), isRunning(true), readyHead(0), readyTail(0), timers(0), newTimers(0) {
+        // Window classes and GDI objects belong to the
+        // process, not a thread, so these are set up here
+        // and shared by every window on the loop.
+        className = GenerateGuidStr();
+
         WNDCLASSEXW wc = {};
+        wc.cbSize = sizeof(wc);
         wc.hInstance = hInstance;
         wc.lpszClassName = className.c_str();
         wc.lpfnWndProc = WindowProcStaticPlaceholder;
 
         RegisterClassExW(&wc);
 
-        hwnd = CreateWindowExW(
-            0,                   // Optional window styles
-            className.c_str(),   // Window class
-            L"",                 // Window title
-            WS_OVERLAPPEDWINDOW, // Window style
-            CW_USEDEFAULT,       // Window initial X
-            CW_USEDEFAULT,       // Window initial Y
-            CW_USEDEFAULT,       // Window initial width
-            CW_USEDEFAULT,       // Window initial height
-            nullptr,             // Parent window
-            nullptr,             // Menu
-            hInstance,           // Instance handle
-            nullptr              // Additional application data
+        // Monospaced font for rendering
+        font = CreateFontW(
+            charHeight,              // Character height
+            charWidth,               // Character width
+            0,                       // Escapement
+            0,                       // Orientation
+            FW_NORMAL,               // Weight (normal)
+            FALSE,                   // Italic
+            FALSE,                   // Underline
+            FALSE,                   // Strikeout
+            ANSI_CHARSET,            // Character set
+            OUT_DEFAULT_PRECIS,      // Output precision
+            CLIP_DEFAULT_PRECIS,     // Clipping precision
+            DEFAULT_QUALITY,         // Output quality
+            FIXED_PITCH | FF_MODERN, // Pitch and family (monospaced)
+            L"Consolas"              // Font name
         );
 
-        SetWindowLongPtr(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
-        SetWindowLongPtr(hwnd, GWLP_WNDPROC, reinterpret_cast<LONG_PTR>(WindowProcStatic));
+        // Auto-reset; set whenever a task is queued.
+        wakeEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
 
-        *Initialized = true;
+        thread = std::thread(&EventLoop::ThreadFunction, this);
+    }
+    EventLoop::~EventLoop() {
+        Stop();
+        if (thread.joinable()) thread.join();
+
+        UnregisterClassW(className.c_str(), hInstance);
+        if (font) DeleteObject(font);
+        if (wakeEvent) CloseHandle(wakeEvent);
+    }
+
+    void EventLoop::ThreadFunction() {
+#ifdef BTUI_ENABLE_TRACING
+        SetTraceThreadName("btui event loop");
+#endif
+        currentLoop = this;
 
         MSG msg;
         while (isRunning.load()) {
-            while (PeekMessageW(&msg, hwnd, 0, 0, PM_REMOVE)) {
+            while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE)) {
+                BTUI_TRACE_SCOPE("DispatchMessage");
                 TranslateMessage(&msg);
-                DispatchMessage(&msg);
+                DispatchMessageW(&msg);
             }
 
             ProcessTasks();
-
-            std::this_thread::yield();
+            TakeNewTimers();
+            FireTimers();
+            ResumeReady();
+            CloseStoppedWindows();
+
+            // Sleep until a message arrives, a task or a
+            // coroutine is queued or the next timer is
+            // due. Anything queued since ProcessTasks() or
+            // ResumeReady() left the event set, so nothing
+            // is missed.
+            if (isRunning.load())
+                MsgWaitForMultipleObjects(1, &wakeEvent, FALSE, TimerTimeout(), QS_ALLINPUT);
         }
 
-        CancelTasks();
-
-        {
-            std::lock_guard<std::mutex> lock(mtx);
-
-            if (hwnd) DestroyWindow(hwnd);
-
-            UnregisterClassW(className.c_str(), hInstance);
-
-            hwnd = 0;
-
-            delete[] lastBuffer;
-            lastBuffer = 0;
+        while (!windows.empty()) {
+            WindowBase* window = windows.back();
+            window->isRunning.store(false);
+            window->Teardown();
         }
 
-        DisposedInfo info;
+        // Every suspended coroutine gets to run to its
+        // end; awaiting anything now returns at once.
+        CancelTimers();
+        while (ResumeReady());
 
-        OnDisposed(info);
+        CancelTasks();
     }
-    void WindowBase::ProcessTasks() {
+    void EventLoop::ProcessTasks() {
+        BTUI_TRACE_SCOPE("ProcessTasks");
         std::unique_lock<std::mutex> lock(mtx);
         while (!taskQueue.empty()) {
             auto task = std::move(taskQueue.front());
@@ -105,7 +268,7 @@ namespace btui {
             lock.lock();
         }
     }
-    void WindowBase::CancelTasks() {
+    void EventLoop::CancelTasks() {
         std::lock_guard<std::mutex> lock(mtx);
         while (!taskQueue.empty()) {
             auto task = std::move(taskQueue.front());
@@ -114,27 +277,340 @@ namespace btui {
         }
         taskQueue = std::queue<details::QueuedTask>();
     }
-    bool WindowBase::InvokeOnWindowThread(std::function<void()> Func) {
-        if (std::this_thread::get_id() == updateThread.get_id()) {
+    void EventLoop::CloseStoppedWindows() {
+        // Closing a window removes it from the list.
+        for (size_t i = windows.size(); i-- > 0;) {
+            if (i < windows.size() && !windows[i]->isRunning.load())
+                windows[i]->Teardown();
+        }
+    }
+
+    void EventLoop::PushReady(details::LoopWaiter* Waiter) {
+        Waiter->next = 0;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (readyTail) readyTail->next = Waiter;
+            else readyHead = Waiter;
+            readyTail = Waiter;
+        }
+        Wake();
+    }
+    bool EventLoop::Schedule(details::LoopWaiter* Waiter) {
+        Waiter->next = 0;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (!isRunning) return false;
+
+            if (readyTail) readyTail->next = Waiter;
+            else readyHead = Waiter;
+            readyTail = Waiter;
+        }
+        Wake();
+        return true;
+    }
+    bool EventLoop::ResumeReady() {
+        BTUI_TRACE_SCOPE("ResumeCoroutines");
+
+        // Takes the whole list; whatever the resumed
+        // coroutines queue waits for the next round.
+        details::LoopWaiter* waiter;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            waiter = readyHead;
+            readyHead = 0;
+            readyTail = 0;
+        }
+        if (!waiter) return false;
+
+        while (waiter) {
+            // Resuming may free the frame holding waiter.
+            details::LoopWaiter* next = waiter->next;
+            waiter->handle.resume();
+            waiter = next;
+        }
+        return true;
+    }
+    void EventLoop::AddTimer(DelayAwaiter* Timer) {
+        DelayAwaiter* previous = 0;
+        DelayAwaiter* current = timers;
+        while (current && current->deadline <= Timer->deadline) {
+            previous = current;
+            current = static_cast<DelayAwaiter*>(current->next);
+        }
+        Timer->next = current;
+        if (previous) previous->next = Timer;
+        else timers = Timer;
+    }
+    bool EventLoop::ScheduleTimer(DelayAwaiter* Timer) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (!isRunning) return false;
+
+            Timer->next = newTimers;
+            newTimers = Timer;
+        }
+        Wake();
+        return true;
+    }
+    void EventLoop::TakeNewTimers() {
+        DelayAwaiter* timer;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            timer = newTimers;
+            newTimers = 0;
+        }
+        while (timer) {
+            DelayAwaiter* next = static_cast<DelayAwaiter*>(timer->next);
+            AddTimer(timer);
+            timer = next;
+        }
+    }
+    void EventLoop::FireTimers() {
+        uint64_t now = details::NowNs();
+        while (timers && timers->deadline <= now) {
+            DelayAwaiter* timer = timers;
+            timers = static_cast<DelayAwaiter*>(timer->next);
+            PushReady(timer);
+        }
+    }
+    void EventLoop::CancelTimers() {
+        // isRunning is already false, so nothing can be
+        // added to newTimers after this.
+        TakeNewTimers();
+        while (timers) {
+            DelayAwaiter* timer = timers;
+            timers = static_cast<DelayAwaiter*>(timer->next);
+            timer->cancelled = true;
+            PushReady(timer);
+        }
+    }
+    uint32_t EventLoop::TimerTimeout() const {
+        if (!timers) return INFINITE;
+        uint64_t now = details::NowNs();
+        if (timers->deadline <= now) return 0;
+        uint64_t ms = (timers->deadline - now + 999999) / 1000000;
+        return ms < INFINITE ? (uint32_t)ms : INFINITE - 1;
+    }
+
+    void EventLoop::Stop() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            isRunning.store(false);
+        }
+        Wake();
+        if (!IsLoopThread() && thread.joinable()) thread.join();
+    }
+    void EventLoop::Wake() {
+        SetEvent(wakeEvent);
+    }
+    bool EventLoop::Running() const {
+        return isRunning.load();
+    }
+    bool EventLoop::IsLoopThread() const {
+        return std::this_thread::get_id() == thread.get_id();
+    }
+
+    bool EventLoop::Invoke(std::function<void()> Func) {
+        if (IsLoopThread()) {
             Func();
             return true;
         }
-        else {
-            int statusCode = 0;
 
-            details::QueuedTask task(std::move(Func), &statusCode);
+        std::atomic<int> statusCode = 0;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
 
-            {
-                std::lock_guard<std::mutex> lock(mtx);
+            if (!isRunning) return false;
 
-                if (!isRunning) return false;
+            taskQueue.emplace(std::move(Func), &statusCode);
+        }
+        Wake();
 
-                taskQueue.push(std::move(task));
-            }
+        int status;
+        while (!(status = statusCode.load())) statusCode.wait(0);
+        return status == 1;
+    }
 
-            while (!statusCode) std::this_thread::yield();
+    LoopThreadAwaiter EventLoop::OnLoopThread() {
+        return LoopThreadAwaiter(*this);
+    }
+    DelayAwaiter EventLoop::Delay(uint32_t Milliseconds) {
+        return DelayAwaiter(*this, Milliseconds);
+    }
+    EventLoop* EventLoop::Current() {
+        return currentLoop;
+    }
 
-            return statusCode == 1;
+    LoopThreadAwaiter::LoopThreadAwaiter(EventLoop& Loop)
+        : loop(&Loop) { }
+    bool LoopThreadAwaiter::await_ready() {
+        return loop->IsLoopThread();
+    }
+    bool LoopThreadAwaiter::await_suspend(std::coroutine_handle<> Handle) {
+        handle = Handle;
+        if (loop->Schedule(this)) return true;
+        cancelled = true;
+        return false;
+    }
+    bool LoopThreadAwaiter::await_resume() {
+        return !cancelled;
+    }
+
+    DelayAwaiter::DelayAwaiter(EventLoop& Loop, uint32_t Milliseconds)
+        : loop(&Loop), deadline(details::NowNs() + (uint64_t)Milliseconds * 1000000) { }
+    bool DelayAwaiter::await_ready() {
+        if (!loop->Running()) {
+            cancelled = true;
+            return true;
+        }
+        return false;
+    }
+    bool DelayAwaiter::await_suspend(std::coroutine_handle<> Handle) {
+        handle = Handle;
+        if (loop->IsLoopThread()) {
+            loop->AddTimer(this);
+            return true;
+        }
+        if (loop->ScheduleTimer(this)) return true;
+        cancelled = true;
+        return false;
+    }
+    bool DelayAwaiter::await_resume() {
+        return !cancelled;
+    }
+
+    void WindowBase::Create() {
+        hwnd = CreateWindowExW(
+            0,                         // Optional window styles
+            loop->className.c_str(),   // Window class
+            L"",                       // Window title
+            WS_OVERLAPPEDWINDOW,       // Window style
+            CW_USEDEFAULT,             // Window initial X
+            CW_USEDEFAULT,             // Window initial Y
+            CW_USEDEFAULT,             // Window initial width
+            CW_USEDEFAULT,             // Window initial height
+            nullptr,                   // Parent window
+            nullptr,                   // Menu
+            loop->hInstance,           // Instance handle
+            nullptr                    // Additional application data
+        );
+
+        SetWindowLongPtr(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+        SetWindowLongPtr(hwnd, GWLP_WNDPROC, reinterpret_cast<LONG_PTR>(WindowProcStatic));
+
+        loop->windows.push_back(this);
+    }
+    void WindowBase::Teardown() {
+        std::vector<WindowBase*>& windows = loop->windows;
+        auto it = std::find(windows.begin(), windows.end(), this);
+        if (it == windows.end()) return;
+        windows.erase(it);
+
+        recorder.reset();
+
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+
+            if (hwnd) DestroyWindow(hwnd);
+
+            hwnd = 0;
+
+            lastBuffer->Release();
+        }
+        raster->Release();
+        latestFrame.store(nullptr, std::memory_order_release);
+
+        DisposedInfo info;
+
+        RaiseEvent(EventTypeDisposed, &WindowBase::OnDisposed, info);
+        ReleaseFrameWaiters(0);
+    }
+    template <typename _T>
+    void WindowBase::RaiseEvent(EventType Type, void (WindowBase::* Handler)(const _T&), const _T& Info) {
+        // A switch to inline may land between the two
+        // checks; then the handler runs inline after all.
+        bool posted = eventQueue->Queued() && PostEvent(Type, [this, Handler, Info]() {
+            (this->*Handler)(Info);
+        });
+        if (!posted) {
+            counters.CountEvent(Type);
+
+            BTUI_TRACE_SCOPE(EventTypeName(Type));
+            (this->*Handler)(Info);
+        }
+
+        if (eventWaiters || bufferEvents) DeliverEvent(WindowEvent(Type, Info));
+    }
+    bool WindowBase::PostEvent(EventType Type, std::function<void()> Handler) {
+        uint64_t queuedAt = details::NowNs();
+        counters.EventQueued(eventBacklogThreshold);
+        std::function<void()> task = [this, Type, Handler = std::move(Handler), queuedAt]() {
+            uint64_t startedAt = details::NowNs();
+            counters.EventDequeued();
+            counters.eventWaitTime.Record(startedAt - queuedAt, startedAt);
+
+            BTUI_TRACE_SCOPE(EventTypeName(Type));
+            Handler();
+        };
+        if (!eventQueue->Post(task)) {
+            counters.EventDequeued();
+            return false;
+        }
+
+        counters.CountEvent(Type);
+        return true;
+    }
+    void WindowBase::DeliverEvent(WindowEvent Event) {
+        if (!eventWaiters) {
+            if (pendingEvents.size() >= maxPendingEvents) pendingEvents.pop_front();
+            pendingEvents.push_back(std::move(Event));
+            return;
+        }
+
+        details::LoopWaiter* waiter = eventWaiters;
+        eventWaiters = 0;
+        while (waiter) {
+            details::LoopWaiter* next = waiter->next;
+            static_cast<EventAwaiter*>(waiter)->event = Event;
+            loop->PushReady(waiter);
+            waiter = next;
+        }
+    }
+    void WindowBase::ReleaseFrameWaiters(uint64_t Sequence) {
+        details::LoopWaiter* waiter = frameWaiters;
+        frameWaiters = 0;
+        while (waiter) {
+            details::LoopWaiter* next = waiter->next;
+            static_cast<FrameAwaiter*>(waiter)->sequence = Sequence;
+            loop->PushReady(waiter);
+            waiter = next;
+        }
+    }
+    bool WindowBase::InvokeOnWindowThread(std::function<void()> Func) {
+        if (loop->IsLoopThread()) {
+            if (!hwnd) return false;
+            Func();
+            return true;
+        }
+        else {
+            if (!isRunning) return false;
+
+            // hwnd is only read on the loop's thread; it is
+            // zero once the window has been torn down.
+            bool ran = false;
+            uint64_t queuedAt = details::NowNs();
+            counters.TaskQueued();
+            bool invoked = loop->Invoke([this, &Func, &ran]() {
+                if (!hwnd) return;
+                Func();
+                ran = true;
+            });
+            counters.TaskDequeued();
+
+            uint64_t finishedAt = details::NowNs();
+            counters.taskWaitTime.Record(finishedAt - queuedAt, finishedAt);
+
+            return invoked && ran;
         }
     }
 
@@ -215,7 +691,7 @@ namespace btui {
             info.ctrlPressed = GetKeyState(VK_CONTROL) & 0x8000;
             info.altPressed = GetKeyState(VK_MENU) & 0x8000;
 
-            OnKeyPress(info);
+            RaiseEvent(EventTypeKeyPress, &WindowBase::OnKeyPress, info);
             return 0;
         }
         case WM_LBUTTONDOWN:
@@ -231,7 +707,7 @@ namespace btui {
             info.leftButton = (Msg == WM_LBUTTONDOWN);
             info.rightButton = (Msg == WM_RBUTTONDOWN);
 
-            OnMouseDown(info);
+            RaiseEvent(EventTypeMouseDown, &WindowBase::OnMouseDown, info);
             return 0;
         }
         case WM_LBUTTONUP:
@@ -247,7 +723,7 @@ namespace btui {
             info.leftButton = (Msg == WM_LBUTTONUP);
             info.rightButton = (Msg == WM_RBUTTONUP);
 
-            OnMouseUp(info);
+            RaiseEvent(EventTypeMouseUp, &WindowBase::OnMouseUp, info);
             return 0;
         }
         case WM_MOUSEMOVE: {
@@ -264,7 +740,7 @@ namespace btui {
 
                     MouseExitInfo info;
 
-                    OnMouseExit(info);
+                    RaiseEvent(EventTypeMouseExit, &WindowBase::OnMouseExit, info);
                 }
 
                 return 0;
@@ -281,7 +757,7 @@ namespace btui {
 
                     MouseExitInfo info;
 
-                    OnMouseExit(info);
+                    RaiseEvent(EventTypeMouseExit, &WindowBase::OnMouseExit, info);
                 }
 
                 return 0;
@@ -292,7 +768,7 @@ namespace btui {
                 info.x = charX;
                 info.y = charY;
 
-                OnMouseMove(info);
+                RaiseEvent(EventTypeMouseMove, &WindowBase::OnMouseMove, info);
             }
             else {
                 mouseContained = true;
@@ -301,7 +777,7 @@ namespace btui {
                 info.x = charX;
                 info.y = charY;
 
-                OnMouseEnter(info);
+                RaiseEvent(EventTypeMouseEnter, &WindowBase::OnMouseEnter, info);
             }
 
             TRACKMOUSEEVENT tme;
@@ -319,7 +795,7 @@ namespace btui {
 
                 MouseExitInfo info;
 
-                OnMouseExit(info);
+                RaiseEvent(EventTypeMouseExit, &WindowBase::OnMouseExit, info);
             }
 
             return 0;
@@ -329,7 +805,7 @@ namespace btui {
             info.newWidth = LOWORD(LParam) / charWidth;
             info.newHeight = HIWORD(LParam) / charHeight;
 
-            OnResize(info);
+            RaiseEvent(EventTypeResize, &WindowBase::OnResize, info);
 
             Invalidate();
 
@@ -342,7 +818,7 @@ namespace btui {
                 WindowStateChangeInfo info;
                 info.newWindowState = newState;
 
-                OnWindowStateChange(info);
+                RaiseEvent(EventTypeWindowStateChange, &WindowBase::OnWindowStateChange, info);
             }
 
             return 0;
@@ -365,7 +841,7 @@ namespace btui {
             dropInfo.mouseX = pt.x / charWidth;
             dropInfo.mouseY = pt.y / charHeight;
 
-            OnFileDrop(dropInfo);
+            RaiseEvent(EventTypeFileDrop, &WindowBase::OnFileDrop, dropInfo);
             DragFinish(hDrop);
             return 0;
         }
@@ -376,7 +852,7 @@ namespace btui {
             info.newWidth = (rect.right - rect.left) / charWidth;
             info.newHeight = (rect.bottom - rect.top) / charHeight;
 
-            OnResizeComplete(info);
+            RaiseEvent(EventTypeResizeComplete, &WindowBase::OnResizeComplete, info);
 
             return 0;
         }
@@ -384,7 +860,25 @@ namespace btui {
             CloseRequestInfo info;
             info.canCancel = true;
 
-            if (OnCloseRequest(info)) {
+            // The window thread can't wait for the answer,
+            // so the handler closes the window itself.
+            if (eventWaiters || bufferEvents) DeliverEvent(WindowEvent(EventTypeCloseRequest, info));
+
+            bool posted = eventQueue->Queued() && PostEvent(EventTypeCloseRequest, [this, info]() {
+                if (OnCloseRequest(info)) {
+                    isRunning.store(false);
+                    loop->Wake();
+                }
+            });
+            if (posted) return 0;
+
+            counters.CountEvent(EventTypeCloseRequest);
+            bool close;
+            {
+                BTUI_TRACE_SCOPE(EventTypeName(EventTypeCloseRequest));
+                close = OnCloseRequest(info);
+            }
+            if (close) {
                 isRunning.store(false);
             }
             return 0;
@@ -393,101 +887,112 @@ namespace btui {
             MouseScrollInfo info;
             info.scrollAmount = GET_WHEEL_DELTA_WPARAM(WParam) / WHEEL_DELTA;
 
-            OnMouseScroll(info);
+            RaiseEvent(EventTypeMouseScroll, &WindowBase::OnMouseScroll, info);
             return 0;
         }
         case WM_CHAR: {
             TextInputInfo info;
             info.inputText = std::wstring(1, static_cast<wchar_t>(WParam));
 
-            OnTextInput(info);
+            RaiseEvent(EventTypeTextInput, &WindowBase::OnTextInput, info);
             return 0;
         }
         case WM_SETFOCUS: {
             FocusGainedInfo info;
 
-            OnFocusGained(info);
+            RaiseEvent(EventTypeFocusGained, &WindowBase::OnFocusGained, info);
             return 0;
         }
         case WM_KILLFOCUS: {
             FocusLostInfo info;
 
-            OnFocusLost(info);
+            RaiseEvent(EventTypeFocusLost, &WindowBase::OnFocusLost, info);
             return 0;
         }
         case WM_DESTROY:
             isRunning.store(false);
             return 0;
         case WM_PAINT: {
+            BTUI_TRACE_SCOPE("Paint");
+            uint64_t paintStart = details::NowNs();
+
             PAINTSTRUCT ps;
             HDC hdc = BeginPaint(Hwnd, &ps);
 
             // Get the dimensions of the client area
             RECT clientRect;
             GetClientRect(Hwnd, &clientRect);
-
-            // Create a memory device context
-            HDC memDC = CreateCompatibleDC(hdc);
-            HBITMAP memBitmap = CreateCompatibleBitmap(hdc, clientRect.right - clientRect.left, clientRect.bottom - clientRect.top);
-            HBITMAP oldBitmap = (HBITMAP)SelectObject(memDC, memBitmap);
-
-            // Fill the background in the memory DC
-            FillRect(memDC, &clientRect, CreateSolidBrush(ConvertToColorref(backColor)));
+            int clientWidth = clientRect.right - clientRect.left;
+            int clientHeight = clientRect.bottom - clientRect.top;
 
             // Calculate buffer size (in characters)
-            uint32_t width = (clientRect.right - clientRect.left) / charWidth;
-            uint32_t height = (clientRect.bottom - clientRect.top) / charHeight;
+            uint32_t width = clientWidth / charWidth;
+            uint32_t height = clientHeight / charHeight;
 
             // Ensure buffer size matches the screen area and is initialized
             mtx.lock();
-            if ((!lastBuffer) || lastBufferSize.width != width || lastBufferSize.height != height) {
-                delete[] lastBuffer;
-                lastBufferSize = { width, height };
-                lastBuffer = new BufferGridCell[width * height];
+            // Keeps whatever was painted in the overlap, so
+            // PaintBuffer may repaint only what changed.
+            if (lastBuffer->Size() != SizeU32(width, height)) {
+                if (lastBuffer->Resize(SizeU32(width, height)))
+                    counters.bufferReallocations.fetch_add(1, std::memory_order_relaxed);
             }
-            PaintBuffer(BufferGrid(width, height, lastBuffer));
+            pendingScrolls.clear();
+            uint64_t paintBufferStart = details::NowNs();
+            {
+                BTUI_TRACE_SCOPE("PaintBuffer");
+                PaintBuffer(lastBuffer->Grid());
+            }
+            uint64_t paintBufferEnd = details::NowNs();
+            counters.paintBufferTime.Record(paintBufferEnd - paintBufferStart, paintBufferEnd);
+            uint32_t background = backColor;
             mtx.unlock();
 
-            // Monospaced font for rendering
-            HFONT hFont = CreateFontW(
-                charHeight,              // Character height
-                charWidth,               // Character width
-                0,                       // Escapement
-                0,                       // Orientation
-                FW_NORMAL,               // Weight (normal)
-                FALSE,                   // Italic
-                FALSE,                   // Underline
-                FALSE,                   // Strikeout
-                ANSI_CHARSET,            // Character set
-                OUT_DEFAULT_PRECIS,      // Output precision
-                CLIP_DEFAULT_PRECIS,     // Clipping precision
-                DEFAULT_QUALITY,         // Output quality
-                FIXED_PITCH | FF_MODERN, // Pitch and family (monospaced)
-                L"Consolas"              // Font name
-            );
-            SelectObject(memDC, hFont);
-
-            // Draw each character in the buffer grid to the memory DC
-            for (uint32_t y = 0; y < height; ++y) {
-                for (uint32_t x = 0; x < width; ++x) {
-                    const BufferGridCell& cell = lastBuffer[y * width + x];
-                    SetTextColor(memDC, ConvertToColorref(cell.forecolor));
-                    SetBkColor(memDC, ConvertToColorref(cell.backcolor));
-
-                    wchar_t charBuffer[2] = { cell.character, L'\0' };
-                    TextOutW(memDC, x * charWidth, y * charHeight, charBuffer, 1);
-                }
+            // Only the window thread writes lastBuffer and
+            // publishes frames, so the copy can run outside
+            // the lock.
+            std::shared_ptr<const FrameSnapshot> previous = latestFrame.load(std::memory_order_relaxed);
+            std::shared_ptr<FrameSnapshot> snapshot = snapshotPool->Acquire(SizeU32(width, height), ++frameSequence, paintBufferEnd);
+            size_t cellCount = (size_t)width * height;
+            uint64_t changedCells;
+            if (!previous || previous->Size() != snapshot->Size()) {
+                if (cellCount) memcpy(snapshot->Cells(), lastBuffer->Data(), sizeof(BufferGridCell) * cellCount);
+                changedCells = cellCount;
+            }
+            else
+                changedCells = details::CopyChangedCells(lastBuffer->Data(), previous->Cells(), snapshot->Cells(), cellCount);
+            previous.reset();
+
+            if (recorder) {
+                BTUI_TRACE_SCOPE("Record");
+                recorder->AddFrame(snapshot->Grid());
+            }
+
+            // Scroll the back buffer as reported, then draw
+            // the cells it still gets wrong.
+            uint64_t rasterizeStart = details::NowNs();
+            {
+                BTUI_TRACE_SCOPE("Rasterize");
+                raster->Prepare(hdc, clientWidth, clientHeight, SizeU32(width, height), background, loop->font);
+                for (const details::ScrollOp& op : pendingScrolls) raster->Scroll(op);
+                raster->Draw(snapshot->Cells());
             }
+            uint64_t rasterizeEnd = details::NowNs();
+            counters.rasterizeTime.Record(rasterizeEnd - rasterizeStart, rasterizeEnd);
 
-            // BitBlt the memory DC to the window's DC
-            BitBlt(hdc, 0, 0, clientRect.right - clientRect.left, clientRect.bottom - clientRect.top, memDC, 0, 0, SRCCOPY);
+            // BitBlt the back buffer to the window's DC
+            {
+                BTUI_TRACE_SCOPE("Present");
+                BitBlt(hdc, 0, 0, clientWidth, clientHeight, raster->dc, 0, 0, SRCCOPY);
+            }
+            latestFrame.store(std::move(snapshot), std::memory_order_release);
 
-            // Cleanup
-            SelectObject(memDC, oldBitmap);
-            DeleteObject(memBitmap);
-            DeleteDC(memDC);
-            DeleteObject(hFont);
             EndPaint(Hwnd, &ps);
+
+            uint64_t paintEnd = details::NowNs();
+            counters.paintTime.Record(paintEnd - paintStart, paintEnd);
+            counters.PaintFinished(changedCells);
+            ReleaseFrameWaiters(frameSequence);
             return 0;
         }
         }
@@ -495,21 +1000,29 @@ namespace btui {
     }
 
     WindowBase::WindowBase(HINSTANCE HInstance)
-        : hInstance(HInstance), isRunning(true), lastBuffer(0), lastBufferSize(0, 0), lastWindowState(WindowStateHidden), mouseContained(false), backColor(0xFF000000), cursorType(CursorTypeArrow), isJoined(false) {
+        : WindowBase(*new EventLoop(HInstance), true) { }
+    WindowBase::WindowBase(EventLoop& Loop)
+        : WindowBase(Loop, false) { }
+    WindowBase::WindowBase(EventLoop& Loop, bool OwnsLoop)
+        : hwnd(0), loop(&Loop), ownedLoop(OwnsLoop ? &Loop : 0), isRunning(true), lastBuffer(std::make_unique<GridBuffer>()), lastWindowState(WindowStateHidden), mouseContained(false), backColor(0xFF000000), cursorType(CursorTypeArrow), isJoined(false), snapshotPool(std::make_unique<details::FrameSnapshotPool>()), frameSequence(0), raster(std::make_unique<details::RasterTarget>()), eventQueue(std::make_unique<SwitchableQueue>()), eventBacklogThreshold(64), eventWaiters(0), frameWaiters(0), pendingEvents(), bufferEvents(false) {
 
-        className = GenerateGuidStr();
-
-        bool initialized = false;
-        updateThread = std::thread(&WindowBase::UpdateFunction, this, &initialized);
-        while (!initialized) std::this_thread::yield();
+        if (!loop->Invoke([this]() { Create(); }))
+            isRunning.store(false);
     }
     WindowBase::~WindowBase() { Dispose(); }
 
     void WindowBase::Dispose() {
         isRunning.store(false);
         if (!isJoined.exchange(true)) {
-            if (updateThread.joinable())
-                updateThread.join();
+            // If the loop has already stopped, it tore the
+            // window down on its way out.
+            loop->Invoke([this]() { Teardown(); });
+            if (ownedLoop) ownedLoop->Stop();
+
+            // Nothing posts events now the window is gone;
+            // let the handlers still queued (at least
+            // OnDisposed) finish.
+            eventQueue->Drain();
         }
     }
     bool WindowBase::Running() const {
@@ -533,25 +1046,31 @@ namespace btui {
         }
         else return SizeU32(0, 0);
     }
+    void WindowBase::ReportScroll(RectU32 Rect, int32_t Dx, int32_t Dy) {
+        pendingScrolls.emplace_back(Rect, Dx, Dy);
+    }
+    std::shared_ptr<const FrameSnapshot> WindowBase::LatestFrame() const {
+        return latestFrame.load(std::memory_order_acquire);
+    }
     BufferGrid WindowBase::CopyBufferOut() {
-        std::lock_guard<std::mutex> lock(mtx);
+        std::shared_ptr<const FrameSnapshot> frame = LatestFrame();
 
-        if (!lastBuffer) return BufferGrid(0, 0, 0);
+        if (!frame) return BufferGrid(0, 0, 0);
 
-        SizeU32 bufSize = lastBufferSize;
+        SizeU32 bufSize = frame->Size();
         BufferGridCell* outBuffer = new BufferGridCell[bufSize.width * bufSize.height];
-        memcpy(outBuffer, lastBuffer, sizeof(BufferGridCell) * bufSize.width * bufSize.height);
+        memcpy(outBuffer, frame->Cells(), sizeof(BufferGridCell) * bufSize.width * bufSize.height);
 
         return BufferGrid(bufSize, outBuffer);
     }
     bool WindowBase::CopyBufferOut(SizeU32 BufferSize, BufferGridCell* Buffer) {
-        std::lock_guard<std::mutex> lock(mtx);
+        std::shared_ptr<const FrameSnapshot> frame = LatestFrame();
 
-        if (!lastBuffer) return false;
+        if (!frame) return false;
 
-        if (lastBufferSize != BufferSize) return false;
+        if (frame->Size() != BufferSize) return false;
 
-        memcpy(Buffer, lastBuffer, sizeof(BufferGridCell) * BufferSize.width * BufferSize.height);
+        memcpy(Buffer, frame->Cells(), sizeof(BufferGridCell) * BufferSize.width * BufferSize.height);
 
         return true;
     }
@@ -559,6 +1078,119 @@ namespace btui {
         return CopyBufferOut(Buffer.size, Buffer.buffer);
     }
 
+    WindowStats WindowBase::GetStats() const {
+        return counters.Snapshot();
+    }
+    void WindowBase::ResetStats() {
+        counters.Reset();
+    }
+
+    EventAwaiter WindowBase::NextEvent() {
+        return EventAwaiter(*this);
+    }
+    FrameAwaiter WindowBase::NextFrame() {
+        return FrameAwaiter(*this);
+    }
+    LoopThreadAwaiter WindowBase::OnWindowThread() {
+        return loop->OnLoopThread();
+    }
+    DelayAwaiter WindowBase::Delay(uint32_t Milliseconds) {
+        return loop->Delay(Milliseconds);
+    }
+
+    EventAwaiter::EventAwaiter(WindowBase& Window)
+        : window(&Window), event() { }
+    bool EventAwaiter::await_ready() {
+        if (!window->loop->IsLoopThread()) return false;
+
+        window->bufferEvents = true;
+        if (!window->pendingEvents.empty()) {
+            event = std::move(window->pendingEvents.front());
+            window->pendingEvents.pop_front();
+            return true;
+        }
+        return !window->hwnd;
+    }
+    bool EventAwaiter::await_suspend(std::coroutine_handle<> Handle) {
+        handle = Handle;
+
+        // Once registered, the coroutine may be resumed
+        // before this returns; only locals are touched
+        // after that.
+        bool waiting = false;
+        window->InvokeOnWindowThread([this, &waiting]() {
+            WindowBase* w = window;
+            w->bufferEvents = true;
+            if (!w->pendingEvents.empty()) {
+                event = std::move(w->pendingEvents.front());
+                w->pendingEvents.pop_front();
+                return;
+            }
+            next = w->eventWaiters;
+            w->eventWaiters = this;
+            waiting = true;
+        });
+        return waiting;
+    }
+    WindowEvent EventAwaiter::await_resume() {
+        return std::move(event);
+    }
+
+    FrameAwaiter::FrameAwaiter(WindowBase& Window)
+        : window(&Window), sequence(0) { }
+    bool FrameAwaiter::await_ready() {
+        return window->loop->IsLoopThread() && !window->hwnd;
+    }
+    bool FrameAwaiter::await_suspend(std::coroutine_handle<> Handle) {
+        handle = Handle;
+
+        bool waiting = false;
+        window->InvokeOnWindowThread([this, &waiting]() {
+            WindowBase* w = window;
+            next = w->frameWaiters;
+            w->frameWaiters = this;
+            waiting = true;
+            ::InvalidateRect(w->hwnd, NULL, FALSE);
+        });
+        return waiting;
+    }
+    uint64_t FrameAwaiter::await_resume() {
+        return sequence;
+    }
+
+    void WindowBase::UseEventWorkers(WorkerPool* Pool, uint32_t BacklogThreshold) {
+        InvokeOnWindowThread([this, BacklogThreshold]() {
+            eventBacklogThreshold = BacklogThreshold;
+        });
+
+        // Waits here, not on the window thread, which
+        // keeps posting while the old queue empties.
+        eventQueue->SwitchTo(Pool);
+    }
+
+    bool WindowBase::StartRecording(const std::filesystem::path& Path) {
+        bool opened = false;
+        bool success = InvokeOnWindowThread([this, &Path, &opened]() {
+            recorder = std::make_unique<FrameRecorder>();
+            opened = recorder->Open(Path);
+            if (!opened) recorder.reset();
+            ::InvalidateRect(hwnd, NULL, FALSE);
+        });
+        return success && opened;
+    }
+    void WindowBase::StopRecording() {
+        InvokeOnWindowThread([this]() {
+            recorder.reset();
+        });
+    }
+    bool WindowBase::IsRecording() {
+        bool recording = false;
+        InvokeOnWindowThread([this, &recording]() {
+            recording = (bool)recorder;
+        });
+        return recording;
+    }
+
     void WindowBase::Invalidate() {
         InvokeOnWindowThread([this]() {
             ::InvalidateRect(hwnd, NULL, FALSE);
@@ -0,0 +1,179 @@
+#include <brendantui/workerpool.h>
+
+#include <algorithm>
+
+namespace btui {
+    SerialQueue::SerialQueue(WorkerPool& Pool)
+        : pool(&Pool), scheduled(false) { }
+    SerialQueue::~SerialQueue() {
+        Drain();
+    }
+
+    void SerialQueue::Post(std::function<void()> Task) {
+        bool schedule;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            tasks.push_back(std::move(Task));
+            schedule = !scheduled;
+            scheduled = true;
+        }
+        if (schedule) pool->Schedule(this);
+    }
+
+    void SerialQueue::RunBatch() {
+        std::unique_lock<std::mutex> lock(mtx);
+        runner = std::this_thread::get_id();
+        for (uint32_t i = 0; i < batchSize && !tasks.empty(); ++i) {
+            std::function<void()> task = std::move(tasks.front());
+            tasks.pop_front();
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+        runner = std::thread::id();
+
+        // Still scheduled, so nobody else reschedules
+        // it in the meantime.
+        if (!tasks.empty()) {
+            lock.unlock();
+            pool->Schedule(this);
+            return;
+        }
+        scheduled = false;
+        idle.notify_all();
+    }
+
+    void SerialQueue::Drain() {
+        std::unique_lock<std::mutex> lock(mtx);
+        if (runner == std::this_thread::get_id()) return;
+        idle.wait(lock, [this]() { return !scheduled; });
+    }
+    size_t SerialQueue::Size() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return tasks.size();
+    }
+    bool SerialQueue::Idle() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return !scheduled;
+    }
+
+    SwitchableQueue::SwitchableQueue()
+        : queue(), next(), retired(), retiring(), held(), fencePending(false), queued(false) { }
+
+    void SwitchableQueue::RunFence() {
+        // Runs on the old queue after everything posted to
+        // it; what was held back meanwhile goes first on
+        // the new one. The old queue is still running this,
+        // so SwitchTo() gets rid of it.
+        std::lock_guard<std::mutex> lock(mtx);
+        for (std::function<void()>& task : held) next->Post(std::move(task));
+        held.clear();
+        retired = std::move(queue);
+        queue = std::move(next);
+        fencePending = false;
+        fenced.notify_all();
+    }
+
+    bool SwitchableQueue::Queued() const {
+        return queued.load(std::memory_order_relaxed);
+    }
+    bool SwitchableQueue::Post(std::function<void()>& Task) {
+        std::shared_ptr<SerialQueue> draining;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (fencePending) {
+                held.push_back(std::move(Task));
+                return true;
+            }
+            if (queue) {
+                queue->Post(std::move(Task));
+                return true;
+            }
+            draining = retiring;
+        }
+        if (draining) draining->Drain();
+        return false;
+    }
+
+    void SwitchableQueue::SwitchTo(WorkerPool* Pool) {
+        std::lock_guard<std::mutex> switchLock(switchMtx);
+        std::unique_ptr<SerialQueue> fresh = Pool ? std::make_unique<SerialQueue>(*Pool) : nullptr;
+
+        std::unique_lock<std::mutex> lock(mtx);
+        if (!queue) {
+            queue = std::move(fresh);
+            queued.store((bool)queue, std::memory_order_relaxed);
+            return;
+        }
+
+        if (!fresh) {
+            // Post() already runs tasks inline, once the
+            // old queue is empty; nothing enters it now.
+            std::shared_ptr<SerialQueue> old = std::move(queue);
+            retiring = old;
+            lock.unlock();
+            old->Drain();
+            lock.lock();
+            retiring.reset();
+            queued.store(false, std::memory_order_relaxed);
+            return;
+        }
+
+        next = std::move(fresh);
+        fencePending = true;
+        queue->Post([this]() { RunFence(); });
+        fenced.wait(lock, [this]() { return !fencePending; });
+        std::unique_ptr<SerialQueue> old = std::move(retired);
+        lock.unlock();
+    }
+    void SwitchableQueue::Drain() {
+        std::lock_guard<std::mutex> switchLock(switchMtx);
+        SerialQueue* current;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            current = queue.get();
+        }
+        if (current) current->Drain();
+    }
+
+    WorkerPool::WorkerPool(uint32_t ThreadCount)
+        : stopping(false) {
+        if (!ThreadCount) ThreadCount = std::max(1u, std::thread::hardware_concurrency());
+        threads.reserve(ThreadCount);
+        for (uint32_t i = 0; i < ThreadCount; ++i)
+            threads.emplace_back(&WorkerPool::WorkerFunction, this);
+    }
+    WorkerPool::~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& thread : threads) thread.join();
+    }
+
+    void WorkerPool::WorkerFunction() {
+        while (true) {
+            SerialQueue* queue;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                wake.wait(lock, [this]() { return stopping || !ready.empty(); });
+                if (ready.empty()) return;
+                queue = ready.front();
+                ready.pop_front();
+            }
+            queue->RunBatch();
+        }
+    }
+    void WorkerPool::Schedule(SerialQueue* Queue) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            ready.push_back(Queue);
+        }
+        wake.notify_one();
+    }
+
+    uint32_t WorkerPool::ThreadCount() const {
+        return (uint32_t)threads.size();
+    }
+}
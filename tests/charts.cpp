@@ -0,0 +1,131 @@
+#include <brendantui/charts.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "test.h"
+
+using namespace btui;
+
+namespace {
+    constexpr uint32_t width = 24;
+    constexpr uint32_t height = 5;
+
+    struct Canvas {
+        std::vector<BufferGridCell> cells;
+
+        Canvas()
+            : cells((size_t)width * height, BufferGridCell(L'?', 0, 0)) { }
+
+        BufferGrid Grid() {
+            return BufferGrid(width, height, cells.data());
+        }
+        bool operator==(const Canvas& Other) const {
+            for (size_t i = 0; i < cells.size(); ++i) {
+                const BufferGridCell& a = cells[i];
+                const BufferGridCell& b = Other.cells[i];
+                if (a.character != b.character || a.forecolor != b.forecolor || a.backcolor != b.backcolor) return false;
+            }
+            return true;
+        }
+    };
+
+    struct Range {
+        float low;
+        float high;
+    };
+
+    Range RandomRange(btui_tests::Random& Random) {
+        // Half the time fitted to the samples.
+        if (Random.Below(2)) return { 0, 0 };
+        return { -(float)Random.Below(50), (float)Random.Below(50) + 1 };
+    }
+
+    float RandomSample(btui_tests::Random& Random) {
+        return (float)Random.Below(2000) / 20.0f - 50.0f;
+    }
+
+    // What ChartSeries must show: the retained samples
+    // cut at multiples of the column width it uses,
+    // the newest Columns of those columns.
+    Canvas ExpectedSeries(const ChartSeries& Series, ChartStyle Style, Range R) {
+        uint64_t perColumn = std::max<uint64_t>(1, (Series.Capacity() + width - 1) / width);
+        uint64_t oldest = Series.TotalPushed() - Series.Size();
+
+        std::vector<details::ChartBucket> buckets;
+        uint64_t current = (uint64_t)-1;
+        for (size_t i = 0; i < Series.Size(); ++i) {
+            uint64_t column = (oldest + i) / perColumn;
+            if (column != current) {
+                buckets.emplace_back();
+                current = column;
+            }
+            float sample = Series.At(i);
+            buckets.back().Add(&sample, 1);
+        }
+        if (buckets.size() > width) buckets.erase(buckets.begin(), buckets.end() - width);
+
+        Canvas canvas;
+        details::DrawChartBuckets(canvas.Grid(), RectU32(0, 0, width, height), buckets.data(), (uint32_t)buckets.size(), Style, R.low, R.high, 1, 2);
+        return canvas;
+    }
+}
+
+BTUI_TEST(ChartSeriesMatchesDrawChart) {
+    // With no more samples than columns, each column is
+    // one sample either way.
+    btui_tests::Random random(43);
+    for (int round = 0; round < 50; ++round) {
+        ChartSeries series(1 + random.Below(width));
+        ChartStyle style = random.Below(2) ? ChartStyleBars : ChartStyleLine;
+        for (int step = 0; step < 60; ++step) {
+            uint32_t pushes = random.Below(4);
+            for (uint32_t i = 0; i < pushes; ++i) series.Push(RandomSample(random));
+
+            std::vector<float> retained;
+            for (size_t i = 0; i < series.Size(); ++i) retained.push_back(series.At(i));
+            Range range = RandomRange(random);
+
+            Canvas drawn;
+            series.Draw(drawn.Grid(), RectU32(0, 0, width, height), style, range.low, range.high, 1, 2);
+            Canvas expected;
+            DrawChart(expected.Grid(), RectU32(0, 0, width, height), retained.data(), retained.size(), style, range.low, range.high, 1, 2);
+            BTUI_CHECK(drawn == expected);
+        }
+    }
+}
+
+BTUI_TEST(ChartSeriesIndependentOfDrawRate) {
+    // Two series get the same samples; one is drawn
+    // after every push, the other only now and then.
+    // Both must show the retained samples and nothing
+    // that has left the ring.
+    btui_tests::Random random(4343);
+    for (int round = 0; round < 40; ++round) {
+        size_t capacity = width + random.Below(200);
+        ChartSeries often(capacity);
+        ChartSeries rarely(capacity);
+        ChartStyle style = random.Below(2) ? ChartStyleBars : ChartStyleLine;
+
+        for (int step = 0; step < 40; ++step) {
+            uint32_t pushes = random.Below(2) ? random.Below(20) : random.Below((uint32_t)capacity * 2);
+            for (uint32_t i = 0; i < pushes; ++i) {
+                float sample = RandomSample(random);
+                often.Push(sample);
+                rarely.Push(&sample, 1);
+
+                Canvas scratch;
+                often.Draw(scratch.Grid(), RectU32(0, 0, width, height), style, 0, 0, 1, 2);
+            }
+
+            Range range = RandomRange(random);
+            Canvas drawnOften;
+            often.Draw(drawnOften.Grid(), RectU32(0, 0, width, height), style, range.low, range.high, 1, 2);
+            Canvas drawnRarely;
+            rarely.Draw(drawnRarely.Grid(), RectU32(0, 0, width, height), style, range.low, range.high, 1, 2);
+            Canvas expected = ExpectedSeries(often, style, range);
+            BTUI_CHECK(drawnOften == expected);
+            BTUI_CHECK(drawnRarely == expected);
+        }
+    }
+}
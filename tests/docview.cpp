@@ -0,0 +1,360 @@
+#include <brendantui/docview.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+
+using namespace btui;
+
+namespace {
+    // What a rope line should resolve to: the segment
+    // source, the index within that source, and the
+    // highlight.
+    struct RopeLine {
+        LineSource source;
+        uint64_t index;
+        bool highlighted;
+        uint32_t backcolor;
+    };
+
+    bool RopeMatches(const details::LineRope& Rope, const std::vector<RopeLine>& Expected) {
+        if (Rope.LineCount() != Expected.size()) return false;
+        for (uint64_t i = 0; i < Expected.size(); ++i) {
+            uint64_t offset;
+            const details::LineSegment* segment = Rope.Find(i, offset);
+            if (!segment || offset >= segment->count) return false;
+            const RopeLine& line = Expected[i];
+            if (segment->source != line.source || segment->start + offset != line.index) return false;
+            if (segment->highlighted != line.highlighted) return false;
+            if (line.highlighted && segment->highlightBackcolor != line.backcolor) return false;
+        }
+        uint64_t offset;
+        return !Rope.Find(Expected.size(), offset);
+    }
+
+    struct DocLine {
+        std::wstring text;
+        bool highlighted;
+        uint32_t backcolor;
+    };
+
+    std::filesystem::path TempPath(const char* Name) {
+        return std::filesystem::temp_directory_path() / Name;
+    }
+
+    // Writes Count lines mixing empty lines, "\r\n"
+    // endings, stray '\r's and multibyte characters,
+    // and returns what each line should decode to.
+    // Without Terminated the last line has no '\n'.
+    std::vector<std::wstring> WriteFile(const std::filesystem::path& Path, uint32_t Count, bool Terminated, uint64_t Seed) {
+        btui_tests::Random random(Seed);
+        std::string bytes;
+        std::vector<std::wstring> lines;
+        for (uint32_t i = 0; i < Count; ++i) {
+            std::wstring text;
+            if (random.Below(8)) {
+                text = std::to_wstring(i);
+                bytes += std::to_string(i);
+            }
+            for (uint32_t c = random.Below(4) ? random.Below(12) : 0; c; --c) {
+                if (random.Below(5)) {
+                    char ch = (char)('a' + random.Below(26));
+                    bytes += ch;
+                    text += (wchar_t)ch;
+                }
+                else {
+                    bytes += "\xC3\xA9";
+                    text += L'\u00E9';
+                }
+            }
+
+            bool last = i + 1 == Count;
+            switch (random.Below(3)) {
+            case 0:
+                // A '\r' that doesn't end the line shows
+                // as a space.
+                bytes += '\r';
+                text += L' ';
+                bytes += "x";
+                text += L'x';
+                break;
+            case 1:
+                bytes += '\r';
+                break;
+            }
+            if (!last || Terminated) bytes += '\n';
+            lines.push_back(text);
+        }
+
+        std::ofstream out(Path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), (std::streamsize)bytes.size());
+        return lines;
+    }
+
+    bool OpenAndIndex(Document& Doc, const std::filesystem::path& Path) {
+        if (!Doc.Open(Path)) return false;
+        for (int i = 0; i < 5000 && !Doc.IndexingComplete(); ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return Doc.IndexingComplete();
+    }
+
+    bool DocumentMatches(const Document& Doc, const std::vector<DocLine>& Expected) {
+        if (Doc.LineCount() != Expected.size()) return false;
+        for (uint64_t i = 0; i < Expected.size(); ++i) {
+            if (Doc.GetLine(i) != Expected[i].text) return false;
+            uint32_t backcolor = 0;
+            bool highlighted = Doc.LineHighlight(i, backcolor);
+            if (highlighted != Expected[i].highlighted) return false;
+            if (highlighted && backcolor != Expected[i].backcolor) return false;
+        }
+        return Doc.GetLine(Expected.size()).empty();
+    }
+}
+
+BTUI_TEST(LineRopeMatchesReference) {
+    // Random edits that keep cutting existing segments
+    // (so Split lands inside, at the edges of and
+    // between nodes) and rejoining the pieces.
+    btui_tests::Random random(8086);
+    details::LineRope rope;
+    std::vector<RopeLine> expected;
+    uint64_t nextIndex = 0;
+
+    BTUI_CHECK(RopeMatches(rope, expected));
+    for (uint32_t step = 0; step < 2000; ++step) {
+        uint64_t size = expected.size();
+        uint32_t op = random.Below(5);
+        if (op == 0 || size < 8) {
+            LineSource source = random.Below(2) ? LineSourceFile : LineSourceEdit;
+            uint64_t count = 1 + random.Below(20);
+            uint64_t line = random.Below((uint32_t)size + 1);
+            rope.Insert(line, details::LineSegment(source, nextIndex, count));
+            std::vector<RopeLine> added;
+            for (uint64_t i = 0; i < count; ++i) added.push_back(RopeLine{ source, nextIndex + i, false, 0 });
+            expected.insert(expected.begin() + line, added.begin(), added.end());
+            nextIndex += count;
+        }
+        else if (op == 1) {
+            uint64_t count = 1 + random.Below(20);
+            rope.Append(details::LineSegment(LineSourceFile, nextIndex, count));
+            for (uint64_t i = 0; i < count; ++i) expected.push_back(RopeLine{ LineSourceFile, nextIndex + i, false, 0 });
+            nextIndex += count;
+        }
+        else if (op == 2) {
+            uint64_t line = random.Below((uint32_t)size);
+            uint64_t count = random.Below((uint32_t)(size - line) + 1);
+            rope.Erase(line, count);
+            expected.erase(expected.begin() + line, expected.begin() + line + count);
+        }
+        else {
+            uint64_t line = random.Below((uint32_t)size);
+            uint64_t count = random.Below((uint32_t)(size - line) + 1);
+            bool highlighted = op == 3;
+            uint32_t backcolor = highlighted ? 0xFF000000 | random.Below(0x1000000) : 0;
+            rope.SetHighlight(line, count, highlighted, backcolor);
+            for (uint64_t i = line; i < line + count; ++i) {
+                expected[i].highlighted = highlighted;
+                expected[i].backcolor = backcolor;
+            }
+        }
+
+        if (!RopeMatches(rope, expected)) {
+            BTUI_CHECK(RopeMatches(rope, expected));
+            return;
+        }
+    }
+
+    rope.Erase(0, expected.size());
+    expected.clear();
+    BTUI_CHECK(RopeMatches(rope, expected));
+}
+
+BTUI_TEST(LineRopeSplitsInsideSegments) {
+    details::LineRope rope;
+    rope.Append(details::LineSegment(LineSourceFile, 100, 10));
+
+    // Cut at the first line, the last line and inside.
+    rope.Insert(5, details::LineSegment(LineSourceEdit, 0, 1));
+    rope.Insert(0, details::LineSegment(LineSourceEdit, 1, 1));
+    rope.Insert(12, details::LineSegment(LineSourceEdit, 2, 1));
+    rope.Insert(11, details::LineSegment(LineSourceEdit, 3, 1));
+    std::vector<RopeLine> expected = {
+        { LineSourceEdit, 1, false, 0 },
+        { LineSourceFile, 100, false, 0 }, { LineSourceFile, 101, false, 0 }, { LineSourceFile, 102, false, 0 },
+        { LineSourceFile, 103, false, 0 }, { LineSourceFile, 104, false, 0 },
+        { LineSourceEdit, 0, false, 0 },
+        { LineSourceFile, 105, false, 0 }, { LineSourceFile, 106, false, 0 }, { LineSourceFile, 107, false, 0 },
+        { LineSourceFile, 108, false, 0 },
+        { LineSourceEdit, 3, false, 0 },
+        { LineSourceFile, 109, false, 0 },
+        { LineSourceEdit, 2, false, 0 }
+    };
+    BTUI_CHECK(RopeMatches(rope, expected));
+
+    // A highlight and an erase that each start and end
+    // inside a segment.
+    rope.SetHighlight(3, 6, true, 0xFF112233);
+    for (uint64_t i = 3; i < 9; ++i) {
+        expected[i].highlighted = true;
+        expected[i].backcolor = 0xFF112233;
+    }
+    BTUI_CHECK(RopeMatches(rope, expected));
+    rope.Erase(2, 5);
+    expected.erase(expected.begin() + 2, expected.begin() + 7);
+    BTUI_CHECK(RopeMatches(rope, expected));
+
+    // Empty segments and ranges change nothing.
+    rope.Insert(3, details::LineSegment(LineSourceEdit, 9, 0));
+    rope.Append(details::LineSegment(LineSourceEdit, 9, 0));
+    rope.Erase(4, 0);
+    rope.SetHighlight(0, 0, true, 0xFFFFFFFF);
+    BTUI_CHECK(RopeMatches(rope, expected));
+}
+
+BTUI_TEST(DocumentReadsLinesAcrossCheckpoints) {
+    // Line counts on both sides of checkpoint
+    // boundaries, with and without a final '\n'.
+    const uint32_t counts[] = { 1, 2, 63, 64, 65, 127, 128, 129, 200 };
+    std::filesystem::path path = TempPath("btui_docview_test.txt");
+    for (uint32_t count : counts) {
+        for (int terminated = 0; terminated < 2; ++terminated) {
+            std::vector<std::wstring> lines = WriteFile(path, count, terminated, count * 2 + terminated);
+            Document doc;
+            BTUI_CHECK(OpenAndIndex(doc, path));
+            BTUI_CHECK(doc.LineCount() == lines.size());
+            if (doc.LineCount() != lines.size()) continue;
+
+            for (uint64_t i = 0; i < lines.size(); ++i) {
+                BTUI_CHECK(doc.GetLine(i) == lines[i]);
+                if (lines[i].size() > 3) BTUI_CHECK(doc.GetLine(i, 1, 2) == lines[i].substr(1, 2));
+            }
+            BTUI_CHECK(doc.GetLine(lines.size()).empty());
+        }
+    }
+
+    // An empty file has no lines; a lone '\n' has one.
+    {
+        std::ofstream(path, std::ios::binary | std::ios::trunc);
+        Document doc;
+        BTUI_CHECK(OpenAndIndex(doc, path));
+        BTUI_CHECK(doc.LineCount() == 0);
+    }
+    {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << "\r\n";
+        Document doc;
+        BTUI_CHECK(OpenAndIndex(doc, path));
+        BTUI_CHECK(doc.LineCount() == 1);
+        BTUI_CHECK(doc.GetLine(0).empty());
+    }
+    std::filesystem::remove(path);
+}
+
+BTUI_TEST(DocumentEditsMatchReference) {
+    // Edits land both inside and past the part of the
+    // file the rope already covers, so CoverLines keeps
+    // extending it.
+    std::filesystem::path path = TempPath("btui_docview_edit_test.txt");
+    for (int terminated = 0; terminated < 2; ++terminated) {
+        std::vector<std::wstring> lines = WriteFile(path, 300, terminated, 77 + terminated);
+        Document doc;
+        BTUI_CHECK(OpenAndIndex(doc, path));
+
+        std::vector<DocLine> expected;
+        for (const std::wstring& line : lines) expected.push_back(DocLine{ line, false, 0 });
+        BTUI_CHECK(DocumentMatches(doc, expected));
+
+        btui_tests::Random random(31337 + terminated);
+        uint32_t counter = 0;
+        for (uint32_t step = 0; step < 400; ++step) {
+            uint64_t size = expected.size();
+            // Mostly near the front early on, so coverage
+            // grows gradually.
+            uint32_t reach = (uint32_t)std::min<uint64_t>(size, 8 + step);
+            uint64_t line = reach ? random.Below(reach) : 0;
+            uint32_t op = random.Below(5);
+            if (op == 0 || !size) {
+                std::vector<std::wstring> added;
+                for (uint32_t i = random.Below(4); i; --i) added.push_back(L"new " + std::to_wstring(counter++));
+                BTUI_CHECK(doc.InsertLines(line, added));
+                std::vector<DocLine> addedLines;
+                for (const std::wstring& text : added) addedLines.push_back(DocLine{ text, false, 0 });
+                expected.insert(expected.begin() + line, addedLines.begin(), addedLines.end());
+            }
+            else if (op == 1) {
+                uint64_t count = std::min<uint64_t>(random.Below(4), size - line);
+                BTUI_CHECK(doc.DeleteLines(line, count));
+                expected.erase(expected.begin() + line, expected.begin() + line + count);
+            }
+            else if (op == 2) {
+                // Often the same line again, so edit lines
+                // get replaced as well as file lines.
+                if (random.Below(2)) line = line / 4;
+                std::wstring text = L"replaced " + std::to_wstring(counter++);
+                BTUI_CHECK(doc.ReplaceLine(line, text));
+                expected[line] = DocLine{ text, false, 0 };
+            }
+            else {
+                uint64_t count = std::min<uint64_t>(random.Below(6), size - line);
+                bool highlighted = op == 3;
+                uint32_t backcolor = highlighted ? 0xFF000000 | random.Below(0x1000000) : 0;
+                BTUI_CHECK(highlighted ? doc.HighlightLines(line, count, backcolor) : doc.ClearHighlight(line, count));
+                for (uint64_t i = line; i < line + count; ++i) {
+                    expected[i].highlighted = highlighted;
+                    expected[i].backcolor = backcolor;
+                }
+            }
+
+            if (!DocumentMatches(doc, expected)) {
+                BTUI_CHECK(DocumentMatches(doc, expected));
+                break;
+            }
+        }
+
+        // The last file line, and nothing past the end.
+        uint64_t size = expected.size();
+        BTUI_CHECK(doc.ReplaceLine(size - 1, L"last"));
+        expected[size - 1] = DocLine{ L"last", false, 0 };
+        BTUI_CHECK(DocumentMatches(doc, expected));
+        BTUI_CHECK(!doc.ReplaceLine(size, L"past"));
+        BTUI_CHECK(!doc.DeleteLines(size - 1, 2));
+        BTUI_CHECK(!doc.HighlightLines(size, 1, 0xFFFFFFFF));
+        BTUI_CHECK(!doc.InsertLines(size + 1, { L"past" }));
+        BTUI_CHECK(doc.InsertLines(size, { L"end" }));
+        expected.push_back(DocLine{ L"end", false, 0 });
+        BTUI_CHECK(DocumentMatches(doc, expected));
+    }
+    std::filesystem::remove(path);
+}
+
+BTUI_TEST(DocumentReplacesEditLinesInPlace) {
+    // Replacing one line of an inserted block over and
+    // over leaves its neighbours alone.
+    std::filesystem::path path = TempPath("btui_docview_replace_test.txt");
+    std::vector<std::wstring> lines = WriteFile(path, 10, true, 5);
+    Document doc;
+    BTUI_CHECK(OpenAndIndex(doc, path));
+
+    BTUI_CHECK(doc.InsertLines(4, { L"a", L"b", L"c" }));
+    BTUI_CHECK(doc.HighlightLines(4, 3, 0xFF0000FF));
+    for (int i = 0; i < 1000; ++i) BTUI_CHECK(doc.ReplaceLine(5, L"b" + std::to_wstring(i)));
+
+    BTUI_CHECK(doc.LineCount() == lines.size() + 3);
+    BTUI_CHECK(doc.GetLine(3) == lines[3]);
+    BTUI_CHECK(doc.GetLine(4) == L"a");
+    BTUI_CHECK(doc.GetLine(5) == L"b999");
+    BTUI_CHECK(doc.GetLine(6) == L"c");
+    BTUI_CHECK(doc.GetLine(7) == lines[4]);
+
+    uint32_t backcolor;
+    BTUI_CHECK(doc.LineHighlight(4, backcolor) && backcolor == 0xFF0000FF);
+    BTUI_CHECK(!doc.LineHighlight(5, backcolor));
+    BTUI_CHECK(doc.LineHighlight(6, backcolor) && backcolor == 0xFF0000FF);
+    doc.Close();
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,144 @@
+#include <brendantui/framerecording.h>
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "test.h"
+
+using namespace btui;
+
+namespace {
+    struct RecordedFrame {
+        SizeU32 size;
+        std::vector<BufferGridCell> cells;
+    };
+
+    // Frames that mostly repeat their predecessor, with
+    // a few size changes, so keyframes, deltas, skips
+    // and repeat runs all get exercised.
+    std::vector<RecordedFrame> MakeFrames(uint32_t Count) {
+        btui_tests::Random random(12345);
+        const uint32_t palette[] = { 0xFF000000, 0xFFFFFFFF, 0xFF336699, 0x80FF0000, 0xFF00FF00, 0x00000000 };
+
+        std::vector<RecordedFrame> frames;
+        RecordedFrame frame;
+        frame.size = SizeU32(40, 12);
+        frame.cells.resize(40 * 12);
+        for (uint32_t i = 0; i < Count; ++i) {
+            if (i % 17 == 9) {
+                frame.size = SizeU32(20 + random.Below(40), 5 + random.Below(20));
+                frame.cells.assign((size_t)frame.size.width * frame.size.height, BufferGridCell());
+            }
+            uint32_t edits = random.Below(4) ? random.Below(30) : (uint32_t)frame.cells.size();
+            for (uint32_t e = 0; e < edits; ++e) {
+                BufferGridCell& cell = frame.cells[random.Below((uint32_t)frame.cells.size())];
+                // Include characters that need more than
+                // one varint byte.
+                cell.character = (wchar_t)(random.Below(3) ? L'a' + random.Below(26) : 0x2500 + random.Below(0x100));
+                cell.forecolor = palette[random.Below(6)];
+                cell.backcolor = palette[random.Below(6)];
+            }
+            frames.push_back(frame);
+        }
+        return frames;
+    }
+
+    bool SameFrame(BufferGrid Grid, const RecordedFrame& Expected) {
+        if (Grid.size != Expected.size) return false;
+        for (size_t i = 0; i < Expected.cells.size(); ++i) {
+            const BufferGridCell& a = Grid.buffer[i];
+            const BufferGridCell& b = Expected.cells[i];
+            if (a.character != b.character || a.forecolor != b.forecolor || a.backcolor != b.backcolor) return false;
+        }
+        return true;
+    }
+
+    std::filesystem::path TempPath(const char* Name) {
+        return std::filesystem::temp_directory_path() / Name;
+    }
+
+    void Record(const std::filesystem::path& Path, const std::vector<RecordedFrame>& Frames, uint64_t& BaseNs) {
+        FrameRecorder recorder;
+        BTUI_CHECK(recorder.Open(Path, 8));
+        BaseNs = details::NowNs();
+        for (size_t i = 0; i < Frames.size(); ++i) {
+            std::vector<BufferGridCell> cells = Frames[i].cells;
+            recorder.AddFrame(BufferGrid(Frames[i].size, cells.data()), BaseNs + i * 16000000ull);
+        }
+        BTUI_CHECK(recorder.FrameCount() == Frames.size());
+        recorder.Close();
+    }
+
+    void CheckPlayback(const std::filesystem::path& Path, const std::vector<RecordedFrame>& Frames) {
+        FramePlayer player;
+        BTUI_CHECK(player.Open(Path));
+        BTUI_CHECK(player.FrameCount() == Frames.size());
+        if (player.FrameCount() != Frames.size()) return;
+
+        // Straight through.
+        BTUI_CHECK(player.SeekToFrame(0));
+        uint64_t firstTimeUs = player.CurrentTimeUs();
+        for (size_t i = 0; i < Frames.size(); ++i) {
+            if (i) BTUI_CHECK(player.NextFrame());
+            BTUI_CHECK(player.CurrentFrameIndex() == i);
+            BTUI_CHECK(player.CurrentTimeUs() - firstTimeUs == i * 16000);
+            BTUI_CHECK(SameFrame(player.CurrentFrame(), Frames[i]));
+        }
+        BTUI_CHECK(!player.NextFrame());
+
+        // Random seeks, backwards and forwards.
+        btui_tests::Random random(99);
+        for (int i = 0; i < 50; ++i) {
+            uint32_t target = random.Below((uint32_t)Frames.size());
+            BTUI_CHECK(player.SeekToFrame(target));
+            BTUI_CHECK(SameFrame(player.CurrentFrame(), Frames[target]));
+        }
+
+        BTUI_CHECK(player.SeekToTime(firstTimeUs + 20 * 16000 + 5));
+        BTUI_CHECK(player.CurrentFrameIndex() == 20);
+        BTUI_CHECK(!player.SeekToFrame(Frames.size()));
+    }
+}
+
+BTUI_TEST(FrameRecordingRoundTrip) {
+    std::vector<RecordedFrame> frames = MakeFrames(100);
+    std::filesystem::path path = TempPath("btui_test_roundtrip.btrec");
+
+    uint64_t baseNs;
+    Record(path, frames, baseNs);
+    CheckPlayback(path, frames);
+
+    std::filesystem::remove(path);
+}
+
+BTUI_TEST(FrameRecordingWithoutIndex) {
+    // A recording cut off before Close() wrote the
+    // index must still play, by scanning the records.
+    std::vector<RecordedFrame> frames = MakeFrames(60);
+    std::filesystem::path path = TempPath("btui_test_noindex.btrec");
+
+    uint64_t baseNs;
+    Record(path, frames, baseNs);
+
+    std::vector<char> bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    BTUI_CHECK(bytes.size() > 16);
+    if (bytes.size() <= 16) return;
+
+    uint64_t indexOffset = 0;
+    for (int i = 0; i < 8; ++i) indexOffset |= (uint64_t)(uint8_t)bytes[bytes.size() - 16 + i] << (8 * i);
+    BTUI_CHECK(indexOffset < bytes.size());
+    if (indexOffset >= bytes.size()) return;
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), (std::streamsize)indexOffset);
+    }
+
+    CheckPlayback(path, frames);
+
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,91 @@
+#include <brendantui/gridbuffer.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "test.h"
+
+using namespace btui;
+
+namespace {
+    bool SameCell(const BufferGridCell& A, const BufferGridCell& B) {
+        return A.character == B.character && A.forecolor == B.forecolor && A.backcolor == B.backcolor;
+    }
+
+    // The plain model Resize() must agree with: the
+    // overlapping top-left region stays, the rest is
+    // Fill.
+    std::vector<BufferGridCell> ModelResize(const std::vector<BufferGridCell>& Old, SizeU32 OldSize, SizeU32 NewSize, bool Preserve, BufferGridCell Fill) {
+        std::vector<BufferGridCell> out((size_t)NewSize.width * NewSize.height, Fill);
+        if (!Preserve) return out;
+        for (uint32_t y = 0; y < std::min(OldSize.height, NewSize.height); ++y)
+            for (uint32_t x = 0; x < std::min(OldSize.width, NewSize.width); ++x)
+                out[(size_t)y * NewSize.width + x] = Old[(size_t)y * OldSize.width + x];
+        return out;
+    }
+}
+
+BTUI_TEST(GridBufferResizeKeepsOverlap) {
+    btui_tests::Random random(7);
+    GridBuffer buffer;
+    std::vector<BufferGridCell> model;
+    SizeU32 size;
+    uint32_t allocations = 0;
+
+    for (uint32_t step = 0; step < 2000; ++step) {
+        // Stay mostly within one capacity, so the
+        // in-place paths (rows moving either way) run
+        // far more often than reallocation.
+        SizeU32 newSize(random.Below(step % 100 == 99 ? 200 : 60), random.Below(40));
+        bool preserve = random.Below(5) != 0;
+        BufferGridCell fill((wchar_t)(L'A' + step % 26), 0xFF000000 | step, 0xFF000000 | (step * 7));
+
+        model = ModelResize(model, size, newSize, preserve, fill);
+        if (buffer.Resize(newSize, preserve, fill)) ++allocations;
+        size = newSize;
+
+        BTUI_CHECK(buffer.Size() == size);
+        BTUI_CHECK(buffer.Capacity() >= model.size());
+
+        bool same = true;
+        for (size_t i = 0; i < model.size(); ++i) same = same && SameCell(buffer.Data()[i], model[i]);
+        BTUI_CHECK(same);
+
+        // Tag every cell with its position and step, so
+        // a cell moved to the wrong place shows up.
+        for (uint32_t y = 0; y < size.height; ++y) {
+            for (uint32_t x = 0; x < size.width; ++x) {
+                if (random.Below(3)) continue;
+                BufferGridCell cell((wchar_t)(x + 1), y, step);
+                buffer.Data()[(size_t)y * size.width + x] = cell;
+                model[(size_t)y * size.width + x] = cell;
+            }
+        }
+    }
+
+    // Geometric growth: only a handful of reallocations.
+    BTUI_CHECK(allocations < 20);
+}
+
+BTUI_TEST(GridBufferShrinkToFitAndMove) {
+    GridBuffer buffer(SizeU32(30, 10), BufferGridCell(L'x', 1, 2));
+    buffer.Resize(SizeU32(300, 100), true);
+    buffer.Resize(SizeU32(5, 4), true);
+    BTUI_CHECK(buffer.Capacity() >= 300 * 100);
+
+    buffer.ShrinkToFit();
+    BTUI_CHECK(buffer.Capacity() == 5 * 4);
+    BTUI_CHECK(buffer.Size() == SizeU32(5, 4));
+    bool same = true;
+    for (size_t i = 0; i < 20; ++i) same = same && SameCell(buffer.Data()[i], BufferGridCell(L'x', 1, 2));
+    BTUI_CHECK(same);
+
+    GridBuffer moved(std::move(buffer));
+    BTUI_CHECK(moved.Size() == SizeU32(5, 4));
+    BTUI_CHECK(!buffer);
+    BTUI_CHECK(buffer.Size() == SizeU32());
+
+    moved.Release();
+    BTUI_CHECK(!moved);
+    BTUI_CHECK(moved.Capacity() == 0);
+}
@@ -0,0 +1,79 @@
+#include <brendantui/image.h>
+
+#include <vector>
+
+#include "test.h"
+
+using namespace btui;
+
+namespace {
+    bool SameCells(const std::vector<BufferGridCell>& A, const std::vector<BufferGridCell>& B) {
+        for (size_t i = 0; i < A.size(); ++i)
+            if (A[i].character != B[i].character || A[i].forecolor != B[i].forecolor || A[i].backcolor != B[i].backcolor) return false;
+        return true;
+    }
+
+    // Single pixels anywhere in a row (so every offset
+    // around the 4-pixel blocks at either end comes up),
+    // spans, whole rows, or nothing at all.
+    void EditPixels(btui_tests::Random& Random, std::vector<uint8_t>& Pixels, uint32_t Width, uint32_t Height, size_t Stride) {
+        uint32_t edits = Random.Below(4);
+        for (uint32_t e = 0; e < edits; ++e) {
+            uint32_t y = Random.Below(Height);
+            uint32_t x0 = Random.Below(Width);
+            uint32_t x1 = Random.Below(3) ? x0 + 1 : x0 + 1 + Random.Below(Width - x0);
+            // Sometimes just one channel, sometimes the
+            // whole pixel.
+            for (uint32_t x = x0; x < x1; ++x) {
+                uint8_t* pixel = Pixels.data() + y * Stride + (size_t)x * 4;
+                if (Random.Below(2)) pixel[Random.Below(4)] ^= (uint8_t)(1 + Random.Below(255));
+                else for (int c = 0; c < 4; ++c) pixel[c] = (uint8_t)Random.Below(256);
+            }
+        }
+    }
+}
+
+BTUI_TEST(ImageRendererMatchesDrawImage) {
+    btui_tests::Random random(46);
+    const Align aligns[] = { AlignStart, AlignMiddle, AlignEnd };
+    for (int round = 0; round < 60; ++round) {
+        uint32_t imageWidth = 1 + random.Below(40);
+        uint32_t imageHeight = 1 + random.Below(40);
+        size_t stride = ((size_t)imageWidth + random.Below(3)) * 4;
+        std::vector<uint8_t> pixels(stride * imageHeight);
+        for (uint8_t& byte : pixels) byte = (uint8_t)random.Below(256);
+
+        // The rect sometimes runs past the buffer.
+        SizeU32 bufferSize(8 + random.Below(30), 4 + random.Below(20));
+        RectU32 rect(random.Below(4), random.Below(4), 1 + random.Below(bufferSize.width), 1 + random.Below(bufferSize.height));
+        Align horizontal = aligns[random.Below(3)];
+        Align vertical = aligns[random.Below(3)];
+
+        std::vector<BufferGridCell> incremental((size_t)bufferSize.width * bufferSize.height, BufferGridCell(L'?', 1, 2));
+        ImageRenderer renderer;
+        for (int frame = 0; frame < 30; ++frame) {
+            if (frame) EditPixels(random, pixels, imageWidth, imageHeight, stride);
+            ImageView view(pixels.data(), imageWidth, imageHeight, stride);
+            renderer.Draw(BufferGrid(bufferSize.width, bufferSize.height, incremental.data()), rect, view, horizontal, vertical, 0xFF102030);
+
+            std::vector<BufferGridCell> full((size_t)bufferSize.width * bufferSize.height, BufferGridCell(L'?', 1, 2));
+            DrawImage(BufferGrid(bufferSize.width, bufferSize.height, full.data()), rect, view, horizontal, vertical, 0xFF102030);
+            BTUI_CHECK(SameCells(incremental, full));
+        }
+    }
+}
+
+BTUI_TEST(ImageRendererSkipsUnchangedCells) {
+    // An image at its natural size, so a pixel edit
+    // maps to exactly one cell.
+    std::vector<uint8_t> pixels(16 * 8 * 4, 0x40);
+    std::vector<BufferGridCell> cells(16 * 4);
+    BufferGrid buffer(16, 4, cells.data());
+    ImageRenderer renderer;
+    BTUI_CHECK(renderer.Draw(buffer, RectU32(0, 0, 16, 4), ImageView(pixels.data(), 16, 8), AlignStart, AlignStart, 0) == 64);
+    BTUI_CHECK(renderer.Draw(buffer, RectU32(0, 0, 16, 4), ImageView(pixels.data(), 16, 8), AlignStart, AlignStart, 0) == 0);
+
+    pixels[(5 * 16 + 15) * 4] = 0x90;
+    BTUI_CHECK(renderer.Draw(buffer, RectU32(0, 0, 16, 4), ImageView(pixels.data(), 16, 8), AlignStart, AlignStart, 0) == 1);
+    BTUI_CHECK(cells[2 * 16 + 15].backcolor == 0x40904040);
+}
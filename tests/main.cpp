@@ -1,8 +1,40 @@
+#include <cstring>
 #include <iostream>
 
-#include <brendantui/drawing.h>
-#include <brendantui/windowbase.h>
+#include "test.h"
 
-int main() {
-    std::cout << "No tests implemented yet.\n";
+namespace btui_tests {
+    static uint64_t failures = 0;
+
+    std::vector<TestCase>& Registry() {
+        static std::vector<TestCase> registry;
+        return registry;
+    }
+    void Fail(const char* File, int Line, const char* Expression) {
+        std::cout << File << ":" << Line << ": check failed: " << Expression << "\n";
+        ++failures;
+    }
+}
+
+// Runs every test, or only those whose name contains
+// the first argument.
+int main(int argc, char** argv) {
+    const char* filter = argc > 1 ? argv[1] : "";
+
+    uint64_t run = 0;
+    uint64_t failed = 0;
+    for (const btui_tests::TestCase& test : btui_tests::Registry()) {
+        if (!std::strstr(test.name, filter)) continue;
+
+        uint64_t before = btui_tests::failures;
+        test.func();
+        ++run;
+        if (btui_tests::failures != before) {
+            std::cout << "FAILED " << test.name << "\n";
+            ++failed;
+        }
+    }
+
+    std::cout << run - failed << "/" << run << " tests passed.\n";
+    return failed ? 1 : 0;
 }
@@ -0,0 +1,96 @@
+#include <brendantui/quantize.h>
+
+#include <vector>
+
+#include "test.h"
+
+using namespace btui;
+
+namespace {
+    // Channels are often at or near 0 and 255, where
+    // dithering saturates.
+    uint32_t RandomColor(btui_tests::Random& Random) {
+        static const uint32_t edges[] = { 0x00, 0x01, 0x07, 0x08, 0xF8, 0xFE, 0xFF };
+        uint32_t color = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            uint32_t channel = Random.Below(3) ? Random.Below(256) : edges[Random.Below(sizeof(edges) / sizeof(edges[0]))];
+            color |= channel << shift;
+        }
+        return color;
+    }
+
+    // Runs of one color, runs differing only in alpha
+    // or character, and lone colors, so both the run
+    // check and the lookups are taken.
+    std::vector<BufferGridCell> RandomCells(btui_tests::Random& Random, size_t Count) {
+        std::vector<BufferGridCell> cells;
+        uint32_t fore = RandomColor(Random);
+        uint32_t back = RandomColor(Random);
+        for (size_t i = 0; i < Count; ++i) {
+            switch (Random.Below(8)) {
+            case 0: fore = RandomColor(Random); break;
+            case 1: back = RandomColor(Random); break;
+            case 2: fore ^= 0x01000000; break;
+            case 3: back ^= 0x00000008; break;
+            default: break;
+            }
+            cells.push_back(BufferGridCell((wchar_t)(L'a' + Random.Below(26)), fore, back));
+        }
+        return cells;
+    }
+}
+
+BTUI_TEST(QuantizerMapMatchesIndex) {
+    btui_tests::Random random(47);
+    std::vector<uint32_t> custom;
+    for (int i = 0; i < 40; ++i) custom.push_back(RandomColor(random));
+    ColorQuantizer quantizers[] = { ColorQuantizer(ColorTarget16), ColorQuantizer(ColorTarget256), ColorQuantizer(custom.data(), (uint32_t)custom.size()) };
+
+    for (const ColorQuantizer& quantizer : quantizers) {
+        for (int round = 0; round < 200; ++round) {
+            // An odd start, so blocks straddle the ends.
+            std::vector<BufferGridCell> cells = RandomCells(random, random.Below(70));
+            size_t skip = cells.empty() ? 0 : random.Below((uint32_t)cells.size());
+            size_t count = cells.size() - skip;
+
+            std::vector<uint8_t> fore(count + 1, 0xAA);
+            std::vector<uint8_t> back(count + 1, 0xAA);
+            quantizer.Map(cells.data() + skip, count, fore.data(), back.data());
+
+            bool same = fore[count] == 0xAA && back[count] == 0xAA;
+            for (size_t i = 0; i < count; ++i) {
+                same = same && fore[i] == quantizer.Index(cells[skip + i].forecolor);
+                same = same && back[i] == quantizer.Index(cells[skip + i].backcolor);
+            }
+            BTUI_CHECK(same);
+        }
+    }
+}
+
+BTUI_TEST(QuantizerMapDitheredMatchesIndexDithered) {
+    btui_tests::Random random(4747);
+    std::vector<uint32_t> custom;
+    for (int i = 0; i < 7; ++i) custom.push_back(RandomColor(random));
+    ColorQuantizer quantizers[] = { ColorQuantizer(ColorTarget16), ColorQuantizer(ColorTarget256), ColorQuantizer(custom.data(), (uint32_t)custom.size()) };
+
+    for (const ColorQuantizer& quantizer : quantizers) {
+        for (int round = 0; round < 100; ++round) {
+            uint32_t width = random.Below(23);
+            uint32_t height = 1 + random.Below(9);
+            std::vector<BufferGridCell> cells = RandomCells(random, (size_t)width * height);
+            std::vector<uint8_t> fore(cells.size());
+            std::vector<uint8_t> back(cells.size());
+            quantizer.MapDithered(BufferGrid(width, height, cells.data()), fore.data(), back.data());
+
+            bool same = true;
+            for (uint32_t y = 0; y < height; ++y) {
+                for (uint32_t x = 0; x < width; ++x) {
+                    size_t i = (size_t)y * width + x;
+                    same = same && fore[i] == quantizer.IndexDithered(cells[i].forecolor, x, y);
+                    same = same && back[i] == quantizer.IndexDithered(cells[i].backcolor, x, y);
+                }
+            }
+            BTUI_CHECK(same);
+        }
+    }
+}
@@ -0,0 +1,167 @@
+#include <brendantui/scrollback.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+using namespace btui;
+
+namespace {
+    // Renders what Draw() should show: the retained
+    // lines, hard-wrapped at Width (an empty line still
+    // takes a row), with the view's bottom ScrollRows
+    // rows above the newest one.
+    std::vector<std::wstring> ExpectedRows(const std::vector<std::wstring>& Lines, uint32_t Width, uint32_t Height, uint64_t ScrollRows) {
+        std::vector<std::wstring> rows;
+        for (const std::wstring& line : Lines) {
+            if (line.empty()) rows.push_back(std::wstring(Width, L' '));
+            for (size_t i = 0; i < line.size(); i += Width) {
+                std::wstring row = line.substr(i, Width);
+                row.resize(Width, L' ');
+                rows.push_back(row);
+            }
+        }
+
+        uint64_t bottom = rows.size() - std::min<uint64_t>(ScrollRows, rows.size());
+        uint64_t top = bottom > Height ? bottom - Height : 0;
+        std::vector<std::wstring> view(Height - (bottom - top), std::wstring(Width, L' '));
+        view.insert(view.end(), rows.begin() + top, rows.begin() + bottom);
+        return view;
+    }
+
+    std::vector<std::wstring> DrawnRows(Scrollback& Pane, uint32_t Width, uint32_t Height) {
+        std::vector<BufferGridCell> cells((size_t)Width * Height, BufferGridCell(L'?', 0, 0));
+        Pane.Draw(BufferGrid(Width, Height, cells.data()), RectU32(0, 0, Width, Height));
+
+        std::vector<std::wstring> rows;
+        for (uint32_t y = 0; y < Height; ++y) {
+            std::wstring row;
+            for (uint32_t x = 0; x < Width; ++x) row += cells[(size_t)y * Width + x].character;
+            rows.push_back(row);
+        }
+        return rows;
+    }
+
+    std::wstring MakeLine(btui_tests::Random& Random, uint32_t MaxLength) {
+        std::wstring line(Random.Below(MaxLength + 1), L' ');
+        for (wchar_t& c : line) c = (wchar_t)(L'a' + Random.Below(26));
+        return line;
+    }
+}
+
+BTUI_TEST(ScrollbackWrapMatchesModel) {
+    btui_tests::Random random(3);
+    Scrollback pane;
+    std::vector<std::wstring> lines;
+
+    for (uint32_t step = 0; step < 300; ++step) {
+        uint32_t count = random.Below(20);
+        for (uint32_t i = 0; i < count; ++i) {
+            lines.push_back(MakeLine(random, 150));
+            pane.Append(lines.back());
+        }
+
+        // Width changes rewrap; scrolling is clamped to
+        // the rows there are.
+        uint32_t width = 1 + random.Below(80);
+        uint32_t height = 1 + random.Below(30);
+        DrawnRows(pane, width, height);
+        if (random.Below(3) == 0) pane.ScrollToBottom();
+        else pane.ScrollBy((int64_t)random.Below(200) - 80);
+
+        uint64_t totalRows = 0;
+        for (const std::wstring& line : lines) totalRows += line.empty() ? 1 : (line.size() + width - 1) / width;
+
+        // Back to the bottom, then up a random amount.
+        pane.ScrollBy(-(int64_t)totalRows);
+        uint64_t scroll = random.Below((uint32_t)totalRows + 1);
+        pane.ScrollBy((int64_t)scroll);
+
+        BTUI_CHECK(DrawnRows(pane, width, height) == ExpectedRows(lines, width, height, scroll));
+        BTUI_CHECK(pane.AtBottom() == !scroll);
+    }
+    BTUI_CHECK(pane.LineCount() == lines.size());
+    BTUI_CHECK(pane.DroppedLines() == 0);
+}
+
+BTUI_TEST(ScrollbackNewLinesKeepScrolledView) {
+    Scrollback pane;
+    std::vector<std::wstring> lines;
+    for (int i = 0; i < 50; ++i) {
+        lines.push_back(std::to_wstring(i));
+        pane.Append(lines.back());
+    }
+    DrawnRows(pane, 10, 5);
+    pane.ScrollBy(20);
+    std::vector<std::wstring> before = DrawnRows(pane, 10, 5);
+
+    for (int i = 50; i < 60; ++i) pane.Append(std::to_wstring(i));
+    BTUI_CHECK(DrawnRows(pane, 10, 5) == before);
+}
+
+BTUI_TEST(ScrollbackEmptyLinesStayUnderCap) {
+    // A flood of empty lines used to grow one chunk's
+    // line table without bound.
+    const size_t cap = 256 << 10;
+    Scrollback pane(cap);
+    for (uint32_t i = 0; i < 1000000; ++i) {
+        pane.Append(L"");
+        if (i % 10000 == 0) pane.Drain();
+    }
+    pane.Drain();
+
+    BTUI_CHECK(pane.MemoryBytes() <= cap);
+    BTUI_CHECK(pane.LineCount() + pane.DroppedLines() == 1000000);
+    BTUI_CHECK(pane.DroppedLines() > 0);
+
+    std::vector<std::wstring> rows = DrawnRows(pane, 8, 4);
+    BTUI_CHECK(rows == std::vector<std::wstring>(4, std::wstring(8, L' ')));
+}
+
+BTUI_TEST(ScrollbackTrimKeepsNewestLines) {
+    btui_tests::Random random(11);
+    const size_t cap = 64 << 10;
+    Scrollback pane(cap);
+    std::vector<std::wstring> lines;
+
+    for (uint32_t step = 0; step < 200; ++step) {
+        uint32_t count = random.Below(200);
+        for (uint32_t i = 0; i < count; ++i) {
+            lines.push_back(MakeLine(random, random.Below(10) ? 10 : 2000));
+            pane.Append(lines.back());
+        }
+
+        uint32_t width = 1 + random.Below(60);
+        uint32_t height = 1 + random.Below(20);
+        pane.ScrollToBottom();
+        std::vector<std::wstring> drawn = DrawnRows(pane, width, height);
+
+        BTUI_CHECK(pane.MemoryBytes() <= cap);
+        BTUI_CHECK(pane.LineCount() + pane.DroppedLines() == lines.size());
+
+        // Whatever was dropped, the lines kept are the
+        // newest ones, in order, and their rows add up.
+        std::vector<std::wstring> kept(lines.end() - (ptrdiff_t)pane.LineCount(), lines.end());
+        BTUI_CHECK(drawn == ExpectedRows(kept, width, height, 0));
+
+        uint64_t keptRows = 0;
+        for (const std::wstring& line : kept) keptRows += line.empty() ? 1 : (line.size() + width - 1) / width;
+        pane.ScrollBy((int64_t)keptRows + 100);
+        pane.ScrollBy(-(int64_t)height);
+        BTUI_CHECK(DrawnRows(pane, width, height) == ExpectedRows(kept, width, height, keptRows - std::min<uint64_t>(keptRows, height)));
+    }
+}
+
+BTUI_TEST(ScrollbackCutsOverlongLines) {
+    const size_t cap = 4096;
+    Scrollback pane(cap);
+    pane.Append(std::wstring(100000, L'x'));
+    pane.Append(L"tail");
+    pane.Drain();
+
+    BTUI_CHECK(pane.MemoryBytes() <= cap);
+    BTUI_CHECK(pane.LineCount() >= 1);
+    BTUI_CHECK(DrawnRows(pane, 10, 1) == std::vector<std::wstring>(1, L"tail      "));
+}
@@ -0,0 +1,117 @@
+#include <brendantui/statictable.h>
+
+#include <vector>
+
+#include "test.h"
+
+using namespace btui;
+
+namespace {
+    static constexpr auto fullSpec = MakeStaticTableSpec<3, 2>({ 4, 1, 6 }, { 2, 3 });
+
+    // Some borders missing, and zero-width tracks.
+    static constexpr StaticTableSpec<4, 3> partialSpec = {
+        { 3, 0, 5, 2 },
+        { 1, 0, 2 },
+        { true, true, false, true,
+          false, true, true, false,
+          true, false, true, true,
+          true, true, true, false },
+        { true, false, true, true, false,
+          false, true, true, false, true,
+          true, true, false, true, true }
+    };
+
+    static constexpr auto singleSpec = MakeStaticTableSpec<1, 1>({ 7 }, { 2 });
+
+    const BufferGridCell sentinel(L'#', 0x12345678, 0x87654321);
+
+    std::vector<BufferGridCell> MakeBackground(btui_tests::Random& Random, SizeU32 Size) {
+        std::vector<BufferGridCell> cells((size_t)Size.width * Size.height);
+        for (BufferGridCell& cell : cells)
+            cell = BufferGridCell((wchar_t)(L'a' + Random.Below(26)), 0xFF000000 | (uint32_t)Random.Next(), (uint32_t)Random.Next());
+        return cells;
+    }
+
+    bool SameCells(const std::vector<BufferGridCell>& A, const std::vector<BufferGridCell>& B) {
+        if (A.size() != B.size()) return false;
+        for (size_t i = 0; i < A.size(); ++i)
+            if (A[i].character != B[i].character || A[i].forecolor != B[i].forecolor || A[i].backcolor != B[i].backcolor) return false;
+        return true;
+    }
+
+    void DrawDynamic(BufferGrid Buffer, RectU32 Frame, const auto& Spec, backgroundFill_t Fill) {
+        auto columnWidths = Spec.columnWidths;
+        auto rowHeights = Spec.rowHeights;
+        auto horizontal = Spec.horizontalBorders;
+        auto vertical = Spec.verticalBorders;
+        DrawTableInFrame(Buffer, Frame, (uint32_t)columnWidths.size(), (uint32_t)rowHeights.size(), columnWidths.data(), rowHeights.data(), horizontal.data(), vertical.data(), 0xFF101010, 0xFFE0E0E0, Fill);
+    }
+
+    // Draws Spec both ways into copies of the same
+    // background, over frames clipped by the frame rect
+    // and by the buffer edge alike.
+    template <auto _Spec>
+    void CompareWithDynamic(uint64_t Seed) {
+        btui_tests::Random random(Seed);
+        SizeU32 tableSize = StaticTableLayout<_Spec>::Size();
+        const backgroundFill_t fills[] = { std::monostate(), BufferGridCell(L'.', 0xFF00FF00, 0xFF000080), (uint32_t)0x80FF0000 };
+
+        for (int i = 0; i < 400; ++i) {
+            SizeU32 size(1 + random.Below(tableSize.width + 8), 1 + random.Below(tableSize.height + 8));
+            RectU32 frame(random.Below(size.width), random.Below(size.height), random.Below(tableSize.width + 4), random.Below(tableSize.height + 4));
+            const backgroundFill_t& fill = fills[random.Below(3)];
+
+            std::vector<BufferGridCell> expected = MakeBackground(random, size);
+            std::vector<BufferGridCell> actual = expected;
+            DrawDynamic(BufferGrid(size, expected.data()), frame, _Spec, fill);
+            StaticTableLayout<_Spec>::Draw(BufferGrid(size, actual.data()), frame, 0xFF101010, 0xFFE0E0E0, fill);
+
+            BTUI_CHECK(SameCells(actual, expected));
+        }
+    }
+
+    // Returns false if DrawTableInFrame touched any
+    // cell outside Frame.
+    bool StaysInFrame(SizeU32 Size, RectU32 Frame, const auto& Spec) {
+        std::vector<BufferGridCell> cells((size_t)Size.width * Size.height, sentinel);
+        DrawDynamic(BufferGrid(Size, cells.data()), Frame, Spec, BufferGridCell());
+
+        for (uint32_t y = 0; y < Size.height; ++y) {
+            for (uint32_t x = 0; x < Size.width; ++x) {
+                bool inside = x >= Frame.x && y >= Frame.y && x < Frame.x + Frame.width && y < Frame.y + Frame.height;
+                const BufferGridCell& cell = cells[(size_t)y * Size.width + x];
+                if (!inside && (cell.character != sentinel.character || cell.forecolor != sentinel.forecolor || cell.backcolor != sentinel.backcolor)) return false;
+            }
+        }
+        return true;
+    }
+}
+
+BTUI_TEST(StaticTableMatchesDrawTableInFrame) {
+    CompareWithDynamic<fullSpec>(1);
+    CompareWithDynamic<partialSpec>(2);
+    CompareWithDynamic<singleSpec>(3);
+}
+
+BTUI_TEST(StaticTableCellRects) {
+    using Layout = StaticTableLayout<fullSpec>;
+    BTUI_CHECK(Layout::Size() == SizeU32(1 + 4 + 1 + 1 + 1 + 6 + 1, 1 + 2 + 1 + 3 + 1));
+    BTUI_CHECK(Layout::CellRect(0, 0) == RectU32(1, 1, 4, 2));
+    BTUI_CHECK(Layout::CellRect(2, 0) == RectU32(8, 1, 6, 2));
+    BTUI_CHECK(Layout::CellRect(1, 1) == RectU32(6, 4, 1, 3));
+}
+
+BTUI_TEST(DrawTableInFrameClipsLastJunction) {
+    // With the table wider than the frame, the last
+    // junction column used to be written one cell past
+    // the frame's right edge.
+    SizeU32 tableSize = StaticTableLayout<fullSpec>::Size();
+    for (uint32_t width = 0; width <= tableSize.width + 1; ++width)
+        for (uint32_t height = 0; height <= tableSize.height + 1; ++height)
+            BTUI_CHECK(StaysInFrame(SizeU32(tableSize.width + 6, tableSize.height + 4), RectU32(2, 1, width, height), fullSpec));
+
+    SizeU32 partialSize = StaticTableLayout<partialSpec>::Size();
+    for (uint32_t width = 0; width <= partialSize.width + 1; ++width)
+        BTUI_CHECK(StaysInFrame(SizeU32(partialSize.width + 6, partialSize.height + 4), RectU32(3, 2, width, partialSize.height), partialSpec));
+}
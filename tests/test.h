@@ -0,0 +1,58 @@
+#ifndef BRENDANTUI_TESTS_TEST_H_
+#define BRENDANTUI_TESTS_TEST_H_
+
+#include <cstdint>
+#include <vector>
+
+// A minimal test registry. BTUI_TEST(Name) defines a
+// test that main.cpp runs; BTUI_CHECK() records a
+// failure and carries on, so one run reports every
+// broken check.
+
+namespace btui_tests {
+    struct TestCase {
+        const char* name;
+        void (*func)();
+    };
+
+    std::vector<TestCase>& Registry();
+    void Fail(const char* File, int Line, const char* Expression);
+
+    struct Registrar {
+        inline Registrar(const char* Name, void (*Func)()) {
+            Registry().push_back(TestCase{ Name, Func });
+        }
+    };
+
+    // Small deterministic generator (xorshift), so
+    // randomized tests repeat exactly.
+
+    class Random {
+        uint64_t state;
+    public:
+        inline Random(uint64_t Seed)
+            : state(Seed ? Seed : 1) { }
+
+        inline uint64_t Next() {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state;
+        }
+        inline uint32_t Below(uint32_t Bound) {
+            return (uint32_t)(Next() % Bound);
+        }
+    };
+}
+
+#define BTUI_TEST(Name)                                                             \
+    static void Name();                                                             \
+    static ::btui_tests::Registrar Name##Registrar(#Name, Name);                    \
+    static void Name()
+
+#define BTUI_CHECK(Expression)                                                      \
+    do {                                                                            \
+        if (!(Expression)) ::btui_tests::Fail(__FILE__, __LINE__, #Expression);     \
+    } while (0)
+
+#endif // BRENDANTUI_TESTS_TEST_H_
@@ -0,0 +1,115 @@
+#include <brendantui/textsearch.h>
+
+#include <clocale>
+#include <cwctype>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+using namespace btui;
+
+namespace {
+    wchar_t Fold(wchar_t C) {
+        if (C < 0x80) return C >= L'A' && C <= L'Z' ? C + (L'a' - L'A') : C;
+        return (wchar_t)std::towlower((wint_t)C);
+    }
+
+    // Every start position, compared one character at
+    // a time.
+    std::vector<size_t> FindReference(const std::wstring& Text, const std::wstring& Query, bool CaseSensitive) {
+        std::vector<size_t> found;
+        if (Query.empty()) return found;
+        for (size_t i = 0; i + Query.size() <= Text.size(); ++i) {
+            bool match = true;
+            for (size_t j = 0; match && j < Query.size(); ++j)
+                match = CaseSensitive ? Text[i + j] == Query[j] : Fold(Text[i + j]) == Fold(Query[j]);
+            if (match) found.push_back(i);
+        }
+        return found;
+    }
+
+    // A small alphabet, so matches are common, with
+    // characters that fold onto ASCII from outside it.
+    const wchar_t alphabet[] = { L'a', L'A', L'b', L'k', L'K', (wchar_t)0x212A, (wchar_t)0xE9, (wchar_t)0xC9, L' ' };
+
+    std::wstring RandomText(btui_tests::Random& Random, size_t Length) {
+        std::wstring text;
+        for (size_t i = 0; i < Length; ++i) text += alphabet[Random.Below(sizeof(alphabet) / sizeof(alphabet[0]))];
+        return text;
+    }
+
+    // Sets the locale towlower() folds with for the
+    // length of a test.
+    struct Utf8Locale {
+        std::string previous;
+
+        Utf8Locale()
+            : previous(std::setlocale(LC_CTYPE, nullptr)) {
+            std::setlocale(LC_CTYPE, "C.UTF-8");
+        }
+        ~Utf8Locale() {
+            std::setlocale(LC_CTYPE, previous.c_str());
+        }
+    };
+}
+
+BTUI_TEST(TextSearchFoldsOutsideAscii) {
+    Utf8Locale locale;
+    if (std::towlower((wint_t)0x212A) != L'k') return;
+
+    std::wstring text = L"xxKelvin yy kelvin KELVIN";
+    TextSearch search;
+    search.SetText(text);
+    search.SetQuery(L"kelvin");
+    search.Continue();
+    BTUI_CHECK(search.Matches() == std::vector<size_t>({ 2, 12, 19 }));
+
+    search.SetQuery(L"kelvin", true);
+    search.Continue();
+    BTUI_CHECK(search.Matches() == std::vector<size_t>({ 12 }));
+}
+
+BTUI_TEST(TextSearchMatchesReference) {
+    Utf8Locale locale;
+    btui_tests::Random random(36);
+    for (int round = 0; round < 400; ++round) {
+        std::wstring text = RandomText(random, random.Below(100));
+        std::wstring query = RandomText(random, 1 + random.Below(4));
+        bool caseSensitive = random.Below(2);
+
+        TextSearch search;
+        search.SetText(text);
+        search.SetQuery(query, caseSensitive);
+        while (!search.Continue(1 + random.Below(40))) { }
+        BTUI_CHECK(search.Matches() == FindReference(text, query, caseSensitive));
+    }
+}
+
+BTUI_TEST(TextSearchIncrementalMatchesFresh) {
+    // Types a query a character at a time, then deletes
+    // part of it and types on, scanning only part of
+    // the text between some of the steps. Whenever the
+    // scan completes, the result must be what a new
+    // search finds.
+    Utf8Locale locale;
+    btui_tests::Random random(3636);
+    for (int round = 0; round < 100; ++round) {
+        std::wstring text = RandomText(random, random.Below(300));
+        bool caseSensitive = random.Below(2);
+        TextSearch search;
+        search.SetText(text);
+
+        std::wstring query;
+        for (int step = 0; step < 20; ++step) {
+            if (!query.empty() && random.Below(3) == 0) query.resize(random.Below((uint32_t)query.size()));
+            else query += alphabet[random.Below(sizeof(alphabet) / sizeof(alphabet[0]))];
+            search.SetQuery(query, caseSensitive);
+
+            bool complete = random.Below(2) ? search.Continue() : search.Continue(random.Below(64));
+            if (complete) BTUI_CHECK(search.Matches() == FindReference(text, query, caseSensitive));
+        }
+        search.Continue();
+        BTUI_CHECK(search.Matches() == FindReference(text, query, caseSensitive));
+    }
+}
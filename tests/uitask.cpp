@@ -0,0 +1,87 @@
+#include <brendantui/uitask.h>
+
+#include <algorithm>
+#include <coroutine>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+
+using namespace btui;
+
+namespace {
+    // Suspends and hands the coroutine to whoever
+    // resumes it, possibly on another thread.
+    struct Handoff {
+        std::coroutine_handle<> handle;
+
+        struct Awaiter {
+            Handoff* handoff;
+
+            bool await_ready() { return false; }
+            void await_suspend(std::coroutine_handle<> Handle) { handoff->handle = Handle; }
+            void await_resume() { }
+        };
+        Awaiter operator co_await() { return Awaiter{ this }; }
+    };
+
+    UiTask Count(Handoff& Point, int& Steps) {
+        int local[32] = { };
+        local[0] = ++Steps;
+        co_await Point;
+        Steps += local[0];
+    }
+}
+
+BTUI_TEST(CoroutineFramesAreReused) {
+    // Sizes in the same 64-byte class share blocks.
+    void* frame = details::AllocateCoroutineFrame(100);
+    details::FreeCoroutineFrame(frame, 100);
+    void* again = details::AllocateCoroutineFrame(120);
+    BTUI_CHECK(again == frame);
+    details::FreeCoroutineFrame(again, 120);
+
+    // Freed last, handed out first; past the per-class
+    // cap, frames go back to the heap.
+    std::vector<void*> frames;
+    for (int i = 0; i < 40; ++i) frames.push_back(details::AllocateCoroutineFrame(200));
+    for (void* f : frames) details::FreeCoroutineFrame(f, 200);
+    for (int i = 0; i < 32; ++i) {
+        void* reused = details::AllocateCoroutineFrame(200);
+        BTUI_CHECK(reused == frames[31 - i]);
+        frames[31 - i] = reused;
+    }
+    for (int i = 0; i < 32; ++i) details::FreeCoroutineFrame(frames[i], 200);
+
+    // Too big for the lists.
+    void* large = details::AllocateCoroutineFrame(10000);
+    details::FreeCoroutineFrame(large, 10000);
+}
+
+BTUI_TEST(CoroutineFramesFreedOnOtherThreads) {
+    // Frames made here and freed on another thread join
+    // that thread's lists, which serve it from then on
+    // and are released when it exits.
+    std::vector<void*> frames;
+    for (int i = 0; i < 8; ++i) frames.push_back(details::AllocateCoroutineFrame(300));
+
+    bool reused = true;
+    std::thread other([&frames, &reused]() {
+        for (void* f : frames) details::FreeCoroutineFrame(f, 300);
+        for (int i = 0; i < 8; ++i) reused = reused && details::AllocateCoroutineFrame(300) == frames[7 - i];
+        for (void* f : frames) details::FreeCoroutineFrame(f, 300);
+    });
+    other.join();
+    BTUI_CHECK(reused);
+
+    // Coroutines started here and finished there.
+    int steps = 0;
+    std::vector<Handoff> points(100);
+    for (Handoff& point : points) Count(point, steps);
+    BTUI_CHECK(steps == 100);
+    std::thread resumer([&points]() {
+        for (Handoff& point : points) point.handle.resume();
+    });
+    resumer.join();
+    BTUI_CHECK(steps == 100 + 100 * 101 / 2);
+}
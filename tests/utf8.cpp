@@ -0,0 +1,184 @@
+#include <brendantui/utf8.h>
+#include <brendantui/drawing.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+using namespace btui;
+
+namespace {
+    const wchar_t replacement = (wchar_t)0xFFFD;
+
+    std::wstring Decode(std::string_view Text) {
+        std::wstring out;
+        AppendUtf8(out, Text);
+        return out;
+    }
+
+    // One character at a time, with no vector paths.
+    std::wstring DecodeReference(std::string_view Text) {
+        std::wstring out;
+        const uint8_t* p = (const uint8_t*)Text.data();
+        const uint8_t* end = p + Text.size();
+        while (p < end) out += details::DecodeUtf8Char(p, end);
+        return out;
+    }
+
+    // Mostly ASCII, so runs of every length cross the
+    // 16-byte boundaries, broken up by valid and
+    // invalid sequences.
+    std::string RandomUtf8(btui_tests::Random& Random, size_t Length) {
+        static const char* pieces[] = {
+            "\xC3\xA9", "\xE2\x94\x80", "\xF0\x9F\x98\x80", "\xC2\x85",
+            "\xC3", "\xE2\x94", "\xF0\x9F\x98", "\x80", "\xBF", "\xFF", "\xFE",
+            "\xC0\x80", "\xC1\xBF", "\xE0\x80\xAF", "\xF0\x82\x82\xAC",
+            "\xED\xA0\x80", "\xED\xBF\xBF", "\xF4\x90\x80\x80", "\xF8\x88\x80\x80\x80"
+        };
+        std::string out;
+        while (out.size() < Length) {
+            if (Random.Below(4)) {
+                uint32_t run = Random.Below(40);
+                for (uint32_t i = 0; i < run; ++i) out += (char)(Random.Below(8) ? 0x20 + Random.Below(0x5F) : Random.Below(0x80));
+            }
+            else out += pieces[Random.Below(sizeof(pieces) / sizeof(pieces[0]))];
+        }
+        return out;
+    }
+}
+
+BTUI_TEST(Utf8AsciiAcrossVectorBoundaries) {
+    // A multi-byte character at every offset around the
+    // 16-byte blocks, with ASCII on either side.
+    for (size_t before = 0; before < 40; ++before) {
+        for (size_t after = 0; after < 20; ++after) {
+            std::string text = std::string(before, 'a') + "\xE2\x94\x80" + std::string(after, 'z');
+            std::wstring expected = std::wstring(before, L'a') + (wchar_t)0x2500 + std::wstring(after, L'z');
+            BTUI_CHECK(Decode(text) == expected);
+        }
+    }
+
+    std::string ascii;
+    for (int i = 0; i < 100; ++i) ascii += (char)(i % 0x80);
+    std::wstring wide;
+    for (int i = 0; i < 100; ++i) wide += (wchar_t)(i % 0x80);
+    BTUI_CHECK(Decode(ascii) == wide);
+}
+
+BTUI_TEST(Utf8InvalidSequences) {
+    // Truncated sequences: one U+FFFD for the bytes
+    // taken, then whatever follows.
+    BTUI_CHECK(Decode("\xC3") == std::wstring(1, replacement));
+    BTUI_CHECK(Decode("\xE2\x94") == std::wstring(1, replacement));
+    BTUI_CHECK(Decode("\xF0\x9F\x98") == std::wstring(1, replacement));
+    BTUI_CHECK(Decode("\xE2\x94" "A") == std::wstring(1, replacement) + L"A");
+    BTUI_CHECK(Decode("ab\xC3") == L"ab" + std::wstring(1, replacement));
+
+    // Stray continuation bytes and invalid leads.
+    BTUI_CHECK(Decode("\x80" "a\xBF") == std::wstring(1, replacement) + L"a" + std::wstring(1, replacement));
+    BTUI_CHECK(Decode("\xFF\xFE") == std::wstring(2, replacement));
+    BTUI_CHECK(Decode("\xF8\x88\x80\x80\x80").front() == replacement);
+
+    // Overlong encodings.
+    BTUI_CHECK(Decode("\xC0\x80") == std::wstring(1, replacement));
+    BTUI_CHECK(Decode("\xC1\xBF") == std::wstring(1, replacement));
+    BTUI_CHECK(Decode("\xE0\x80\xAF") == std::wstring(1, replacement));
+    BTUI_CHECK(Decode("\xF0\x82\x82\xAC") == std::wstring(1, replacement));
+
+    // Surrogates are not characters in UTF-8.
+    BTUI_CHECK(Decode("\xED\xA0\x80") == std::wstring(1, replacement));
+    BTUI_CHECK(Decode("\xED\xBF\xBF") == std::wstring(1, replacement));
+    BTUI_CHECK(Decode("\xED\x9F\xBF") == std::wstring(1, (wchar_t)0xD7FF));
+}
+
+BTUI_TEST(Utf8AboveBasicPlane) {
+    // wchar_t holds these only where it is 32 bits.
+    wchar_t emoji = sizeof(wchar_t) == 4 ? (wchar_t)0x1F600 : replacement;
+    wchar_t last = sizeof(wchar_t) == 4 ? (wchar_t)0x10FFFF : replacement;
+    BTUI_CHECK(Decode("\xF0\x9F\x98\x80") == std::wstring(1, emoji));
+    BTUI_CHECK(Decode("\xF4\x8F\xBF\xBF") == std::wstring(1, last));
+    BTUI_CHECK(Decode("\xF0\x90\x80\x80" "x") == std::wstring(1, sizeof(wchar_t) == 4 ? (wchar_t)0x10000 : replacement) + L"x");
+    BTUI_CHECK(Decode("\xF4\x90\x80\x80") == std::wstring(1, replacement));
+    BTUI_CHECK(Decode("\xEF\xBF\xBF") == std::wstring(1, (wchar_t)0xFFFF));
+}
+
+BTUI_TEST(Utf8DecodeMatchesReference) {
+    btui_tests::Random random(42);
+    for (int i = 0; i < 2000; ++i) {
+        std::string text = RandomUtf8(random, random.Below(200));
+        std::wstring expected = DecodeReference(text);
+        BTUI_CHECK(Decode(text) == expected);
+
+        // A short output buffer stops the decode at a
+        // character boundary; the rest picks up there.
+        size_t capacity = random.Below((uint32_t)expected.size() + 2);
+        std::vector<wchar_t> out(text.size() + 1);
+        const uint8_t* p = (const uint8_t*)text.data();
+        const uint8_t* end = p + text.size();
+        size_t first = details::DecodeUtf8(p, end, out.data(), capacity);
+        size_t second = details::DecodeUtf8(p, end, out.data() + first, out.size() - first);
+        BTUI_CHECK(first == std::min(capacity, expected.size()));
+        BTUI_CHECK(std::wstring(out.data(), first + second) == expected);
+        BTUI_CHECK(p == end);
+    }
+}
+
+BTUI_TEST(Utf8DrawLineMatchesWide) {
+    btui_tests::Random random(8);
+    const uint32_t backcolor = 0xFF000010;
+    const uint32_t forecolor = 0xFFF0F0F0;
+    const BufferGridCell background(L'#', 1, 2);
+
+    for (int i = 0; i < 1000; ++i) {
+        std::string text = RandomUtf8(random, random.Below(120));
+        std::wstring decoded = DecodeReference(text);
+
+        SizeU32 size(1 + random.Below(100), 3);
+        PointU32 point(random.Below(size.width + 2), random.Below(4));
+        uint32_t maxColumns = random.Below(4) ? 0xFFFFFFFF : random.Below(60);
+
+        std::vector<BufferGridCell> actual((size_t)size.width * size.height, background);
+        uint32_t written = DrawUtf8Line(BufferGrid(size, actual.data()), point, text, backcolor, forecolor, maxColumns);
+
+        // Control characters, C1 included, become spaces.
+        std::vector<BufferGridCell> expected((size_t)size.width * size.height, background);
+        uint32_t expectedWritten = 0;
+        if (point.x < size.width && point.y < size.height) {
+            uint32_t columns = std::min({ (uint32_t)decoded.size(), maxColumns, size.width - point.x });
+            for (uint32_t x = 0; x < columns; ++x) {
+                wchar_t c = decoded[x];
+                bool control = c < 0x20 || (c >= 0x7F && c < 0xA0);
+                expected[(size_t)point.y * size.width + point.x + x] = BufferGridCell(control ? L' ' : c, forecolor, backcolor);
+            }
+            expectedWritten = columns;
+        }
+
+        BTUI_CHECK(written == expectedWritten);
+        bool same = true;
+        for (size_t j = 0; j < actual.size(); ++j)
+            same = same && actual[j].character == expected[j].character && actual[j].forecolor == expected[j].forecolor && actual[j].backcolor == expected[j].backcolor;
+        BTUI_CHECK(same);
+    }
+}
+
+BTUI_TEST(Utf8TextInFrameMatchesWide) {
+    btui_tests::Random random(5);
+    for (int i = 0; i < 200; ++i) {
+        std::string text = RandomUtf8(random, random.Below(150));
+        std::wstring decoded = DecodeReference(text);
+        RectU32 frame(1, 1, 1 + random.Below(30), 1 + random.Below(8));
+        WrapStyle wrap = (WrapStyle)random.Below(4);
+
+        std::vector<BufferGridCell> narrow(40 * 12);
+        std::vector<BufferGridCell> wide(40 * 12);
+        DrawTextInFrame(BufferGrid(40, 12, narrow.data()), frame, std::string_view(text), 0xFF000000, 0xFFFFFFFF, AlignStart, AlignStart, wrap, std::monostate());
+        DrawTextInFrame(BufferGrid(40, 12, wide.data()), frame, decoded, 0xFF000000, 0xFFFFFFFF, AlignStart, AlignStart, wrap, std::monostate());
+
+        bool same = true;
+        for (size_t j = 0; j < narrow.size(); ++j)
+            same = same && narrow[j].character == wide[j].character && narrow[j].forecolor == wide[j].forecolor && narrow[j].backcolor == wide[j].backcolor;
+        BTUI_CHECK(same);
+    }
+}
@@ -0,0 +1,177 @@
+#include <brendantui/widgets.h>
+
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+using namespace btui;
+
+namespace {
+    // A leaf of a set size that counts its measures and
+    // paints.
+    class Probe : public Widget {
+        SizeU32 size;
+    public:
+        uint32_t measures;
+        uint32_t paints;
+
+        Probe(SizeU32 Size)
+            : size(Size), measures(0), paints(0) { }
+
+        void Resize(SizeU32 Size) {
+            size = Size;
+            InvalidateMeasure();
+        }
+        void Touch() {
+            InvalidatePaint();
+        }
+    protected:
+        SizeU32 MeasureOverride(SizeU32 Available) override {
+            ++measures;
+            return size;
+        }
+        void PaintOverride(BufferGrid Buffer) override {
+            ++paints;
+        }
+    };
+
+    template <typename _T>
+    class Counting : public _T {
+    public:
+        uint32_t measures = 0;
+
+        using _T::_T;
+    protected:
+        SizeU32 MeasureOverride(SizeU32 Available) override {
+            ++measures;
+            return _T::MeasureOverride(Available);
+        }
+    };
+
+    struct Snapshot {
+        uint32_t rootMeasures, middleMeasures, aMeasures, bMeasures, cMeasures;
+        uint32_t aPaints, bPaints, cPaints;
+    };
+}
+
+BTUI_TEST(WidgetRelayoutStopsAtSteadyAncestor) {
+    // A fixed-size grid holding a column of two probes
+    // and a third probe below it.
+    WidgetTree tree;
+    auto* root = tree.EmplaceRoot<Counting<GridPanel>>(std::vector<GridTrack>{ GridTrack::Fixed(20) }, std::vector<GridTrack>{ GridTrack::Fixed(10), GridTrack::Fixed(3) });
+    auto* middle = root->Emplace<Counting<FlexPanel>>(FlexDirectionColumn);
+    Probe* a = middle->Emplace<Probe>(SizeU32(3, 2));
+    Probe* b = middle->Emplace<Probe>(SizeU32(10, 2));
+    Probe* c = root->Emplace<Probe>(SizeU32(5, 1));
+
+    std::vector<BufferGridCell> cells(20 * 13);
+    BufferGrid grid(20, 13, cells.data());
+    tree.Paint(grid);
+    BTUI_CHECK(a->paints == 1 && b->paints == 1 && c->paints == 1);
+    BTUI_CHECK(b->Bounds() == RectU32(0, 2, 20, 2));
+
+    auto take = [&]() {
+        return Snapshot{ root->measures, middle->measures, a->measures, b->measures, c->measures, a->paints, b->paints, c->paints };
+    };
+
+    // Wider, but still narrower than b: the column
+    // keeps its size, so nothing above it re-measures
+    // and nothing moves.
+    Snapshot before = take();
+    a->Resize(SizeU32(4, 2));
+    BTUI_CHECK(tree.NeedsPaint());
+    tree.Paint(grid);
+    Snapshot after = take();
+    BTUI_CHECK(after.aMeasures == before.aMeasures + 1);
+    BTUI_CHECK(after.middleMeasures == before.middleMeasures + 1);
+    BTUI_CHECK(after.rootMeasures == before.rootMeasures);
+    BTUI_CHECK(after.bMeasures == before.bMeasures && after.cMeasures == before.cMeasures);
+    BTUI_CHECK(after.aPaints == before.aPaints + 1);
+    BTUI_CHECK(after.bPaints == before.bPaints && after.cPaints == before.cPaints);
+    BTUI_CHECK(!tree.NeedsPaint());
+
+    // Taller: the column grows, so the grid re-measures
+    // too, but its fixed tracks hold its size. b moves
+    // down and repaints; c stays put and does not.
+    before = take();
+    a->Resize(SizeU32(4, 5));
+    tree.Paint(grid);
+    after = take();
+    BTUI_CHECK(after.middleMeasures == before.middleMeasures + 1);
+    BTUI_CHECK(after.rootMeasures == before.rootMeasures + 1);
+    BTUI_CHECK(after.bMeasures == before.bMeasures && after.cMeasures == before.cMeasures);
+    BTUI_CHECK(b->Bounds() == RectU32(0, 5, 20, 2));
+    BTUI_CHECK(after.aPaints == before.aPaints + 1 && after.bPaints == before.bPaints + 1);
+    BTUI_CHECK(after.cPaints == before.cPaints);
+
+    // A look-only change repaints just that widget.
+    before = take();
+    c->Touch();
+    tree.Paint(grid);
+    after = take();
+    BTUI_CHECK(after.cPaints == before.cPaints + 1);
+    BTUI_CHECK(after.aPaints == before.aPaints && after.bPaints == before.bPaints);
+    BTUI_CHECK(after.rootMeasures == before.rootMeasures && after.cMeasures == before.cMeasures);
+
+    // Nothing changed, nothing repaints.
+    before = take();
+    tree.Paint(grid);
+    after = take();
+    BTUI_CHECK(after.aPaints == before.aPaints && after.bPaints == before.bPaints && after.cPaints == before.cPaints);
+}
+
+BTUI_TEST(LabelMeasureMatchesDrawnText) {
+    // Draws the text unclipped, top- and bottom-aligned
+    // in a tall frame: every cell it writes must lie
+    // inside the measured size, the last column must be
+    // reached, and bottom alignment must move the lines
+    // down by exactly the frame height less the
+    // measured one.
+    constexpr uint32_t frameHeight = 200;
+    const BufferGridCell unset(L'?', 0, 0);
+    btui_tests::Random random(26);
+    WrapStyle styles[] = { WrapStyleNoWrap, WrapStyleWrapByChar, WrapStyleWrapByWord, WrapStyleWrapByWordAndStretch };
+
+    for (int round = 0; round < 500; ++round) {
+        std::wstring text;
+        uint32_t words = random.Below(12);
+        for (uint32_t i = 0; i < words; ++i) {
+            uint32_t gap = random.Below(8);
+            if (i || random.Below(4) == 0) text += gap == 0 ? L"\n" : std::wstring(gap < 5 ? 1 : gap - 3, L' ');
+            text += std::wstring(1 + random.Below(9), (wchar_t)(L'a' + i));
+        }
+        uint32_t width = 1 + random.Below(16);
+
+        for (WrapStyle style : styles) {
+            Label label(text);
+            label.SetWrapStyle(style);
+            SizeU32 measured = label.Measure(SizeU32(width, frameHeight));
+
+            std::vector<BufferGridCell> top((size_t)width * frameHeight, unset);
+            std::vector<BufferGridCell> bottom((size_t)width * frameHeight, unset);
+            DrawTextInFrame(BufferGrid(width, frameHeight, top.data()), RectU32(0, 0, width, frameHeight), text, 0, 1, AlignStart, AlignStart, style, std::monostate());
+            DrawTextInFrame(BufferGrid(width, frameHeight, bottom.data()), RectU32(0, 0, width, frameHeight), text, 0, 1, AlignStart, AlignEnd, style, std::monostate());
+
+            bool inside = true;
+            bool reachesEdge = !measured.width;
+            bool shifted = true;
+            uint32_t shift = frameHeight - measured.height;
+            for (uint32_t y = 0; y < frameHeight; ++y) {
+                for (uint32_t x = 0; x < width; ++x) {
+                    const BufferGridCell& cell = top[(size_t)y * width + x];
+                    bool written = cell.character != L'?';
+                    if (written && (x >= measured.width || y >= measured.height)) inside = false;
+                    if (written && x + 1 == measured.width) reachesEdge = true;
+                    if (y < measured.height) {
+                        const BufferGridCell& moved = bottom[(size_t)(y + shift) * width + x];
+                        if (moved.character != cell.character) shifted = false;
+                    }
+                }
+            }
+            BTUI_CHECK(inside);
+            BTUI_CHECK(reachesEdge);
+            BTUI_CHECK(shifted);
+        }
+    }
+}
@@ -0,0 +1,148 @@
+#include <brendantui/workerpool.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+
+using namespace btui;
+
+BTUI_TEST(SerialQueueRunsInOrder) {
+    WorkerPool pool(4);
+    std::vector<int> ran;
+    {
+        SerialQueue queue(pool);
+        for (int i = 0; i < 1000; ++i)
+            queue.Post([&ran, i]() { ran.push_back(i); });
+        queue.Drain();
+        BTUI_CHECK(queue.Idle());
+    }
+
+    BTUI_CHECK(ran.size() == 1000);
+    for (int i = 0; i < (int)ran.size(); ++i) BTUI_CHECK(ran[i] == i);
+}
+
+namespace {
+    // Posts numbered tasks that note overlaps and the
+    // order they ran in, running them inline whenever
+    // the queue says so.
+    struct OrderedPoster {
+        SwitchableQueue& queue;
+        std::vector<int> ran;
+        std::atomic<bool> running;
+        std::atomic<int> overlaps;
+        std::atomic<int> finished;
+        int next;
+
+        OrderedPoster(SwitchableQueue& Queue)
+            : queue(Queue), ran(), running(false), overlaps(0), finished(0), next(0) { }
+
+        void Post(std::function<void()> Before = nullptr) {
+            std::function<void()> task = [this, i = next++, Before]() {
+                if (running.exchange(true)) ++overlaps;
+                if (Before) Before();
+                ran.push_back(i);
+                if (i % 64 == 0) std::this_thread::yield();
+                running.store(false);
+                ++finished;
+            };
+            if (!queue.Queued() || !queue.Post(task)) task();
+        }
+        bool InOrder() const {
+            if (ran.size() != (size_t)next) return false;
+            for (int i = 0; i < next; ++i)
+                if (ran[i] != i) return false;
+            return true;
+        }
+    };
+}
+
+BTUI_TEST(SwitchableQueueWaitsForOldQueue) {
+    WorkerPool poolA(2);
+    WorkerPool poolB(2);
+    SwitchableQueue queue;
+    OrderedPoster poster(queue);
+
+    // The first task on poolA holds it up while a
+    // switch to poolB starts; what is posted meanwhile
+    // must still wait behind it.
+    queue.SwitchTo(&poolA);
+    std::atomic<bool> release(false);
+    poster.Post([&release]() {
+        while (!release.load()) std::this_thread::yield();
+    });
+    for (int i = 0; i < 10; ++i) poster.Post();
+
+    std::thread switcher([&queue, &poolB]() { queue.SwitchTo(&poolB); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    for (int i = 0; i < 10; ++i) poster.Post();
+    release.store(true);
+    switcher.join();
+
+    for (int i = 0; i < 10; ++i) poster.Post();
+    queue.SwitchTo(nullptr);
+    for (int i = 0; i < 10; ++i) poster.Post();
+
+    BTUI_CHECK(poster.overlaps.load() == 0);
+    BTUI_CHECK(poster.InOrder());
+}
+
+BTUI_TEST(SwitchableQueueKeepsOrderAcrossSwitches) {
+    WorkerPool poolA(2);
+    WorkerPool poolB(3);
+    SwitchableQueue queue;
+
+    // One thread posts while this one switches back
+    // and forth underneath it.
+    OrderedPoster poster(queue);
+    std::atomic<bool> done(false);
+    std::thread posting([&poster, &done]() {
+        for (int i = 0; i < 20000; ++i) poster.Post();
+        done.store(true);
+    });
+
+    btui_tests::Random random(49);
+    WorkerPool* targets[] = { &poolA, &poolB, nullptr };
+    while (!done.load()) queue.SwitchTo(targets[random.Below(3)]);
+    posting.join();
+    queue.SwitchTo(nullptr);
+
+    BTUI_CHECK(poster.overlaps.load() == 0);
+    BTUI_CHECK(poster.InOrder());
+}
+
+BTUI_TEST(SwitchableQueueSwitchesUnderLoad) {
+    WorkerPool poolA(2);
+    WorkerPool poolB(2);
+    SwitchableQueue queue;
+
+    // The poster keeps a couple of hundred tasks
+    // waiting, so the queue never goes idle and each
+    // switch may only wait for what was queued before
+    // it; this returns at all only if that holds.
+    OrderedPoster poster(queue);
+    std::atomic<bool> stop(false);
+    std::thread posting([&poster, &stop]() {
+        while (!stop.load()) {
+            if (poster.next - poster.finished.load() < 200) poster.Post();
+            else std::this_thread::yield();
+        }
+    });
+
+    queue.SwitchTo(&poolA);
+    WorkerPool* targets[] = { &poolB, &poolA, nullptr, &poolB, nullptr, &poolA };
+    for (int round = 0; round < 8; ++round) {
+        for (WorkerPool* target : targets) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            queue.SwitchTo(target);
+        }
+    }
+    stop.store(true);
+    posting.join();
+    queue.SwitchTo(nullptr);
+
+    BTUI_CHECK(poster.overlaps.load() == 0);
+    BTUI_CHECK(poster.InOrder());
+}